@@ -109,19 +109,8 @@ int main (int argc, char ** argv)
                 Preprocess the data
   *******************************************************/
 
-  std :: unique_ptr < float [] > training(new float[dataset.train_size()]);
-
-  for (int i = 0; i < dataset.train_size(); ++i)
-  {
-    training[i] = static_cast < float >(dataset.training_images[i]);
-
-    if (normalize)
-      training[i] /= 255.f;
-    else
-
-    if (binarize)
-      training[i] = static_cast < float >(training[i] != 0);
-  }
+  // NOTE: the raw pixels are converted on the fly during the training
+  const input_normalization norm (normalize ? 1.f / 255.f : 1.f, 0.f, ! normalize && binarize);
 
   /******************************************************
                 Build the model
@@ -231,7 +220,8 @@ int main (int argc, char ** argv)
                 Run the simulation
   *******************************************************/
 
-  bcm.fit(training.get(), dataset.num_train_sample, dataset.rows * dataset.cols * dataset.channels, epochs, seed, callback);
+  bcm.fit(dataset.training_images.get(), dataset.num_train_sample, dataset.rows * dataset.cols * dataset.channels,
+          dataset.training_images.get_stride(), norm, epochs, seed, callback);
 
   // stop the image until the ESC key
   std :: cerr << "Press ESC to exit" << std :: endl;
@@ -244,7 +234,8 @@ int main (int argc, char ** argv)
                 Run the simulation
   *******************************************************/
 
-  bcm.fit(training.get(), dataset.num_train_sample, dataset.rows * dataset.cols * dataset.channels, epochs, seed);
+  bcm.fit(dataset.training_images.get(), dataset.num_train_sample, dataset.rows * dataset.cols * dataset.channels,
+          dataset.training_images.get_stride(), norm, epochs, seed);
 
 #endif
 
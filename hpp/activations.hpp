@@ -0,0 +1,535 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __activations_hpp__
+#define __activations_hpp__
+
+#include <activations.h>
+
+#include <type_traits> // std :: is_same
+
+namespace transfer
+{
+
+  static constexpr float leaky_coeff = 1e-1f; ///< Internal coefficient of Leaky activation function
+  static constexpr float steepness = 1.f;     ///< Internal coefficient of Elliot function
+
+  template < class Scalar >
+  using column_t = Eigen :: Array < Scalar, Eigen :: Dynamic, 1 >; ///< array of values
+
+  template < class Scalar >
+  using array_t = Eigen :: Map < column_t < Scalar > >; ///< in-place view of the buffer
+
+  // Batched (vectorized) versions as compile-time policies.
+  // Each policy exposes the type identifier and the in-place activation
+  // and gradient of a buffer, so the kernels can be inlined in the caller.
+  // The buffer can store float or double values: the fast math versions
+  // (enabled by the __fast_math__ define) are used only for the float ones
+
+  /**
+  * @brief Linear activation policy.
+  *
+  */
+  struct Linear
+  {
+    static constexpr int32_t type = transfer_t :: linear; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (__unused Scalar * x, __unused const int32_t & n)
+    {
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar >(x, n).setOnes();
+    }
+  };
+
+  /**
+  * @brief Stair activation policy.
+  *
+  */
+  struct Stair
+  {
+    static constexpr int32_t type = transfer_t :: stair; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      // NOTE: n - 2 * floor(n / 2) is the (always positive) parity of the integer part
+      a = ( (a.floor() - 2.f * (a.floor() * .5f).floor()) != 0.f ).select(
+            (a - a.floor()) + (a * .5f).floor(),
+            (a * .5f).floor());
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a.floor() == a).select(0.f, column_t < Scalar > :: Ones(n));
+    }
+  };
+
+  /**
+  * @brief HardTan activation policy.
+  *
+  */
+  struct Hardtan
+  {
+    static constexpr int32_t type = transfer_t :: hardtan; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a < -2.5f).select(0.f, (a > 2.5f).select(1.f, .2f * a + .5f));
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > -2.5f && a < 2.5f).select(.2f, column_t < Scalar > :: Zero(n));
+    }
+  };
+
+  /**
+  * @brief Logistic activation policy.
+  *
+  */
+  struct Logistic
+  {
+    static constexpr int32_t type = transfer_t :: logistic; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+
+#ifdef __fast_math__
+
+      if constexpr ( std :: is_same < Scalar, float > :: value )
+      {
+        a = -a;
+        math :: exp(x, x, n);
+        a = (1.f + a).inverse();
+        return;
+      }
+
+#endif
+
+      a = (1.f + (-a).exp()).inverse();
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (1.f - a) * a;
+    }
+  };
+
+  /**
+  * @brief Loggy activation policy.
+  *
+  */
+  struct Loggy
+  {
+    static constexpr int32_t type = transfer_t :: loggy; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+
+#ifdef __fast_math__
+
+      if constexpr ( std :: is_same < Scalar, float > :: value )
+      {
+        a = -a;
+        math :: exp(x, x, n);
+        a = 2.f * (1.f + a).inverse() - 1.f;
+        return;
+      }
+
+#endif
+
+      a = 2.f * (1.f + (-a).exp()).inverse() - 1.f;
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = 2.f * (1.f - (a + 1.f) * .5f) * (a + 1.f) * .5f;
+    }
+  };
+
+  /**
+  * @brief Relu activation policy.
+  *
+  */
+  struct Relu
+  {
+    static constexpr int32_t type = transfer_t :: relu; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = a.max(0.f);
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f).template cast < Scalar >();
+    }
+  };
+
+  /**
+  * @brief Elu activation policy.
+  *
+  */
+  struct Elu
+  {
+    static constexpr int32_t type = transfer_t :: elu; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a >= 0.f).select(a, a.expm1());
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a >= 0.f).select(1.f, a + 1.f);
+    }
+  };
+
+  /**
+  * @brief Relie activation policy.
+  *
+  */
+  struct Relie
+  {
+    static constexpr int32_t type = transfer_t :: relie; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f).select(a, 1e-2f * a);
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f).select(1.f, column_t < Scalar > :: Constant(n, 1e-2f));
+    }
+  };
+
+  /**
+  * @brief Ramp activation policy.
+  *
+  */
+  struct Ramp
+  {
+    static constexpr int32_t type = transfer_t :: ramp; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f).select(1.1f * a, .1f * a);
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f).select(1.1f, column_t < Scalar > :: Constant(n, .1f));
+    }
+  };
+
+  /**
+  * @brief Leaky activation policy.
+  *
+  */
+  struct Leaky
+  {
+    static constexpr int32_t type = transfer_t :: leaky; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f).select(a, leaky_coeff * a);
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f).select(1.f, column_t < Scalar > :: Constant(n, leaky_coeff));
+    }
+  };
+
+  /**
+  * @brief Tanh activation policy.
+  *
+  */
+  struct Tanhy
+  {
+    static constexpr int32_t type = transfer_t :: Tanh; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+
+#ifdef __fast_math__
+
+      if constexpr ( std :: is_same < Scalar, float > :: value )
+      {
+        a = -2.f * a;
+        math :: exp(x, x, n);
+        a = 2.f * (1.f + a).inverse() - 1.f;
+        return;
+      }
+
+#endif
+
+      a = 2.f * (1.f + (-2.f * a).exp()).inverse() - 1.f;
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = 1.f - a.square();
+    }
+  };
+
+  /**
+  * @brief PLSE activation policy.
+  *
+  */
+  struct Plse
+  {
+    static constexpr int32_t type = transfer_t :: plse; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a < -4.f).select(1e-2f * (a + 4.f),
+          (a > 4.f).select(1e-2f * (a - 4.f) + 1.f, .125f * a + .5f));
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a < 0.f || a > 1.f).select(1e-2f, column_t < Scalar > :: Constant(n, .125f));
+    }
+  };
+
+  /**
+  * @brief LhTan activation policy.
+  *
+  */
+  struct Lhtan
+  {
+    static constexpr int32_t type = transfer_t :: lhtan; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a < 0.f).select(1e-3f * a, (a > 1.f).select(1e-3f * (a - 1.f) + 1.f, a));
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a > 0.f && a < 1.f).select(1.f, column_t < Scalar > :: Constant(n, 1e-3f));
+    }
+  };
+
+  /**
+  * @brief Selu activation policy.
+  *
+  */
+  struct Selu
+  {
+    static constexpr int32_t type = transfer_t :: selu; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a >= 0.f).select(1.0507f * a, 1.0507f * 1.6732f * a.expm1());
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a >= 0.f).select(1.0507f, a + 1.0507f * 1.6732f);
+    }
+  };
+
+  /**
+  * @brief Elliot activation policy.
+  *
+  */
+  struct Elliot
+  {
+    static constexpr int32_t type = transfer_t :: elliot; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = .5f * steepness * a / (1.f + (a + steepness).abs()) + .5f;
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = .5f * steepness * (1.f + (a * steepness).abs()).square().inverse();
+    }
+  };
+
+  /**
+  * @brief SymmElliot activation policy.
+  *
+  */
+  struct SymmElliot
+  {
+    static constexpr int32_t type = transfer_t :: symm_elliot; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = steepness * a / (1.f + (a * steepness).abs());
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = steepness * (1.f + (a * steepness).abs()).square().inverse();
+    }
+  };
+
+  /**
+  * @brief SoftPlus activation policy.
+  *
+  */
+  struct Softplus
+  {
+    static constexpr int32_t type = transfer_t :: softplus; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = a.exp().log1p();
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (1.f + (-a).exp()).inverse();
+    }
+  };
+
+  /**
+  * @brief SoftSign activation policy.
+  *
+  */
+  struct Softsign
+  {
+    static constexpr int32_t type = transfer_t :: softsign; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = a / (a.abs() + 1.f);
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a.abs() + 1.f).square().inverse();
+    }
+  };
+
+  /**
+  * @brief AsymmLogistic activation policy.
+  *
+  */
+  struct AsymmLogistic
+  {
+    static constexpr int32_t type = transfer_t :: asymm_logistic; ///< activation type
+
+    template < class Scalar >
+    static inline void activate (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a < 0.f).select(1.f - 2.f * (1.f + (2.f * a).exp()).inverse(),
+                           50.f * (2.f * (1.f + (-2.f / 50.f * a).exp()).inverse() - 1.f));
+    }
+
+    template < class Scalar >
+    static inline void gradient (Scalar * x, const int32_t & n)
+    {
+      array_t < Scalar > a(x, n);
+      a = (a < 0.f).select(-a, a * (1.f / 50.f));
+      a = (a + 1.f) * (1.f - a);
+    }
+  };
+
+} // end namespace transfer
+
+#endif // __activations_hpp__
@@ -31,95 +31,362 @@
 
 #include <base.h>
 
+template < class Scalar >
 template < class Callback >
-void BasePlasticity :: fit (float * X, const int32_t & n_samples, const int32_t & n_features,
+void BasePlasticity_ < Scalar > :: fit (Scalar * X, const int32_t & n_samples, const int32_t & n_features,
   const int32_t & num_epochs, int32_t seed, Callback callback)
 {
-  // convert the input array to Eigen matrix
-  // NOTE: perform a copy of the array to avoid possible troubles
-  // in relation to the index permutation (?)
-  Eigen :: Map < Eigen :: Matrix < float, Eigen :: Dynamic, Eigen :: Dynamic, Eigen :: RowMajor > > data(X, n_samples, n_features);
+  // wrap the input array into an Eigen matrix
+  // NOTE: the map is forwarded as is to the core function, so the
+  // (column-major) copy of the full dataset is avoided: only the rows
+  // of the current batch are gathered at each iteration
+  Eigen :: Map < Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic, Eigen :: RowMajor > > data(X, n_samples, n_features);
 
-  // call the "real" function
-  this->fit (data, num_epochs, seed, callback);
+  // init the weights and the optimizer parameters
+  this->init_training(n_samples, n_features);
+
+  // call the core fit function
+  this->_fit ([&] (const int32_t * indices, matrix_t & batch_data, const int32_t & n_threads)
+              {
+                this->gather_batch(data, indices, batch_data, n_threads);
+              },
+              n_samples, n_features, num_epochs, seed, callback);
 }
 
+template < class Scalar >
 template < class Callback >
-void BasePlasticity :: fit (const Eigen :: MatrixXf & X, const int32_t & num_epochs,
+void BasePlasticity_ < Scalar > :: fit (const matrix_t & X, const int32_t & num_epochs,
   int32_t seed, Callback callback)
 {
-  if (this->batch > X.rows())
-    throw std :: runtime_error("Incorrect batch_size found. "
-      "The batch_size must be less or equal to the number of samples. "
-      "Given " + std :: to_string(this->batch) + " for " +
-      std :: to_string(X.rows()) + " samples");
-
-  // extract the number of features as the number of columns of the input matrix
-  const int32_t n_features = X.cols();
+  // init the weights and the optimizer parameters
+  this->init_training(X.rows(), X.cols());
 
-  // allocate the weights matrix
-  this->weights = Eigen :: MatrixXf(this->outputs, n_features);
-  // init the weight matrix using the given initializer
-  this->w_init.init(this->weights.data(), this->outputs, n_features);
+  // call the core fit function
+  this->_fit ([&] (const int32_t * indices, matrix_t & batch_data, const int32_t & n_threads)
+              {
+                this->gather_batch(X, indices, batch_data, n_threads);
+              },
+              X.rows(), X.cols(), num_epochs, seed, callback);
+}
 
-  // init the optimizer object with the required parameters
-  this->optimizer.init_arrays(this->weights.rows(), this->weights.cols());
+template < class Scalar >
+template < class Callback >
+void BasePlasticity_ < Scalar > :: fit (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+  const int64_t & stride, const input_normalization & norm, const int32_t & num_epochs, int32_t seed, Callback callback)
+{
+  // init the weights and the optimizer parameters
+  this->init_training(n_samples, n_features);
 
   // call the core fit function
-  this->_fit (X, num_epochs, seed, callback);
+  // NOTE: the raw values are converted only when gathered into the batch buffer
+  this->_fit ([&] (const int32_t * indices, matrix_t & batch_data, const int32_t & n_threads)
+              {
+                this->gather_batch(X, stride, indices, norm, batch_data, n_threads);
+              },
+              n_samples, n_features, num_epochs, seed, callback);
 }
 
+template < class Scalar >
 template < class Callback >
-void BasePlasticity :: _fit (const Eigen :: MatrixXf & X, const int32_t & num_epochs,
-  const int32_t & seed, Callback callback)
+void BasePlasticity_ < Scalar > :: partial_fit (const Scalar * X, const int32_t & n_samples, const int32_t & n_features,
+  Callback callback)
 {
-  // compute the number of possible batches
-  const int32_t num_batches = X.rows() / this->batch;
-  // extract the number of matrix shape
-  const int32_t n_samples = X.rows();
-  const int32_t n_features = X.cols();
+  // wrap the input array into an Eigen matrix (no copy)
+  Eigen :: Map < const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic, Eigen :: RowMajor > > data(X, n_samples, n_features);
+
+  // call the core partial_fit function
+  this->_partial_fit ([&] (const int32_t * indices, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads)
+                      {
+                        this->gather_batch(data, indices, batch_data, n_threads);
+                      },
+                      n_samples, n_features, callback);
+}
 
-#if EIGEN_VERSION_AT_LEAST(3, 3, 90)
-  // Build the index permutation generator
-  std :: vector < int32_t > batch_indices(n_samples);
-  std :: iota(batch_indices.begin(), batch_indices.end(), 0);
-#else
-  // The solution with eigen permutation is very very very slow...
-  Eigen :: PermutationMatrix < Eigen :: Dynamic, Eigen :: Dynamic > permutation (n_samples);
-  // init with the identity mat
-  permutation.setIdentity();
-#endif
+template < class Scalar >
+template < class Callback >
+void BasePlasticity_ < Scalar > :: partial_fit (const matrix_t & X, Callback callback)
+{
+  // call the core partial_fit function
+  this->_partial_fit ([&] (const int32_t * indices, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads)
+                      {
+                        this->gather_batch(X, indices, batch_data, n_threads);
+                      },
+                      X.rows(), X.cols(), callback);
+}
+
+template < class Scalar >
+template < class Callback >
+void BasePlasticity_ < Scalar > :: partial_fit (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+  const int64_t & stride, const input_normalization & norm, Callback callback)
+{
+  // call the core partial_fit function
+  // NOTE: the raw values are converted only when gathered into the batch buffer
+  this->_partial_fit ([&] (const int32_t * indices, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads)
+                      {
+                        this->gather_batch(X, stride, indices, norm, batch_data, n_threads);
+                      },
+                      n_samples, n_features, callback);
+}
+
+template < class Scalar >
+template < class Source, class Callback >
+void BasePlasticity_ < Scalar > :: fit_stream (Source & source, const int32_t & n_features, const int32_t & chunk_size,
+  const int32_t & num_epochs, int32_t seed, Callback callback)
+{
+  using chunk_t = Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic, Eigen :: RowMajor >;
+
+  if ( this->resume_point )
+    throw std :: runtime_error("Checkpoint error. The resume of the training is not supported by the fit_stream function");
+
+  // init the weights and the optimizer parameters
+  // NOTE: the chunk size plays the role of the number of samples in the batch size check
+  this->init_training(chunk_size, n_features);
+
+  // Allocate the chunk and batch buffers only once.
+  // The next chunk is loaded by a background worker (started once for
+  // the whole training) while the current one is processed
+  chunk_t chunk (chunk_size, n_features);
+  chunk_t next_chunk (chunk_size, n_features);
+  matrix_t batch_data (n_features, this->batch);
+
+  std :: vector < int32_t > batch_indices(chunk_size);
+
+  int32_t next_rows = 0;
+
+  auto load_next = [&] (const int32_t &)
+                   {
+                     next_rows = source(next_chunk.data(), chunk_size);
+                   };
+
+  // NOTE: the worker is declared after the buffers, so it is joined before their release
+  prefetch_worker < decltype(load_next) > prefetch (load_next);
 
   // init theta as zeros array
-  this->theta = Eigen :: VectorXf :: Zero(this->outputs);
+  this->theta = vector_t :: Zero(this->outputs);
+
+  // allocate the accumulator of the convergence vector
+  array_t sum_theta (this->outputs);
 
   // init the random number generator for the permutation
   std :: mt19937 engine(seed);
 
+  // the convergency can be checked at each batch instead of each epoch
+  const bool batch_convergence = this->convergency_check == convergence_t :: batch_check;
+
+  // start a new trace of the training stages (if enabled)
+  training_profiler * const profiler = this->init_profiler(n_features, true);
+
   // initialize the (possible) parallel environment
   Eigen :: initParallel();
 
+#ifdef _OPENMP
+  // use the same number of threads in the Eigen products
+  Eigen :: setNbThreads(this->num_threads);
+#endif
+
   // start the loop along the epochs
   for (int32_t epoch = 0; epoch < num_epochs; ++epoch)
   {
 
     // set the initial accumulator to zeros
-    // This vector will be check for the estimation
-    // of model convergence at each epoch
-    Eigen :: ArrayXf sum_theta = Eigen :: ArrayXf :: Zero(this->outputs);
-
-#if EIGEN_VERSION_AT_LEAST(3, 3, 90)
-    // Perform an index permutation at each epoch
-    std :: shuffle(batch_indices.begin(), batch_indices.end(), engine);
-    // apply the index permutation on the data
-    Eigen :: MatrixXf X_perm = X(batch_indices, Eigen :: all); // permute rows
+    sum_theta.setZero();
+    int32_t num_batches = 0;
+    bool converged = false;
+
+#ifdef __verbose__
+
+    std :: cout << RESET_COUT << "Epoch " << epoch + 1 << "/" << num_epochs << std :: endl;
+
+#endif // __verbose__
+
+    // load the first chunk of the epoch
+    int32_t n_rows = source(chunk.data(), chunk_size);
+
+    while (n_rows > 0)
+    {
+      // load the next chunk while the current one is processed
+      prefetch.submit(0);
+
+      // Perform an index permutation of the chunk rows
+      std :: iota(batch_indices.begin(), batch_indices.begin() + n_rows, 0);
+      std :: shuffle(batch_indices.begin(), batch_indices.begin() + n_rows, engine);
+
+      // start the evaluation of the batches
+      for (int32_t i = 0; i < n_rows / this->batch; ++i)
+      {
+        if ( profiler )
+          profiler->begin_batch(epoch, num_batches);
+
+        {
+          stage_timer timer (profiler, stage_t :: gather_stage);
+          this->gather_batch(chunk, batch_indices.data() + i * this->batch, batch_data, this->num_threads);
+        }
+
+        // perform the training step on the current batch
+        this->train_batch(batch_data, epoch + 1);
+
+        // update the convergence vector
+        sum_theta += this->theta.array();
+        ++ num_batches;
+
+        {
+          stage_timer timer (profiler, stage_t :: callback_stage);
+          callback(this);
+        }
+
+        // check if the model has reached the convergency at the current batch
+        if ( batch_convergence && this->check_convergence(this->theta.array()) )
+        {
+          converged = true;
+          break;
+        }
+      }
+
+      // wait the next chunk and swap the buffers (no copy)
+      // NOTE: the wait is recorded as gather time of the last batch of the chunk
+      {
+        stage_timer timer (profiler, stage_t :: gather_stage);
+        prefetch.wait();
+        n_rows = next_rows;
+        chunk.swap(next_chunk);
+      }
+
+      if ( converged )
+        break;
+    }
+
+    if ( num_batches == 0 )
+      throw std :: runtime_error("Empty stream found. The source must provide at least a batch of data at each epoch");
+
+    this->iteration = epoch + 1;
+
+    // check if the model has reached the convergency
+    if ( ! batch_convergence )
+      converged = this->check_convergence(sum_theta * (1.f / num_batches));
+
+    if ( converged )
+    {
+
+#ifdef __verbose__
+
+      std :: cout << "Early stopping: the training has reached the convergency criteria" << std :: endl;
+
+#endif // __verbose__
+
+      break;
+    }
+
+  } // end for epoch
+}
+
+template < class Scalar >
+template < class Matrix >
+void BasePlasticity_ < Scalar > :: gather_batch (const Eigen :: MatrixBase < Matrix > & X,
+  const int32_t * indices, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads)
+{
+  const int32_t n_cols = static_cast < int32_t >(batch_data.cols());
+
+  // copy the rows of the batch into the columns of the (pre-allocated) buffer
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads (n_threads) if (n_threads > 1)
 #else
-    std :: shuffle(permutation.indices().data(),
-                   permutation.indices().data() + permutation.indices().size(),
-                   engine);
-    // apply the index permutation on the data
-    Eigen :: MatrixXf X_perm = permutation * X; // permute rows
+  (void)n_threads;
 #endif
+  for (int32_t j = 0; j < n_cols; ++j)
+    batch_data.col(j) = X.row(indices[j]).transpose();
+}
+
+template < class Scalar >
+template < class Gather, class Callback >
+void BasePlasticity_ < Scalar > :: _fit (Gather gather, const int32_t & n_samples, const int32_t & n_features,
+  const int32_t & num_epochs, const int32_t & seed, Callback callback)
+{
+  // compute the number of possible batches
+  const int32_t num_batches = n_samples / this->batch;
+
+  // Build the index permutation generator
+  std :: vector < int32_t > batch_indices(n_samples);
+  std :: iota(batch_indices.begin(), batch_indices.end(), 0);
+
+  // Allocate the batch buffers only once.
+  // The data matrix is never permuted: at each iteration the rows of
+  // the current batch are gathered into the buffer.
+  // With a single thread the next batch is prefetched in the second buffer
+  // by a background worker (started once for the whole training),
+  // otherwise the gather is performed by the thread pool
+  const bool async_prefetch = this->num_threads == 1;
+
+  matrix_t batch_data (n_features, this->batch);
+  matrix_t next_batch (n_features, async_prefetch ? this->batch : 0);
+
+  auto load_next = [&] (const int32_t & i)
+                   {
+                     gather(batch_indices.data() + i * this->batch, next_batch, 1);
+                   };
+
+  // NOTE: the worker is declared after the buffers, so it is joined before their release
+  std :: unique_ptr < prefetch_worker < decltype(load_next) > > prefetch (async_prefetch ?
+    new prefetch_worker < decltype(load_next) >(load_next) : nullptr);
+
+  // allocate the accumulator of the convergence vector
+  array_t sum_theta (this->outputs);
+
+  // init the random number generator for the permutation
+  std :: mt19937 engine(seed);
+
+  // restore the position of an interrupted training (if any)
+  int32_t first_epoch = 0;
+  int32_t first_batch = 0;
+
+  // init theta as zeros array (the resumed one is restored by the checkpoint)
+  if ( ! this->restore_checkpoint(first_epoch, first_batch, batch_indices, engine, sum_theta) )
+    this->theta = vector_t :: Zero(this->outputs);
+
+  // the checkpoints are counted along the whole training
+  const bool checkpoint = this->checkpoint_frequency > 0;
+  const int64_t batch_frequency = this->checkpoint_unit == checkpoint_t :: per_batch ? this->checkpoint_frequency : 0;
+
+  // the convergency can be checked at each batch instead of each epoch
+  const bool batch_convergence = this->convergency_check == convergence_t :: batch_check;
+
+  // start a new trace of the training stages (if enabled)
+  training_profiler * const profiler = this->init_profiler(n_features, true);
+
+  // initialize the (possible) parallel environment
+  Eigen :: initParallel();
+
+#ifdef _OPENMP
+  // use the same number of threads in the Eigen products
+  Eigen :: setNbThreads(this->num_threads);
+#endif
+
+  // start the loop along the epochs
+  for (int32_t epoch = first_epoch; epoch < num_epochs; ++epoch)
+  {
+    // a resumed epoch starts from the stored batch with the stored permutation
+    const int32_t start = epoch == first_epoch ? first_batch : 0;
+
+    if ( start == 0 )
+    {
+      // set the initial accumulator to zeros
+      // This vector will be check for the estimation
+      // of model convergence at each epoch
+      sum_theta.setZero();
+
+      // Perform an index permutation at each epoch
+      std :: shuffle(batch_indices.begin(), batch_indices.end(), engine);
+    }
+
+    if ( profiler )
+      profiler->begin_batch(epoch, start);
+
+    // gather the first batch of the epoch
+    {
+      stage_timer timer (profiler, stage_t :: gather_stage);
+      gather(batch_indices.data() + start * this->batch, batch_data, this->num_threads);
+    }
+
+    bool converged = false;
 
 #ifdef __verbose__
 
@@ -129,26 +396,17 @@ void BasePlasticity :: _fit (const Eigen :: MatrixXf & X, const int32_t & num_ep
 #endif // __verbose__
 
     // start the evaluation of the batches
-    for (int32_t i = 0; i < num_batches; ++i)
+    for (int32_t i = start; i < num_batches; ++i)
     {
 
-      // Get the batch data as block starting from the i*batch row
-      // and the first (0) column with a shape given by (batch_size, num_features)
-      auto batch_data = X_perm.block(i * this->batch, 0, this->batch, n_features);
-
-      // perform the prediction of the model with the current weight matrix
-
-      Eigen :: MatrixXf output = this->_predict(batch_data);
-
-      // compute the gradient of the weights matrix (aka dW)
-      Eigen :: MatrixXf weights_update = this->weights_update(batch_data, output);
+      // prefetch the next batch while the current one is processed
+      const bool prefetched = async_prefetch && i + 1 < num_batches;
 
-      // (eventually) perform a weight decay
-      if (this->decay != 0.f)
-        weights_update -= this->decay * this->weights;
+      if (prefetched)
+        prefetch->submit(i + 1);
 
-      // perform the update of the weights using the properly set optimizer
-      this->optimizer.update(epoch + 1, this->weights, weights_update);
+      // perform the training step on the current batch
+      this->train_batch(batch_data, epoch + 1);
 
       // update the convergence vector
       sum_theta += this->theta.array();
@@ -160,7 +418,45 @@ void BasePlasticity :: _fit (const Eigen :: MatrixXf & X, const int32_t & num_ep
 
 #endif // __verbose__
 
-      callback(this);
+      {
+        stage_timer timer (profiler, stage_t :: callback_stage);
+        callback(this);
+      }
+
+      // check if the model has reached the convergency at the current batch
+      if ( batch_convergence && this->check_convergence(this->theta.array()) )
+      {
+        // complete the pending prefetch before leaving the loop
+        if (prefetched)
+          prefetch->wait();
+
+        converged = true;
+        break;
+      }
+
+      if ( profiler && i + 1 < num_batches )
+        profiler->begin_batch(epoch, i + 1);
+
+      // wait the prefetched batch and swap the buffers (no copy)
+      if (prefetched)
+      {
+        stage_timer timer (profiler, stage_t :: gather_stage);
+        prefetch->wait();
+        batch_data.swap(next_batch);
+      }
+
+      // or gather it in parallel
+      else if (i + 1 < num_batches)
+      {
+        stage_timer timer (profiler, stage_t :: gather_stage);
+        gather(batch_indices.data() + (i + 1) * this->batch, batch_data, this->num_threads);
+      }
+
+      // write a checkpoint inside the epoch
+      // NOTE: the checkpoint of the last batch is written at the end of the epoch
+      if ( checkpoint && batch_frequency && i + 1 < num_batches &&
+           (static_cast < int64_t >(epoch) * num_batches + i + 1) % batch_frequency == 0 )
+        this->save_checkpoint(epoch, i + 1, batch_indices, engine, sum_theta);
 
     } // end for batches
 
@@ -170,8 +466,19 @@ void BasePlasticity :: _fit (const Eigen :: MatrixXf & X, const int32_t & num_ep
 
 #endif // __verbose__
 
+    this->iteration = epoch + 1;
+
     // check if the model has reached the convergency
-    if ( this->check_convergence(sum_theta * (1.f / num_batches)) )
+    if ( ! batch_convergence )
+      converged = this->check_convergence(sum_theta * (1.f / num_batches));
+
+    // write a checkpoint at the end of the epoch (if completed)
+    if ( checkpoint && ! (batch_convergence && converged) && ( batch_frequency ?
+                         (static_cast < int64_t >(epoch + 1) * num_batches) % batch_frequency == 0 :
+                         (epoch + 1) % this->checkpoint_frequency == 0 ) )
+      this->save_checkpoint(epoch + 1, 0, batch_indices, engine, sum_theta);
+
+    if ( converged )
     {
 
 #ifdef __verbose__
@@ -185,6 +492,87 @@ void BasePlasticity :: _fit (const Eigen :: MatrixXf & X, const int32_t & num_ep
 
 
   } // end for epoch
+
+  // complete the last checkpoint
+  this->wait_checkpoint();
+}
+
+template < class Scalar >
+template < class Gather, class Callback >
+void BasePlasticity_ < Scalar > :: _partial_fit (Gather gather, const int32_t & n_samples, const int32_t & n_features, Callback callback)
+{
+  // init (only at the first call) the weights and the optimizer parameters
+  this->init_partial(n_features);
+
+  // the rows are processed in the given order
+  std :: vector < int32_t > indices(n_samples);
+  std :: iota(indices.begin(), indices.end(), 0);
+
+  // append the batches to the trace of the training stages (if enabled)
+  training_profiler * const profiler = this->init_profiler(n_features, false);
+
+  // initialize the (possible) parallel environment
+  Eigen :: initParallel();
+
+#ifdef _OPENMP
+  // use the same number of threads in the Eigen products
+  Eigen :: setNbThreads(this->num_threads);
+#endif
+
+  int32_t first = 0;
+
+  // complete the pending batch of the previous calls
+  if ( this->num_pending > 0 )
+  {
+    first = std :: min(this->batch - this->num_pending, n_samples);
+
+    if ( profiler && this->num_pending + first == this->batch )
+      profiler->begin_batch(0, this->iteration + 1);
+
+    {
+      stage_timer timer (profiler, stage_t :: gather_stage);
+      gather(indices.data(), this->pending.middleCols(this->num_pending, first), this->num_threads);
+    }
+
+    this->num_pending += first;
+
+    if ( this->num_pending < this->batch )
+      return;
+
+    this->train_batch(this->pending, ++ this->iteration);
+    this->num_pending = 0;
+
+    stage_timer timer (profiler, stage_t :: callback_stage);
+    callback(this);
+  }
+
+  // process the whole batches
+  for (; first + this->batch <= n_samples; first += this->batch)
+  {
+    if ( profiler )
+      profiler->begin_batch(0, this->iteration + 1);
+
+    {
+      stage_timer timer (profiler, stage_t :: gather_stage);
+      gather(indices.data() + first, this->pending, this->num_threads);
+    }
+
+    // perform the training step on the current batch
+    this->train_batch(this->pending, ++ this->iteration);
+
+    stage_timer timer (profiler, stage_t :: callback_stage);
+    callback(this);
+  }
+
+  // store the remaining rows for the next call
+  // NOTE: their gather is recorded with the last batch (if any)
+  this->num_pending = n_samples - first;
+
+  if ( this->num_pending > 0 )
+  {
+    stage_timer timer (profiler, stage_t :: gather_stage);
+    gather(indices.data() + first, this->pending.leftCols(this->num_pending), this->num_threads);
+  }
 }
 
 
@@ -0,0 +1,239 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __bcm_hpp__
+#define __bcm_hpp__
+
+#include <bcm.h>
+#include <activations.hpp>
+#include <optimizer.hpp>
+
+template < class Scalar >
+template < class Function >
+void BCM_ < Scalar > :: forward_tiles (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output,
+  Function activation, const bool & square_sums)
+{
+  // NOTE: the (cached) forward matrix is evaluated before the parallel section
+  const Eigen :: Map < const matrix_t > w = this->forward_weights();
+
+  const int32_t n_rows = static_cast < int32_t >(output.rows());
+  const int32_t n_cols = static_cast < int32_t >(output.cols());
+  const int32_t n_row_blocks = (n_rows + this->tile_rows - 1) / this->tile_rows;
+  const int32_t n_tiles = (n_cols + this->tile_size - 1) / this->tile_size;
+  const int32_t n_blocks = n_row_blocks * n_tiles;
+
+  // the columns of a tile are contiguous only if the tile covers the whole
+  // columns and there is no padding between them
+  const bool contiguous = n_row_blocks == 1 && output.outerStride() == n_rows;
+
+  // with less tiles than threads the parallelism is left to the (Eigen) product
+  // NOTE: the tiles of the same block of rows are consecutive, so the static
+  // schedule gives to each thread (mostly) the same block of the forward matrix
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads (this->num_threads) if (this->num_threads > 1 && n_blocks >= this->num_threads)
+#endif
+  for (int32_t b = 0; b < n_blocks; ++b)
+  {
+    const int32_t r = (b / n_tiles) * this->tile_rows;
+    const int32_t t = b % n_tiles;
+
+    const int32_t rows = std :: min(this->tile_rows, n_rows - r);
+    const int32_t first = t * this->tile_size;
+    const int32_t len = std :: min(this->tile_size, n_cols - first);
+
+    auto y = output.block(r, first, rows, len);
+    y.noalias() = w.middleRows(r, rows) * data.middleCols(first, len);
+
+    // apply the activation while the tile is still in cache
+    if (contiguous)
+      activation(y.data(), len * n_rows);
+    else
+      for (int32_t i = 0; i < len; ++i)
+        activation(y.col(i).data(), rows);
+
+    if (square_sums)
+      this->tile_theta.col(t).segment(r, rows) = y.array().square().rowwise().sum();
+  }
+}
+
+template < class Scalar >
+template < class Function >
+void BCM_ < Scalar > :: fused_update_into (const matrix_t & X, matrix_t & weights_update, Function activation)
+{
+  // evaluate the output and the squared sums of the tiles in a single pass
+  this->forward_tiles(X, this->batch_output, activation, true);
+
+  const int32_t n_tiles = (static_cast < int32_t >(X.cols()) + this->tile_size - 1) / this->tile_size;
+
+  // evaluate the theta array as the average of the output rows
+  this->batch_theta = this->tile_theta.leftCols(n_tiles).rowwise().sum() * (1.f / X.cols());
+
+  this->law_cooper_update_into(X, this->batch_output, weights_update);
+}
+
+
+/**
+* @class BCMModel
+*
+* @brief BCM model specialized at compile time.
+*
+* @details The activation function and the optimization algorithm are
+* given as policies (e.g. BCMModel < transfer :: Logistic, optimizer :: Adam >),
+* so the forward activation and the weights update are inlined in the model
+* kernels instead of being called through the runtime dispatch.
+* The learning rule and all the other members are inherited by the BCM class,
+* which remains the (type-erased) front end for the runtime parameters.
+*
+* @tparam Activation Activation policy of the transfer namespace.
+* @tparam Optimizer Optimization policy of the optimizer namespace.
+* @tparam Scalar Type of the weights (float or double).
+*
+*/
+template < class Activation, class Optimizer, class Scalar = float >
+class BCMModel : public BCM_ < Scalar >
+{
+
+public:
+
+  using matrix_t = typename BCM_ < Scalar > :: matrix_t; ///< matrix of the model values
+
+  // Constructor
+
+  /**
+  * @brief Construct the object using the list of training parameters.
+  *
+  * @details The parameters are the same of the BCM class, except for
+  * the activation function which is given by the template policy.
+  *
+  * @param outputs Number of hidden units.
+  * @param batch_size Size of the minibatch.
+  * @param optimizer update_args Optimizer object (its type must match the Optimizer policy).
+  * @param weights_init weights_initialization object (default=uniform initialization in [-1, 1]).
+  * @param epochs_for_convergency Number of stable epochs requested for the convergency.
+  * @param convergency_atol Absolute tolerance requested for the convergency.
+  * @param decay Weight decay scale factor.
+  * @param memory_factor Memory factor for weighting the theta updates.
+  * @param interaction_strength Set the lateral interaction strength between weights.
+  *
+  */
+  BCMModel (const int32_t & outputs, const int32_t & batch_size,
+    update_args optimizer=update_args(Optimizer :: type),
+    weights_initialization weights_init=weights_initialization(weights_init_t :: normal),
+    int32_t epochs_for_convergency=1, float convergency_atol=0.01f,
+    float decay=0.f, float memory_factor=0.5f,
+    float interaction_strength=0.f
+    ) : BCM_ < Scalar > (outputs, batch_size, Activation :: type, optimizer,
+             weights_init, epochs_for_convergency, convergency_atol,
+             decay, memory_factor, interaction_strength)
+  {
+    if ( optimizer.type != Optimizer :: type )
+      throw std :: runtime_error("Invalid optimizer found. The update_args type (" + std :: to_string(optimizer.type) + ") must match the Optimizer policy (" + std :: to_string(Optimizer :: type) + ")");
+  }
+
+  // Destructor
+
+  /**
+  * @brief Destructor.
+  *
+  * @details Completely delete the object and release the memory of the arrays.
+  *
+  */
+  ~BCMModel () = default;
+
+protected:
+
+  /**
+  * @brief Core function of the predict formula
+  *
+  * @note The output is computed by the blocked forward kernel
+  * of the BCM class, with the activation policy inlined on the output tiles.
+  *
+  * @param data Input matrix of data (n_features, n_samples).
+  * @param output Output matrix of the model.
+  *
+  */
+  void _predict_into (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output)
+  {
+    this->forward_tiles(data, output, Activation :: template activate < Scalar >, false);
+  }
+
+  /**
+  * @brief Compute the output of the model and the weights update of a training step.
+  *
+  * @note The activation policy is inlined in the blocked forward kernel.
+  *
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  *
+  */
+  void forward_update_into (const matrix_t & X, matrix_t & weights_update)
+  {
+    this->fused_update_into(X, weights_update, Activation :: template activate < Scalar >);
+  }
+
+  /**
+  * @brief Apply the optimizer policy to the weights using the current weights update.
+  *
+  * @param iteration Current iteration number (epoch) used by the optimizer.
+  *
+  */
+  void optimizer_step (const int32_t & iteration)
+  {
+    this->optimizer.template update < Optimizer, Scalar >(iteration, this->weights, this->batch_update, this->num_threads);
+  }
+
+  /**
+  * @brief Restore the hyperparameters and the arrays of the model.
+  *
+  * @details The file replaces the optimizer (and the activation) of the model,
+  * so the stored types must match the policies given at compile time, otherwise
+  * the inlined kernels would run on the state of a different algorithm.
+  *
+  * @note The types are checked before any member is modified, so on a mismatch
+  * the model is left unchanged.
+  *
+  * @param file Model file.
+  *
+  */
+  void load_state (const model_file :: reader & file)
+  {
+    const int32_t optimizer_type = file.get < int32_t >("optimizer.type");
+    const int32_t activation_type = file.get < int32_t >("activation");
+
+    if ( optimizer_type != Optimizer :: type )
+      throw std :: runtime_error("Invalid model file. The stored optimizer type (" + std :: to_string(optimizer_type) + ") must match the Optimizer policy (" + std :: to_string(Optimizer :: type) + ")");
+
+    if ( activation_type != Activation :: type )
+      throw std :: runtime_error("Invalid model file. The stored activation type (" + std :: to_string(activation_type) + ") must match the Activation policy (" + std :: to_string(Activation :: type) + ")");
+
+    BCM_ < Scalar > :: load_state(file);
+  }
+
+};
+
+#endif // __bcm_hpp__
@@ -0,0 +1,420 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __optimizer_hpp__
+#define __optimizer_hpp__
+
+#include <optimizer.h>
+
+#include <type_traits> // std :: is_same
+
+namespace optimizer
+{
+
+  template < class Scalar >
+  using block_t = Eigen :: Map < Eigen :: Array < Scalar, Eigen :: Dynamic, 1 > >;        ///< view of a block of a parameter array
+
+  template < class Scalar >
+  using cblock_t = Eigen :: Map < const Eigen :: Array < Scalar, Eigen :: Dynamic, 1 > >; ///< view of a block of the gradient array
+
+  // Optimization algorithms as compile-time policies.
+  // Each policy exposes the type identifier, the supporting arrays used
+  // by the algorithm, the step size of the current iteration and the
+  // kernel which updates a block of the arrays, so it can be inlined in the update loop
+
+  /**
+  * @brief Adam optimization policy.
+  *
+  * @details m is the first moment and v is the second moment.
+  *
+  */
+  struct Adam
+  {
+    static constexpr int32_t type = optimizer_t :: adam; ///< optimizer type
+    static constexpr bool use_m = true;                  ///< the first supporting array is used
+    static constexpr bool use_v = true;                  ///< the second supporting array is used
+    static constexpr bool squared_m = false;             ///< the first supporting array stores squared values
+    static constexpr bool squared_v = true;              ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t & iteration)
+    {
+      // learning rate corrected by the moment bias
+      return args.learning_rate * math :: sqrt(1.f - math :: pow(args.B2, iteration)) / (1.f - math :: pow(args.B1, iteration));
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args & args, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar > m, block_t < Scalar > v)
+    {
+      m = m * args.B1 + (1.f - args.B1) * dw;
+      v = v * args.B2 + (1.f - args.B2) * dw.square();
+
+      w -= step * m / (v.sqrt() + static_cast < Scalar >(update_args :: epsil));
+    }
+  };
+
+  /**
+  * @brief Momentum optimization policy.
+  *
+  * @details v is the velocity.
+  *
+  */
+  struct Momentum
+  {
+    static constexpr int32_t type = optimizer_t :: momentum; ///< optimizer type
+    static constexpr bool use_m = false;                     ///< the first supporting array is used
+    static constexpr bool use_v = true;                      ///< the second supporting array is used
+    static constexpr bool squared_m = false;                 ///< the first supporting array stores squared values
+    static constexpr bool squared_v = false;                 ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t &)
+    {
+      return args.learning_rate;
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args & args, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar >, block_t < Scalar > v)
+    {
+      v = args.momentum * v - step * dw;
+      w += v;
+    }
+  };
+
+  /**
+  * @brief Nesterov momentum optimization policy.
+  *
+  * @details v is the velocity.
+  *
+  */
+  struct NesterovMomentum
+  {
+    static constexpr int32_t type = optimizer_t :: nesterov_momentum; ///< optimizer type
+    static constexpr bool use_m = false;                              ///< the first supporting array is used
+    static constexpr bool use_v = true;                               ///< the second supporting array is used
+    static constexpr bool squared_m = false;                          ///< the first supporting array stores squared values
+    static constexpr bool squared_v = false;                          ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t &)
+    {
+      return args.learning_rate;
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args & args, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar >, block_t < Scalar > v)
+    {
+      v = args.momentum * v - step * dw;
+      w += args.momentum * v - step * dw;
+    }
+  };
+
+  /**
+  * @brief AdaGrad optimization policy.
+  *
+  * @details v stores the squared gradients.
+  *
+  */
+  struct AdaGrad
+  {
+    static constexpr int32_t type = optimizer_t :: adagrad; ///< optimizer type
+    static constexpr bool use_m = false;                    ///< the first supporting array is used
+    static constexpr bool use_v = true;                     ///< the second supporting array is used
+    static constexpr bool squared_m = false;                ///< the first supporting array stores squared values
+    static constexpr bool squared_v = true;                 ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t &)
+    {
+      return args.learning_rate;
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args &, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar >, block_t < Scalar > v)
+    {
+      v = dw.square();
+      w -= step * dw / (v.sqrt() + static_cast < Scalar >(update_args :: epsil));
+    }
+  };
+
+  /**
+  * @brief RMSProp optimization policy.
+  *
+  * @details v is the moving average of the squared gradients.
+  *
+  */
+  struct RMSProp
+  {
+    static constexpr int32_t type = optimizer_t :: rmsprop; ///< optimizer type
+    static constexpr bool use_m = false;                    ///< the first supporting array is used
+    static constexpr bool use_v = true;                     ///< the second supporting array is used
+    static constexpr bool squared_m = false;                ///< the first supporting array stores squared values
+    static constexpr bool squared_v = true;                 ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t &)
+    {
+      return args.learning_rate;
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args & args, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar >, block_t < Scalar > v)
+    {
+      v = args.rho * v + (1.f - args.rho) * dw.square();
+      w -= step * dw / (v.sqrt() + static_cast < Scalar >(update_args :: epsil));
+    }
+  };
+
+  /**
+  * @brief AdaDelta optimization policy.
+  *
+  * @details m is the moving average of the squared updates and
+  * v is the moving average of the squared gradients.
+  *
+  */
+  struct AdaDelta
+  {
+    static constexpr int32_t type = optimizer_t :: adadelta; ///< optimizer type
+    static constexpr bool use_m = true;                      ///< the first supporting array is used
+    static constexpr bool use_v = true;                      ///< the second supporting array is used
+    static constexpr bool squared_m = true;                  ///< the first supporting array stores squared values
+    static constexpr bool squared_v = true;                  ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t &)
+    {
+      return args.learning_rate;
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args & args, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar > m, block_t < Scalar > v)
+    {
+      v = args.rho * v + (1.f - args.rho) * dw.square();
+
+      // NOTE: the update uses the previous value of m, so the weights are updated before it
+      const auto update = dw * (m.sqrt() + static_cast < Scalar >(update_args :: epsil)) / (v.sqrt() + static_cast < Scalar >(update_args :: epsil));
+
+      w -= step * update;
+      m = args.rho * m + (1.f - args.rho) * update.square();
+    }
+  };
+
+  /**
+  * @brief AdaMax optimization policy.
+  *
+  * @details m is the first moment and v is the infinity norm.
+  *
+  */
+  struct AdaMax
+  {
+    static constexpr int32_t type = optimizer_t :: adamax; ///< optimizer type
+    static constexpr bool use_m = true;                    ///< the first supporting array is used
+    static constexpr bool use_v = true;                    ///< the second supporting array is used
+    static constexpr bool squared_m = false;               ///< the first supporting array stores squared values
+    static constexpr bool squared_v = false;               ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t & iteration)
+    {
+      // learning rate corrected by the moment bias
+      return args.learning_rate / (1.f - math :: pow(args.B1, iteration));
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args & args, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar > m, block_t < Scalar > v)
+    {
+      m = m * args.B1 + (1.f - args.B1) * dw;
+      v = dw.abs().max(args.B2 * v);
+
+      w -= step * m / (v + static_cast < Scalar >(update_args :: epsil));
+    }
+  };
+
+  /**
+  * @brief Stochastic Gradient Descent optimization policy.
+  *
+  */
+  struct SGD
+  {
+    static constexpr int32_t type = optimizer_t :: sgd; ///< optimizer type
+    static constexpr bool use_m = false;                ///< the first supporting array is used
+    static constexpr bool use_v = false;                ///< the second supporting array is used
+    static constexpr bool squared_m = false;            ///< the first supporting array stores squared values
+    static constexpr bool squared_v = false;            ///< the second supporting array stores squared values
+
+    static inline float step (const update_args & args, const int32_t &)
+    {
+      return args.learning_rate;
+    }
+
+    template < class Scalar >
+    static inline void update (const update_args &, const Scalar & step, block_t < Scalar > w, cblock_t < Scalar > dw, block_t < Scalar >, block_t < Scalar >)
+    {
+      w -= step * dw;
+    }
+  };
+
+} // end namespace optimizer
+
+
+template < class Policy, class Scalar >
+void update_args :: update ( const int32_t & iteration, Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights,
+  const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights_update, const int32_t & n_threads )
+{
+  using block_t = optimizer :: block_t < Scalar >;
+  using cblock_t = optimizer :: cblock_t < Scalar >;
+
+  const int64_t num_weights = this->num_states();
+
+  if ( num_weights != weights.size() )
+    throw std :: runtime_error("Invalid number of weights found. Given " + std :: to_string(weights.size()) + ". Aspected " + std :: to_string(num_weights));
+
+  const Scalar step = static_cast < Scalar >(Policy :: step(*this, iteration));
+
+  // all the arrays share the same (contiguous) layout, so the elementwise
+  // update can be performed block by block in a single pass over the memory
+  const int32_t size = static_cast < int32_t >(weights.size());
+  const int32_t num_blocks = (size + update_args :: block_size - 1) / update_args :: block_size;
+
+  Scalar * w = weights.data();
+  const Scalar * dw = weights_update.data();
+
+  // the kernel works in place on the supporting arrays only if they are stored in the weights precision
+  Scalar * m = nullptr;
+  Scalar * v = nullptr;
+
+  if constexpr ( std :: is_same < Scalar, double > :: value )
+  {
+    m = this->m_double.data();
+    v = this->v_double.data();
+  }
+  else
+  {
+    m = this->m.data();
+    v = this->v.data();
+  }
+
+  const int32_t native = std :: is_same < Scalar, double > :: value ? state_precision_t :: float64 : state_precision_t :: float32;
+  const bool direct = this->state_precision == native;
+
+  // NOTE: the arrays of squared values are never stored as float16 (see array_precision)
+  const int32_t m_precision = this->array_precision(Policy :: squared_m);
+  const int32_t v_precision = this->array_precision(Policy :: squared_v);
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads (n_threads) if (n_threads > 1)
+#else
+  (void)n_threads;
+#endif
+  for (int32_t b = 0; b < num_blocks; ++b)
+  {
+    const int32_t offset = b * update_args :: block_size;
+    const int32_t len = std :: min(update_args :: block_size, size - offset);
+
+    if ( direct )
+    {
+      Policy :: update(*this, step, block_t(w + offset, len), cblock_t(dw + offset, len),
+                                    block_t(m + offset, len), block_t(v + offset, len));
+      continue;
+    }
+
+    // expand the block of the supporting arrays into (cached) buffers
+    // NOTE: the arrays unused by the algorithm are not converted
+    alignas(64) Scalar m_block[update_args :: block_size];
+    alignas(64) Scalar v_block[update_args :: block_size];
+
+    if (Policy :: use_m) this->load_block(true, offset, m_block, len, m_precision);
+    if (Policy :: use_v) this->load_block(false, offset, v_block, len, v_precision);
+
+    Policy :: update(*this, step, block_t(w + offset, len), cblock_t(dw + offset, len),
+                                  block_t(m_block, len), block_t(v_block, len));
+
+    if (Policy :: use_m) this->store_block(true, m_block, offset, len, m_precision);
+    if (Policy :: use_v) this->store_block(false, v_block, offset, len, v_precision);
+  }
+
+  this->decay_learning_rate(iteration);
+}
+
+template < class Scalar >
+void update_args :: load_block ( const bool & first, const int32_t & offset, Scalar * out, const int32_t & n, const int32_t & format ) const
+{
+  switch ( format )
+  {
+    case state_precision_t :: float32:
+    {
+      const float * x = (first ? this->m : this->v).data() + offset;
+      std :: copy(x, x + n, out);
+    } break;
+    case state_precision_t :: float64:
+    {
+      const double * x = (first ? this->m_double : this->v_double).data() + offset;
+      std :: transform(x, x + n, out, [] (const double & xi) { return static_cast < Scalar >(xi); });
+    } break;
+    default:
+    {
+      const uint16_t * x = (first ? this->m_half : this->v_half).data() + offset;
+
+      if constexpr ( std :: is_same < Scalar, float > :: value )
+        update_args :: load_state(x, out, n, format);
+      else
+      {
+        // NOTE: the 16 bit values are exactly represented by the float buffer
+        alignas(64) float buffer[update_args :: block_size];
+        update_args :: load_state(x, buffer, n, format);
+        std :: copy(buffer, buffer + n, out);
+      }
+    } break;
+  }
+}
+
+template < class Scalar >
+void update_args :: store_block ( const bool & first, const Scalar * x, const int32_t & offset, const int32_t & n, const int32_t & format )
+{
+  switch ( format )
+  {
+    case state_precision_t :: float32:
+    {
+      float * out = (first ? this->m : this->v).data() + offset;
+      std :: transform(x, x + n, out, [] (const Scalar & xi) { return static_cast < float >(xi); });
+    } break;
+    case state_precision_t :: float64:
+    {
+      double * out = (first ? this->m_double : this->v_double).data() + offset;
+      std :: copy(x, x + n, out);
+    } break;
+    default:
+    {
+      uint16_t * out = (first ? this->m_half : this->v_half).data() + offset;
+
+      if constexpr ( std :: is_same < Scalar, float > :: value )
+        update_args :: store_state(x, out, n, format);
+      else
+      {
+        alignas(64) float buffer[update_args :: block_size];
+        std :: transform(x, x + n, buffer, [] (const Scalar & xi) { return static_cast < float >(xi); });
+        update_args :: store_state(buffer, out, n, format);
+      }
+    } break;
+  }
+}
+
+#endif // __optimizer_hpp__
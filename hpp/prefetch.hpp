@@ -0,0 +1,111 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __prefetch_hpp__
+#define __prefetch_hpp__
+
+#include <prefetch.h>
+
+template < class Task >
+prefetch_worker < Task > :: prefetch_worker (Task task) : task (task), arg (0), pending (false), stop (false), error (nullptr)
+{
+  // NOTE: the thread is started when all the members are initialized
+  this->worker = std :: thread(& prefetch_worker < Task > :: run, this);
+}
+
+template < class Task >
+prefetch_worker < Task > :: ~prefetch_worker ()
+{
+  {
+    std :: lock_guard < std :: mutex > lock (this->mtx);
+    this->stop = true;
+  }
+
+  this->ready.notify_all();
+  this->worker.join();
+}
+
+template < class Task >
+void prefetch_worker < Task > :: submit (const int32_t & arg)
+{
+  {
+    std :: lock_guard < std :: mutex > lock (this->mtx);
+    this->arg = arg;
+    this->pending = true;
+  }
+
+  this->ready.notify_all();
+}
+
+template < class Task >
+void prefetch_worker < Task > :: wait ()
+{
+  std :: unique_lock < std :: mutex > lock (this->mtx);
+  this->ready.wait(lock, [this] { return ! this->pending; });
+
+  if ( this->error )
+    std :: rethrow_exception(std :: exchange(this->error, nullptr));
+}
+
+template < class Task >
+void prefetch_worker < Task > :: run ()
+{
+  std :: unique_lock < std :: mutex > lock (this->mtx);
+
+  while ( true )
+  {
+    this->ready.wait(lock, [this] { return this->stop || this->pending; });
+
+    if ( this->stop )
+      break;
+
+    const int32_t current = this->arg;
+
+    // run the task without holding the lock
+    lock.unlock();
+
+    std :: exception_ptr error = nullptr;
+
+    try
+    {
+      this->task(current);
+    }
+    catch (...)
+    {
+      error = std :: current_exception();
+    }
+
+    lock.lock();
+
+    this->error = error;
+    this->pending = false;
+    this->ready.notify_all();
+  }
+}
+
+#endif // __prefetch_hpp__
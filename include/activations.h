@@ -33,6 +33,7 @@
 
 #include <unordered_map> // std :: unordered_map
 #include <functional>    // std :: function
+#include <Eigen/Dense>   // Eigen :: Array (vectorized functions)
 
 
 enum transfer_t { logistic = 0, loggy, relu,
@@ -637,11 +638,16 @@ namespace transfer
   * (returned as pointer to function) starting from its "name" in the enum.
   * If the input integer is not in the enum range a nullptr is returned.
   *
+  * The double precision functions evaluate the batched version on the single value.
+  *
   * @param active Integer from the enum activation types.
   *
+  * @tparam Scalar Type of the values (float or double).
+  *
   * @return Pointer to the desired function.
   */
-  std :: function < float(const float &) > activate ( const int32_t & active );
+  template < class Scalar = float >
+  std :: function < Scalar(const Scalar &) > activate ( const int32_t & active );
   /**
   * @brief Switch case between gradient functions.
   *
@@ -649,11 +655,58 @@ namespace transfer
   * (returned as pointer to function) starting from its "name" in the enum.
   * If the input integer is not in the enum range a nullptr is returned.
   *
+  * The double precision functions evaluate the batched version on the single value.
+  *
   * @param active Integer from the enum activation types.
   *
+  * @tparam Scalar Type of the values (float or double).
+  *
   * @return Pointer to the desired function.
   */
-  std :: function < float(const float &) > gradient ( const int32_t & active );
+  template < class Scalar = float >
+  std :: function < Scalar(const Scalar &) > gradient ( const int32_t & active );
+
+  template < >
+  std :: function < float(const float &) > activate < float > ( const int32_t & active );
+
+  template < >
+  std :: function < float(const float &) > gradient < float > ( const int32_t & active );
+
+  /**
+  * @brief Switch case between batched activation functions.
+  *
+  * @details This function is used to set the desired activation function
+  * applied in-place to a whole buffer of values. The returned function is
+  * written in terms of Eigen array expressions, so it is vectorized according
+  * to the available instruction set (SSE/AVX2/AVX-512) with a scalar fallback.
+  * The selection should be performed only once, avoiding the per-element call
+  * of the scalar version.
+  * If the input integer is not in the enum range a nullptr is returned.
+  *
+  * @param active Integer from the enum activation types.
+  *
+  * @tparam Scalar Type of the buffer values (float or double).
+  *
+  * @return Pointer to the desired function with signature (buffer, size).
+  */
+  template < class Scalar = float >
+  std :: function < void(Scalar *, const int32_t &) > activate_array ( const int32_t & active );
+  /**
+  * @brief Switch case between batched gradient functions.
+  *
+  * @details This function is used to set the desired gradient function
+  * applied in-place to a whole buffer of values.
+  * The same considerations of the activate_array function hold.
+  * If the input integer is not in the enum range a nullptr is returned.
+  *
+  * @param active Integer from the enum activation types.
+  *
+  * @tparam Scalar Type of the buffer values (float or double).
+  *
+  * @return Pointer to the desired function with signature (buffer, size).
+  */
+  template < class Scalar = float >
+  std :: function < void(Scalar *, const int32_t &) > gradient_array ( const int32_t & active );
 
 }
 
@@ -32,19 +32,33 @@
 #include <activations.h>
 #include <optimizer.h>
 #include <weights.h>
+#include <normalization.h>
+#include <quantized.h>
+#include <model_file.h>
+#include <convergence.h>
+#include <profiler.h>
+#include <prefetch.hpp>
 #include <utils.hpp>
 
 #include <memory>
-#include <deque>
 #include <fstream>
 #include <algorithm>
 #include <numeric>
 #include <utility>
+#include <vector>
+#include <future>
+#include <cstdio>
 
 #include <iostream>
 
 #include <Eigen/Dense>
 
+#ifdef _OPENMP
+
+  #include <omp.h>
+
+#endif
+
 #if EIGEN_VERSION_AT_LEAST(3, 3, 90)
 
   #include <Eigen/Core> // Eigen :: all slicing
@@ -52,6 +66,19 @@
 #endif
 
 
+/**
+* @brief Unit of the checkpoint frequency
+*
+*/
+enum checkpoint_t { per_epoch = 0, per_batch };
+
+/**
+* @brief Frequency of the convergency check (early stopping)
+*
+*/
+enum convergence_t { epoch_check = 0, batch_check };
+
+
 /**
 * @class BasePlasticity
 * @brief Abstract type representing an encoder model, i.e. a neural network
@@ -60,41 +87,84 @@
 *
 * @details This class is the base class for specialized models.
 * The derived classes have to implement an appropriated version of
-* the private member function "weights_update", i.e. the function
-* responsibles for the update of the weights matrix.
+* the private member functions "weights_update_into", i.e. the function
+* responsibles for the update of the weights matrix, and "_predict_into".
+* Both the functions work on pre-allocated buffers (workspace) which are
+* sized only once at the beginning of the training by the "init_workspace"
+* member, so the training loop does not perform any allocation.
 * A second member which could be specialized is the "normalize_weights"
 * private member which is responsible of the normalization of the weights
 * matrix **before** the fit function.
 *
+* @note The model is generic over the scalar type of the weights and of all the
+* learning parameters (theta, optimizer moments, activations), with explicit
+* instantiations for float (BasePlasticity) and double, e.g. for the convergence
+* studies. The reduced precision storage of the optimizer moments is given by
+* the state precision of the update_args object.
+*
+* @tparam Scalar Type of the weights (float or double).
+*
 */
-class BasePlasticity
+template < class Scalar >
+class BasePlasticity_
 {
 
+public:
+
+  using scalar_t = Scalar;                                                          ///< type of the model values
+  using matrix_t = Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic >;  ///< matrix of the model values
+  using vector_t = Eigen :: Matrix < Scalar, Eigen :: Dynamic, 1 >;                 ///< column vector of the model values
+  using array_t = Eigen :: Array < Scalar, Eigen :: Dynamic, 1 >;                   ///< array of the model values
+
 protected:
 
   update_args optimizer;                 ///< optimizer object
   weights_initialization w_init;         ///< weights initialization object
 
-public:
-
-  Eigen :: MatrixXf weights;             ///< array-matrix of weights
+  matrix_t weights;                      ///< array-matrix of weights (modified only by the training and by set_weights)
 
-protected:
+  convergence_window_ < Scalar > history;                 ///< sliding window for the convergency monitoring
+  vector_t theta;                             ///< array of means
 
-  std :: deque < Eigen :: ArrayXf > history; ///< deque for the convergency monitoring
-  Eigen :: VectorXf theta;                    ///< array of means
+  std :: function < Scalar(const Scalar &) > activation; ///< pointer to activation function
+  std :: function < Scalar(const Scalar &) > gradient;   ///< pointer to gradient function
 
-  std :: function < float(const float &) > activation; ///< pointer to activation function
-  std :: function < float(const float &) > gradient;   ///< pointer to gradient function
+  std :: function < void(Scalar *, const int32_t &) > batch_activation; ///< pointer to vectorized activation function
+  std :: function < void(Scalar *, const int32_t &) > batch_gradient;   ///< pointer to vectorized gradient function
 
   int32_t batch;                  ///< batch size
   int32_t outputs;                ///< number of hidden units
   int32_t epochs_for_convergency; ///< number of stable epochs requested for the convergency
+  int32_t convergency_check;      ///< frequency of the convergency check (convergence_t)
 
   float convergency_atol;     ///< Absolute tolerance requested for the convergency
   float decay;                ///< Weight decay scale factor
 
-  static float precision;     ///< Parameter that controls numerical precision of the weight updates.
+  static Scalar precision;    ///< Parameter that controls numerical precision of the weight updates.
+
+  matrix_t batch_output;         ///< workspace of the model output (outputs, batch)
+  matrix_t batch_update;         ///< workspace of the weights update (outputs, n_features)
+
+  int64_t weights_version; ///< counter of the weights modifications (used to invalidate cached matrices)
+  int32_t iteration;       ///< last iteration given to the optimizer (epoch of the fit or batch of the partial_fit)
+
+  matrix_t pending;          ///< rows of the partial_fit which do not fill a batch yet (n_features, batch)
+  int32_t num_pending;       ///< number of valid columns of the pending buffer
+
+  int32_t num_threads; ///< number of threads used by the parallel sections (OpenMP)
+
+  int32_t activation_type; ///< index of the activation function
+
+  std :: shared_ptr < model_file :: reader > mapping; ///< read-only mapped model file which stores the weights (load_mmap)
+
+  std :: string checkpoint_file;                     ///< filename of the training checkpoints (empty = disabled)
+  int32_t checkpoint_frequency;                      ///< number of epochs (or batches) between two checkpoints
+  int32_t checkpoint_unit;                           ///< unit of the checkpoint frequency (checkpoint_t)
+  std :: future < void > checkpoint_task;            ///< background task which writes the last checkpoint
+  std :: unique_ptr < model_file :: reader > resume_point; ///< checkpoint restored by the next fit call (resume)
+
+  bool profiling;              ///< record the timing of the training stages
+  training_profiler profiler;  ///< per batch timing of the training stages
 
 public:
 
@@ -105,7 +175,7 @@ public:
   * @brief Default constructor.
   *
   */
-  BasePlasticity ();
+  BasePlasticity_ ();
 
   /**
   * @brief Construct the object using the list of training parameters.
@@ -125,7 +195,7 @@ public:
   * @param decay Weight decay scale factor.
   *
   */
-  BasePlasticity (const int32_t & outputs, const int32_t & batch_size,
+  BasePlasticity_ (const int32_t & outputs, const int32_t & batch_size,
     int32_t activation=transfer_t :: linear,
     update_args optimizer=update_args(optimizer_t :: sgd),
     weights_initialization weights_init=weights_initialization(weights_init_t :: normal),
@@ -144,7 +214,7 @@ public:
   * @param b BasePlasticity object
   *
   */
-  BasePlasticity (const BasePlasticity & b);
+  BasePlasticity_ (const BasePlasticity_ & b);
 
   /**
   * @brief Copy operator.
@@ -156,7 +226,7 @@ public:
   * @param b BasePlasticity object
   *
   */
-  BasePlasticity & operator = (const BasePlasticity & b);
+  BasePlasticity_ & operator = (const BasePlasticity_ & b);
 
   // Destructor
 
@@ -166,7 +236,7 @@ public:
   * @details Completely delete the object and release the memory of the arrays.
   *
   */
-  ~BasePlasticity () = default;
+  ~BasePlasticity_ () = default;
 
   // Public members
 
@@ -192,9 +262,9 @@ public:
   * @tparam Callback void lambda function which can use member variables.
   *
   */
-  template < class Callback = std :: function < void (BasePlasticity *) > >
-  void fit (float * X, const int & n_samples, const int & n_features, const int & num_epochs,
-    int seed=42, Callback callback=[](BasePlasticity *) -> void {});
+  template < class Callback = std :: function < void (BasePlasticity_ *) > >
+  void fit (Scalar * X, const int & n_samples, const int & n_features, const int & num_epochs,
+    int seed=42, Callback callback=[](BasePlasticity_ *) -> void {});
 
   /**
   * @brief Train the model/encoder
@@ -209,9 +279,128 @@ public:
   * @tparam Callback void lambda function which can use member variables.
   *
   */
-  template < class Callback = std :: function < void (BasePlasticity *) > >
-  void fit (const Eigen :: MatrixXf & X, const int & num_epochs,
-    int32_t seed=42, Callback callback=[](BasePlasticity *) -> void {});
+  template < class Callback = std :: function < void (BasePlasticity_ *) > >
+  void fit (const matrix_t & X, const int & num_epochs,
+    int32_t seed=42, Callback callback=[](BasePlasticity_ *) -> void {});
+
+  /**
+  * @brief Train the model/encoder on raw (uint8_t) data
+  *
+  * @details The raw values are converted into floating point values on the fly,
+  * during the gather of each batch, according to the given normalization,
+  * so the floating point copy of the whole dataset is never stored.
+  *
+  * @param X array in ravel format of the input variables/features
+  * @param n_samples dimension of the X matrix, i.e. the number of rows
+  * @param n_features dimension of the X matrix, i.e. the number of cols
+  * @param stride Distance (in bytes) between the beginning of consecutive rows (n_features for packed rows).
+  * @param norm Normalization of the raw values.
+  * @param num_epochs Number of epochs for model convergency.
+  * @param seed Random seed number for the batch subdivisions.
+  * @param callback Callback function to call at each batch evaluation.
+  *
+  * @tparam Callback void lambda function which can use member variables.
+  *
+  */
+  template < class Callback = std :: function < void (BasePlasticity_ *) > >
+  void fit (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+    const int64_t & stride, const input_normalization & norm, const int32_t & num_epochs,
+    int32_t seed=42, Callback callback=[](BasePlasticity_ *) -> void {});
+
+  /**
+  * @brief Train the model/encoder on a stream of data
+  *
+  * @details The training data are provided by a chunked source, so the
+  * whole dataset never needs to be stored in memory.
+  * The source is called to fill a buffer of at most chunk_size rows
+  * (in ravel format, n_features values for each row) and it must return
+  * the number of rows written; a zero value marks the end of the epoch and
+  * the next call must restart the stream from its beginning.
+  * The rows of each chunk are shuffled and split in batches which are
+  * processed with the same learning rule of the fit function, while the
+  * next chunk is loaded by a background task.
+  * The remaining rows of a chunk which do not fill a whole batch are discarded.
+  *
+  * @note The chunk size must be greater or equal than the batch size.
+  * The order of the chunks is determined by the source.
+  *
+  * @param source Chunked data source with signature int32_t (Scalar * chunk, const int32_t & max_rows).
+  * @param n_features Number of features of each row.
+  * @param chunk_size Maximum number of rows of each chunk.
+  * @param num_epochs Number of epochs for model convergency.
+  * @param seed Random seed number for the batch subdivisions.
+  * @param callback Callback function to call at each batch evaluation.
+  *
+  * @tparam Source Callable object which fills the chunk buffer.
+  * @tparam Callback void lambda function which can use member variables.
+  *
+  */
+  template < class Source, class Callback = std :: function < void (BasePlasticity_ *) > >
+  void fit_stream (Source & source, const int32_t & n_features, const int32_t & chunk_size,
+    const int32_t & num_epochs, int32_t seed=42, Callback callback=[](BasePlasticity_ *) -> void {});
+
+  /**
+  * @brief Update the model/encoder with new data
+  *
+  * @details The function applies the learning rule to the given rows, keeping
+  * the current state of the model, i.e. the weights, the optimizer moments and
+  * the theta array (e.g. the BCM sliding threshold) are not re-initialized, so the
+  * model can be updated continuously as the data arrive (online learning).
+  * The rows are processed in the given order (no shuffle) and split in batches:
+  * the rows which do not fill a whole batch are stored and they are used by the
+  * next call, so the cost of each call is proportional to the number of given rows.
+  * The optimizer iteration advances at each batch, thus the final model does not
+  * depend on how the stream is split among the calls.
+  *
+  * @note If the model is not fitted yet, the weights and the optimizer arrays are
+  * initialized at the first call (as in the fit function). A model restored by the
+  * load_weights function continues with new optimizer moments.
+  *
+  * @param X array in ravel format of the input variables/features
+  * @param n_samples dimension of the X matrix, i.e. the number of rows
+  * @param n_features dimension of the X matrix, i.e. the number of cols
+  * @param callback Callback function to call at each batch evaluation.
+  *
+  * @tparam Callback void lambda function which can use member variables.
+  *
+  */
+  template < class Callback = std :: function < void (BasePlasticity_ *) > >
+  void partial_fit (const Scalar * X, const int32_t & n_samples, const int32_t & n_features,
+    Callback callback=[](BasePlasticity_ *) -> void {});
+
+  /**
+  * @brief Update the model/encoder with new data
+  *
+  * @details Proxy function for a user interface compatible with Eigen matrix.
+  *
+  * @param X Eigen matrix of the input variables/features.
+  * @param callback Callback function to call at each batch evaluation.
+  *
+  * @tparam Callback void lambda function which can use member variables.
+  *
+  */
+  template < class Callback = std :: function < void (BasePlasticity_ *) > >
+  void partial_fit (const matrix_t & X, Callback callback=[](BasePlasticity_ *) -> void {});
+
+  /**
+  * @brief Update the model/encoder with new raw (uint8_t) data
+  *
+  * @details The raw values are converted according to the given normalization
+  * when the rows are gathered into the batch buffer.
+  *
+  * @param X array in ravel format of the input variables/features
+  * @param n_samples dimension of the X matrix, i.e. the number of rows
+  * @param n_features dimension of the X matrix, i.e. the number of cols
+  * @param stride Distance (in bytes) between the beginning of consecutive rows (n_features for packed rows).
+  * @param norm Normalization of the raw values.
+  * @param callback Callback function to call at each batch evaluation.
+  *
+  * @tparam Callback void lambda function which can use member variables.
+  *
+  */
+  template < class Callback = std :: function < void (BasePlasticity_ *) > >
+  void partial_fit (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+    const int64_t & stride, const input_normalization & norm, Callback callback=[](BasePlasticity_ *) -> void {});
 
   /**
   * @brief Predict the model/encoder
@@ -228,10 +417,27 @@ public:
   * @param n_samples dimension of the X matrix, i.e. the number of rows.
   * @param n_features dimension of the X matrix, i.e. the number of cols.
   *
-  * @return The array of encoded features.
+  * @return The (owned) array of encoded features, i.e. n_samples blocks of outputs values.
+  *
+  */
+  std :: unique_ptr < Scalar [] > predict (const Scalar * X, const int32_t & n_samples, const int32_t & n_features);
+
+  /**
+  * @brief Predict the model/encoder into the given buffer
+  *
+  * @details The encoded features are written directly into the buffer
+  * provided by the caller (e.g. a numpy array), without any intermediate
+  * allocation: the input array is used as is (in ravel format each sample
+  * is a column of the data matrix) and the output buffer is filled by
+  * n_samples blocks of outputs values, i.e. the same layout of the predict function.
+  *
+  * @param X array in ravel format of the input variables/features.
+  * @param n_samples dimension of the X matrix, i.e. the number of rows.
+  * @param n_features dimension of the X matrix, i.e. the number of cols.
+  * @param output Output buffer of (at least) outputs * n_samples values.
   *
   */
-  float * predict (float * X, const int32_t & n_samples, const int32_t & n_features);
+  void predict_into (const Scalar * X, const int32_t & n_samples, const int32_t & n_features, Scalar * output);
 
   /**
   * @brief Predict the model/encoder
@@ -240,18 +446,41 @@ public:
   *
   * @param X Eigen matrix of the input variables/features.
   *
-  * @return The array of encoded features.
+  * @return The matrix of encoded features with shape (outputs, n_samples).
   *
   */
-  float * predict (const Eigen :: MatrixXf & X);
+  matrix_t predict (const matrix_t & X);
 
   /**
-  * @brief Save the current weight matrix.
+  * @brief Predict the model/encoder on raw (uint8_t) data
   *
-  * @details The weights matrix is saved in binary format.
-  * The first value of the file is an integer corresponding to the number of
-  * weights (rows x cols) of the weight matrix, followed by the (float)
-  * weight matrix in ravel format.
+  * @details The raw values are converted into floating point values according
+  * to the given normalization in tiles of (at most) batch samples,
+  * so only one tile of floating point values is stored at a time.
+  *
+  * @param X array in ravel format of the input variables/features.
+  * @param n_samples dimension of the X matrix, i.e. the number of rows.
+  * @param n_features dimension of the X matrix, i.e. the number of cols.
+  * @param stride Distance (in bytes) between the beginning of consecutive rows (n_features for packed rows).
+  * @param norm Normalization of the raw values.
+  *
+  * @return The (owned) array of encoded features, i.e. n_samples blocks of outputs values.
+  *
+  */
+  std :: unique_ptr < Scalar [] > predict (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+    const int64_t & stride, const input_normalization & norm);
+
+  /**
+  * @brief Save the model.
+  *
+  * @details The model is saved as a model file (see model_file namespace), i.e.
+  * a versioned binary file with the hyperparameters of the model (as text),
+  * the weights matrix, the theta array and the other arrays required by the
+  * model (e.g. the interaction matrix), each one stored in a 64-byte aligned
+  * section with its own CRC-32C checksum.
+  *
+  * @note The file is written with the ".tmp" suffix and then renamed, so a model
+  * mapped from a previous version of the file (load_mmap) is never modified.
   *
   * @param filename Filename or path where the file is saved.
   *
@@ -259,53 +488,73 @@ public:
   void save_weights (const std :: string & filename);
 
   /**
-  * @brief Load the current weight matrix.
+  * @brief Load the model.
+  *
+  * @details The model file written by the save_weights function is read and
+  * validated, and the hyperparameters and the arrays of the model are restored.
+  * The files in the previous (raw) format, i.e. the shape of the weights followed
+  * by the weights matrix in ravel format, are still supported.
   *
-  * @details The weights matrix is loaded according to the format
-  * specified in the save_weights function, i.e. the first first value of
-  * the file is an integer corresponding to the number of weights
-  * (rows x cols) of the weight matrix, followed by the (float) weight
-  * matrix in ravel format.
+  * @note The file must store the arrays in the precision of the model (Scalar),
+  * otherwise the model is left unchanged and an exception is thrown.
   *
   * @param filename Filename or path of the weight.
   */
   void load_weights (const std :: string & filename);
 
+  /**
+  * @brief Load the model using a read-only memory mapping of the file.
+  *
+  * @details The hyperparameters and the small arrays are restored as in the load_weights
+  * function, while the weights matrix is used directly from the mapped file, without any copy.
+  * Many processes can map the same file sharing the page cache.
+  * The mapping is released when the model is fitted again or when another file is loaded.
+  *
+  * @note The mapped weights are read-only: the weights member is empty and they are
+  * accessible by the weights_view and get_weights functions.
+  *
+  * @param filename Filename or path of the model file.
+  * @param verify Verify the checksum of the weights (it requires a read of the whole file).
+  */
+  void load_mmap (const std :: string & filename, const bool & verify=true);
+
   /**
   * @brief Get the weight matrix as pointer array
   *
   * @details This function is just an utility for the Cython wrap
   * of the object.
   *
+  * @note The buffer is read-only, since the derived matrices cached by the
+  * models are not updated by its modification: use the set_weights function instead.
+  * If the weights are memory mapped, the buffer refers to the mapped file.
+  *
   * @return The weights matrix in ravel format.
   */
-  float * get_weights ();
-
-private:
+  const Scalar * get_weights () const;
 
   /**
-  * @brief Weights update rule.
+  * @brief Set the weight matrix.
   *
-  * @note Compute the weights update using the given learning rule.
+  * @details The given values replace the current weights (releasing the eventual
+  * mapped file) and the cached matrices derived from them are invalidated.
   *
-  * @param X Batch of data.
-  * @param output Output of the model as computed by the _predict function
-  *
-  * @return Matrix of updates (aka dW) for weights.
+  * @param W Weights matrix in ravel format (the same of the get_weights buffer).
+  * @param outputs Number of rows of the weights (it must be equal to the number of hidden units).
+  * @param n_features Number of columns of the weights.
   *
   */
-  virtual Eigen :: MatrixXf weights_update (const Eigen :: MatrixXf & X, const Eigen :: MatrixXf & output) = 0;
+  void set_weights (const Scalar * W, const int32_t & outputs, const int32_t & n_features);
 
   /**
-  * @brief Check the input dimensions.
+  * @brief Get the current weights matrix.
   *
-  * @note The function checks if the given dimensions are consistent with
-  * the input ones.
+  * @note The view refers to the mapped file after a load_mmap call,
+  * otherwise it refers to the weights member.
   *
-  * @param n_features dimension of the X matrix, i.e. the number of cols
+  * @return Read-only view of the weights matrix (outputs, n_features).
   *
   */
-  void check_dims (const int32_t & n_features);
+  Eigen :: Map < const matrix_t > weights_view () const;
 
   /**
   * @brief Check if the model is already fitted.
@@ -317,6 +566,160 @@ private:
   */
   void check_is_fitted ();
 
+  /**
+  * @brief Check if the weights are used from a mapped model file (load_mmap).
+  *
+  */
+  bool is_mapped () const;
+
+  /**
+  * @brief Export a reduced-precision frozen copy of the model.
+  *
+  * @details The forward matrix of the model (i.e. the weights with the
+  * interaction/normalization already applied) is quantized together with the
+  * activation function, so the returned object reproduces the model prediction
+  * on raw uint8 inputs. The model can be trained further without affecting it.
+  *
+  * @param type Quantization type (int8 with per-row scales or bf16).
+  *
+  * @return The quantized model.
+  */
+  quantized_model quantize (const int32_t & type=quantization_t :: int8);
+
+  /**
+  * @brief Set the number of threads used by the model.
+  *
+  * @details The training and the prediction steps are parallelized across
+  * the batch columns and the weight rows/columns using the OpenMP thread pool,
+  * and the same number of threads is used by the Eigen products.
+  * With a single thread the next batch is gathered by a background task
+  * while the current one is processed, otherwise the gather is performed
+  * in parallel by the pool.
+  *
+  * @note Without OpenMP support (OMP option disabled) the library is
+  * always executed by a single thread and the given value is ignored.
+  *
+  * @param n_threads Number of threads (must be positive).
+  *
+  */
+  void set_num_threads (const int32_t & n_threads);
+
+  /**
+  * @brief Get the number of threads used by the model.
+  *
+  * @return The number of threads.
+  */
+  int32_t get_num_threads () const;
+
+  /**
+  * @brief Enable the profiling of the training.
+  *
+  * @details Along the training (fit, fit_stream and partial_fit) the wall time
+  * of each stage (gather, forward/update, decay, optimizer and callback) is recorded
+  * for every batch, together with the estimated floating point operations and bytes
+  * moved by each stage, so the trace can be used to find the bottleneck of a
+  * configuration. Each fit call starts a new trace, while the partial_fit calls
+  * append their batches to the current one.
+  * When disabled (default) the timers are not even started.
+  *
+  * @param enable Enable or disable the profiling.
+  *
+  */
+  void set_profiling (const bool & enable);
+
+  /**
+  * @brief Get the profiler of the training.
+  *
+  * @details The trace can be exported by the save_json and save_csv members.
+  *
+  * @return The recorded trace.
+  */
+  const training_profiler & get_profiler () const;
+
+  /**
+  * @brief Set the frequency of the convergency check (early stopping).
+  *
+  * @details By default (epoch_check) the convergency is checked at the end of
+  * each epoch on the average of the theta arrays along the epoch, and the
+  * training stops when the last epochs_for_convergency averages are within
+  * convergency_atol from the current one.
+  * With the batch_check the same criterion is applied at each batch on the
+  * current theta array, i.e. the window counts batches instead of epochs and
+  * the training can stop in the middle of an epoch.
+  *
+  * @param check Frequency of the check (epoch_check or batch_check).
+  *
+  */
+  void set_convergence_check (const int32_t & check);
+
+  /**
+  * @brief Enable the periodic checkpoints of the training.
+  *
+  * @details Along the fit the complete training state, i.e. the model file
+  * (hyperparameters, weights, theta) together with the optimizer moments, the
+  * convergence history, the current permutation of the samples, the state of the
+  * random generator and the position (epoch, batch) in the training loop, is
+  * written every frequency epochs (or batches).
+  * The state is copied into an owning model file writer and the file is written
+  * by a background task, while the training goes on: the file is first written
+  * with the ".tmp" suffix and then renamed, so the given file is always a complete
+  * checkpoint. The pending write is completed before the next checkpoint and at
+  * the end of the fit.
+  *
+  * @note The checkpoints are written by the fit functions on a dataset,
+  * while they are not supported by the fit_stream function.
+  *
+  * @param filename Filename or path of the checkpoint file.
+  * @param frequency Number of epochs (or batches) between two checkpoints (zero disables them).
+  * @param unit Unit of the frequency (per_epoch or per_batch).
+  *
+  */
+  void set_checkpoint (const std :: string & filename, const int32_t & frequency,
+    const int32_t & unit=checkpoint_t :: per_epoch);
+
+  /**
+  * @brief Restore the training state stored in a checkpoint.
+  *
+  * @details The model is restored immediately (as in the load_weights function)
+  * together with the optimizer moments and the convergence history, while the
+  * position in the training loop is used by the next call of the fit function,
+  * which continues the interrupted training instead of starting a new one.
+  * Calling the fit function with the same data, number of epochs, seed and
+  * number of threads of the interrupted one, the final weights are identical
+  * to the ones of an uninterrupted training.
+  *
+  * @param filename Filename or path of the checkpoint file.
+  *
+  */
+  void resume (const std :: string & filename);
+
+private:
+
+  /**
+  * @brief Weights update rule.
+  *
+  * @note Compute the weights update using the given learning rule.
+  * The result is written in the given (pre-allocated) buffer.
+  *
+  * @param X Batch of data with shape (n_features, batch).
+  * @param output Output of the model as computed by the _predict_into function
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  *
+  */
+  virtual void weights_update_into (const matrix_t & X, const matrix_t & output,
+    matrix_t & weights_update) = 0;
+
+  /**
+  * @brief Check the input dimensions.
+  *
+  * @note The function checks if the given dimensions are consistent with
+  * the input ones.
+  *
+  * @param n_features dimension of the X matrix, i.e. the number of cols
+  *
+  */
+  void check_dims (const int32_t & n_features);
+
   /**
   * @brief Check the given parameters.
   *
@@ -331,45 +734,312 @@ private:
   *
   * @note The convergency is estimated by the stability or not of the
   * learning parameter in a fixed (epochs_for_convergency) number
-  * of epochs for all the outputs.
+  * of epochs (or batches) for all the outputs: the current vector is appended
+  * to the sliding window and the convergency is reached when all the
+  * epochs_for_convergency previous vectors are within convergency_atol from it.
+  * The check costs O(outputs) whatever the length of the window.
   *
   * @param vec Vector containing updates to check for the convergence estimation
   *
   */
-  bool check_convergence (const Eigen :: ArrayXf & vec);
+  bool check_convergence (const array_t & vec);
+
+  /**
+  * @brief Init the training parameters.
+  *
+  * @note The function checks the consistency between the batch size and
+  * the number of samples and it allocates (and initializes) the weights matrix
+  * and the optimizer arrays. After a resume call the restored weights and
+  * optimizer arrays are kept.
+  *
+  * @param n_samples Number of samples in the training set.
+  * @param n_features Number of features in the training set.
+  *
+  */
+  void init_training (const int32_t & n_samples, const int32_t & n_features);
+
+  /**
+  * @brief Init the profiler of the training.
+  *
+  * @note The estimated cost of the stages is evaluated from the shape of the problem.
+  *
+  * @param n_features Number of features in the training set.
+  * @param restart Clear the trace of the previous training.
+  *
+  * @return The profiler (nullptr if the profiling is disabled).
+  */
+  training_profiler * init_profiler (const int32_t & n_features, const bool & restart);
+
+  /**
+  * @brief Init the incremental training.
+  *
+  * @note At the first call the weights matrix, the optimizer arrays and the theta
+  * array are initialized as in the init_training function, otherwise the current
+  * ones are kept (the mapped weights are copied). The workspace and the pending
+  * buffer are allocated only if their shape changes.
+  *
+  * @param n_features Number of features of the new data.
+  *
+  */
+  void init_partial (const int32_t & n_features);
+
+  /**
+  * @brief Gather the batch of data.
+  *
+  * @note The rows of the input matrix indicated by the index array are
+  * copied into the columns of the batch buffer. The buffer must be already
+  * allocated with the shape (n_features, batch).
+  *
+  * @param X Eigen matrix of the input variables/features.
+  * @param indices Array of the batch indices (one for each column of the buffer).
+  * @param batch_data Output buffer of the batch (or a block of its columns).
+  * @param n_threads Number of threads used for the copy of the rows.
+  *
+  * @tparam Matrix Eigen matrix type of the input data (row or column major).
+  *
+  */
+  template < class Matrix >
+  static void gather_batch (const Eigen :: MatrixBase < Matrix > & X,
+    const int32_t * indices, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads);
+
+  /**
+  * @brief Gather the batch of raw data.
+  *
+  * @note The rows of the raw input buffer indicated by the index array are
+  * converted according to the given normalization directly into the
+  * columns of the batch buffer. The buffer must be already allocated
+  * with the shape (n_features, batch).
+  *
+  * @param X Raw input buffer in ravel format (n_samples, n_features).
+  * @param stride Distance (in bytes) between the beginning of consecutive rows of X.
+  * @param indices Array of the batch indices (one for each column of the buffer).
+  * @param norm Normalization of the raw values.
+  * @param batch_data Output buffer of the batch (or a block of its columns).
+  * @param n_threads Number of threads used for the conversion of the rows.
+  *
+  */
+  static void gather_batch (const uint8_t * X, const int64_t & stride, const int32_t * indices,
+    const input_normalization & norm, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads);
+
+  /**
+  * @brief Perform a training step on the given batch.
+  *
+  * @note The function computes the output of the model and the weights update
+  * (by the forward_update_into member), the eventual decay and it applies the
+  * optimizer, invalidating the cached matrices through the weights_version counter.
+  * The theta member is updated by the learning rule.
+  *
+  * @param batch_data Batch of data (n_features, batch).
+  * @param iteration Current iteration number (epoch) used by the optimizer.
+  *
+  */
+  void train_batch (const matrix_t & batch_data, const int32_t & iteration);
+
+  /**
+  * @brief Write a checkpoint of the training.
+  *
+  * @note The training state is copied and the file is written by a
+  * background task, after the completion of the previous one.
+  *
+  * @param epoch Epoch of the next training step.
+  * @param next_batch Index of the next batch in the epoch.
+  * @param indices Current permutation of the samples.
+  * @param engine Random number generator of the permutations.
+  * @param sum_theta Accumulator of the convergence vector in the current epoch.
+  *
+  */
+  void save_checkpoint (const int32_t & epoch, const int32_t & next_batch,
+    const std :: vector < int32_t > & indices, const std :: mt19937 & engine,
+    const array_t & sum_theta);
+
+  /**
+  * @brief Wait the completion of the pending checkpoint (if any).
+  *
+  * @note The errors of the background write are re-thrown.
+  *
+  */
+  void wait_checkpoint ();
+
+  /**
+  * @brief Restore the position in the training loop stored by the resume function.
+  *
+  * @note The resume point is consumed, so the following fit calls start a new training.
+  *
+  * @param epoch Epoch of the next training step.
+  * @param next_batch Index of the next batch in the epoch.
+  * @param indices Permutation of the samples.
+  * @param engine Random number generator of the permutations.
+  * @param sum_theta Accumulator of the convergence vector in the current epoch.
+  *
+  * @return True if the training is resumed.
+  */
+  bool restore_checkpoint (int32_t & epoch, int32_t & next_batch,
+    std :: vector < int32_t > & indices, std :: mt19937 & engine,
+    array_t & sum_theta);
 
   /**
   * @brief Core function of the fit formula
   *
   * @note This is the core function of the fit procedure, i.e the
-  * function in which the computation of the training step is performed
+  * function in which the computation of the training step is performed.
+  * The input data are never copied as a whole, but each batch is
+  * gathered in a pre-allocated buffer while the previous one is processed.
   *
-  * @param X Eigen matrix of the input variables/features.
+  * @param gather Function which fills the batch buffer with the rows of the given indices.
+  * @param n_samples Number of samples in the training set.
+  * @param n_features Number of features in the training set.
   * @param num_epochs Number of epochs for model convergency.
   * @param seed Random seed number for the batch subdivisions.
   * @param callback Callback function to call at each batch evaluation.
   *
+  * @tparam Gather void function with signature (const int32_t * indices, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads).
+  * @tparam Callback void lambda function which can use member variables.
+  *
+  */
+  template < class Gather, class Callback >
+  void _fit (Gather gather, const int32_t & n_samples, const int32_t & n_features,
+    const int32_t & num_epochs, const int32_t & seed, Callback callback);
+
+  /**
+  * @brief Core function of the partial_fit formula
+  *
+  * @note The pending rows are completed with the first given ones, then the
+  * whole batches are gathered and processed and the remaining rows are stored
+  * in the pending buffer.
+  *
+  * @param gather Function which fills the given columns with the rows of the given indices.
+  * @param n_samples Number of new samples.
+  * @param n_features Number of features of the new samples.
+  * @param callback Callback function to call at each batch evaluation.
+  *
+  * @tparam Gather void function with signature (const int32_t * indices, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads).
   * @tparam Callback void lambda function which can use member variables.
   *
   */
-  template < class Callback >
-  void _fit (const Eigen :: MatrixXf & X, const int32_t & num_epochs,
-    const int32_t & seed, Callback callback);
+  template < class Gather, class Callback >
+  void _partial_fit (Gather gather, const int32_t & n_samples, const int32_t & n_features, Callback callback);
 
   /**
   * @brief Core function of the predict formula
   *
   * @note This abstract function implements the predict rule of
   * the model given the data matrix.
+  * The result is written in the given (pre-allocated) buffer.
+  *
+  * @note The data matrix stores each sample as a column, so the
+  * input arrays in ravel format can be used without any copy.
+  *
+  * @param data Input matrix of data with shape (n_features, n_samples).
+  * @param output Output matrix of the model with shape (outputs, n_samples).
   *
-  * @param data Input matrix of data
+  */
+  virtual void _predict_into (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output) = 0;
+
+  /**
+  * @brief Allocate the output matrix and call the predict formula
+  *
+  * @param data Input matrix of data with shape (n_features, n_samples).
   *
   * @return Output matrix of the model.
   *
   */
-  virtual Eigen :: MatrixXf _predict (const Eigen :: MatrixXf & data);
+  matrix_t _predict (const Eigen :: Ref < const matrix_t > & data);
+
+protected:
+
+  /**
+  * @brief Allocate the training workspace.
+  *
+  * @note The buffers used along the training are allocated only once by
+  * this function, before the loop over the batches.
+  * Derived classes can override this member to allocate their own
+  * buffers, but they must call the base version.
+  *
+  * @param n_features Number of features in the training set.
+  *
+  */
+  virtual void init_workspace (const int32_t & n_features);
+
+  /**
+  * @brief Get the matrix applied to the input data in the forward step.
+  *
+  * @note By default it is the weights matrix itself. Derived classes
+  * which apply a transformation to the weights before the product
+  * with the data can override this member, caching the result until
+  * the weights_version counter changes.
+  *
+  * @return View of the forward matrix (outputs, n_features).
+  *
+  */
+  virtual Eigen :: Map < const matrix_t > forward_weights ();
+
+  /**
+  * @brief Store the hyperparameters and the arrays of the model.
+  *
+  * @note Derived classes must call the base version before adding their own members.
+  * The weights matrix is stored by the save_weights function.
+  *
+  * @param file Model file builder.
+  *
+  */
+  virtual void save_state (model_file :: writer & file) const;
+
+  /**
+  * @brief Restore the hyperparameters and the arrays of the model.
+  *
+  * @note Derived classes must call the base version before restoring their own members.
+  * The weights matrix is restored by the load_weights (or load_mmap) function.
+  *
+  * @param file Model file.
+  *
+  */
+  virtual void load_state (const model_file :: reader & file);
+
+  /**
+  * @brief Estimate the cost of the training stages for a batch.
+  *
+  * @note By default the forward and the update are two dense products of the
+  * (outputs, n_features) weights with the batch. Derived classes with a different
+  * learning rule can override this member to provide their own estimate.
+  * The memory bound stages (e.g. the optimizer) report only the bytes moved.
+  *
+  * @param n_features Number of features in the training set.
+  * @param flops Floating point operations of each stage (stage_t).
+  * @param bytes Bytes moved by each stage (stage_t).
+  *
+  */
+  virtual void stage_costs (const int32_t & n_features,
+    std :: array < double, num_stages > & flops, std :: array < double, num_stages > & bytes) const;
+
+  /**
+  * @brief Apply the optimizer to the weights using the current weights update.
+  *
+  * @note By default the runtime optimizer is used. Derived classes which
+  * know the optimization algorithm at compile time can override this member
+  * to call directly the corresponding policy kernel.
+  *
+  * @param iteration Current iteration number (epoch) used by the optimizer.
+  *
+  */
+  virtual void optimizer_step (const int32_t & iteration);
+
+  /**
+  * @brief Compute the output of the model and the weights update of a training step.
+  *
+  * @note By default the output is computed by the _predict_into function into
+  * the batch_output workspace and then it is given to the weights_update_into rule.
+  * Derived classes can override this member to fuse the two steps, avoiding
+  * extra passes over the output matrix (or its storage at all).
+  *
+  * @param X Batch of data with shape (n_features, batch).
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  *
+  */
+  virtual void forward_update_into (const matrix_t & X, matrix_t & weights_update);
 
 };
 
+using BasePlasticity = BasePlasticity_ < float >; ///< single precision model (Cython and inference interface)
+
 
 #endif // __base_h__
@@ -45,13 +45,33 @@
 * competitive to a network of the same size trained with backpropagation
 * algorithm end-to-end.
 *
+* @tparam Scalar Type of the weights (float or double).
+*
 */
-class BCM : public BasePlasticity
+template < class Scalar >
+class BCM_ : public BasePlasticity_ < Scalar >
 {
 
-  Eigen :: MatrixXf interaction_matrix; ///< interaction matrix between weights
+public:
+
+  using matrix_t = typename BasePlasticity_ < Scalar > :: matrix_t; ///< matrix of the model values
+  using vector_t = typename BasePlasticity_ < Scalar > :: vector_t; ///< column vector of the model values
+
+private:
+
+  matrix_t interaction_matrix; ///< interaction matrix between weights (empty without lateral interactions)
   float memory_factor; ///< Memory factor for weighting the theta updates.
 
+  matrix_t effective_weights;          ///< cache of the interaction matrix applied to the weights
+  int64_t effective_version;           ///< weights version of the cached effective weights
+
+  matrix_t phi;                  ///< workspace of the Law and Cooper function (outputs, batch)
+  vector_t batch_theta;          ///< workspace of the batch average of the squared outputs
+  matrix_t tile_theta;           ///< workspace of the squared outputs sums of each tile (outputs, n_tiles)
+
+  int32_t tile_rows; ///< number of units (rows) processed by each tile of the forward kernel
+  int32_t tile_size; ///< number of samples (columns) processed by each tile of the forward kernel
+
 public:
 
 
@@ -74,7 +94,7 @@ public:
   * @param interaction_strength Set the lateral interaction strength between weights.
   *
   */
-  BCM (const int32_t & outputs, const int32_t & batch_size,
+  BCM_ (const int32_t & outputs, const int32_t & batch_size,
     int32_t activation=transfer_t :: logistic,
     update_args optimizer=update_args(optimizer_t :: sgd),
     weights_initialization weights_init=weights_initialization(weights_init_t :: normal),
@@ -93,7 +113,7 @@ public:
   * @param b BCM object
   *
   */
-  BCM (const BCM & b);
+  BCM_ (const BCM_ & b);
 
   /**
   * @brief Copy operator.
@@ -105,7 +125,7 @@ public:
   * @param b BCM object
   *
   */
-  BCM & operator = (const BCM & b);
+  BCM_ & operator = (const BCM_ & b);
 
   // Destructor
 
@@ -115,10 +135,10 @@ public:
   * @details Completely delete the object and release the memory of the arrays.
   *
   */
-  ~BCM () = default;
+  ~BCM_ () = default;
 
 
-private:
+protected:
 
   /**
   * @brief Compute the weights update using the BCM learning rule.
@@ -139,13 +159,92 @@ private:
   * when running simulations of networks, where the run-time of the simulation can
   * be prohibitive.
   *
-  * @param X Batch of data.
-  * @param output Output of the model as computed by the _predict function
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param output Output of the model as computed by the _predict_into function
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  *
+  */
+  void weights_update_into (const matrix_t & X, const matrix_t & output,
+    matrix_t & weights_update);
+
+  /**
+  * @brief Compute the output of the model and the weights update of a training step.
+  *
+  * @note The output is computed by the blocked forward kernel, which applies the
+  * activation function and accumulates the squared outputs of each tile while it
+  * is still in cache, so the theta array does not require another pass over the output.
+  *
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  *
+  */
+  void forward_update_into (const matrix_t & X, matrix_t & weights_update);
+
+  /**
+  * @brief Blocked forward kernel.
+  *
+  * @note The output is computed by tiles of tile_rows units and tile_size samples:
+  * each tile is evaluated by the product of a block of rows of the forward matrix
+  * with the samples and the activation function is applied on it before moving
+  * to the next one. The blocks of rows are the outer loop, so each block is
+  * loaded once and it is reused by all the tiles of samples.
+  * The tiles are independent, so they are distributed among the threads.
+  * If required, the sums of the squared outputs of each tile are stored
+  * in the columns of the tile_theta workspace.
+  *
+  * @param data Input matrix of data (n_features, n_samples).
+  * @param output Output matrix of the model (outputs, n_samples).
+  * @param activation Activation function to apply.
+  * @param square_sums Enable the accumulation of the squared outputs.
+  *
+  * @tparam Function void function with signature (Scalar * x, const int32_t & n).
+  *
+  */
+  template < class Function >
+  void forward_tiles (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output,
+    Function activation, const bool & square_sums);
+
+  /**
+  * @brief Fused training step of the BCM rule.
+  *
+  * @note The blocked forward kernel fills the output workspace and the tile sums
+  * of the squared outputs, which are reduced into the batch theta.
+  * Then the Law and Cooper update is computed.
+  *
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  * @param activation Activation function to apply.
+  *
+  * @tparam Function void function with signature (Scalar * x, const int32_t & n).
+  *
+  */
+  template < class Function >
+  void fused_update_into (const matrix_t & X, matrix_t & weights_update, Function activation);
+
+  /**
+  * @brief Compute the weights update from the output and the batch theta.
+  *
+  * @note The phi matrix is evaluated by tiles of samples (in parallel)
+  * and then it is multiplied by the batch of data.
   *
-  * @return weights_update Matrix of updates (aka dW) for weights.
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param output Output of the model (outputs, batch).
+  * @param weights_update Matrix of updates (aka dW) for weights.
   *
   */
-  Eigen :: MatrixXf weights_update (const Eigen :: MatrixXf & X, const Eigen :: MatrixXf & output);
+  void law_cooper_update_into (const matrix_t & X, const matrix_t & output,
+    matrix_t & weights_update);
+
+  /**
+  * @brief Allocate the training workspace.
+  *
+  * @note In addition to the base buffers, the function allocates
+  * the phi matrix and the theta buffers used by the BCM rule.
+  *
+  * @param n_features Number of features in the training set.
+  *
+  */
+  void init_workspace (const int32_t & n_features);
 
   /**
   * @brief Initialize the weights interaction matrix.
@@ -163,12 +262,61 @@ private:
   * equal to 1 and all the other entries as -interaction_strenght.
   * Since in the predict function the inverse of this matrix is required, the
   * inverse computation is performed before the storing into this function.
+  * Without lateral interactions the identity matrix is not stored at all,
+  * and the weights are directly used in the forward step.
   *
   * @param interaction_strenght Set the lateral interaction strenght between weights.
   *
   */
   void init_interaction_matrix (const float & interaction_strenght);
 
+  /**
+  * @brief Get the matrix applied to the input data in the forward step.
+  *
+  * @note The effective matrix
+  * \f[
+  * M = L^{-1} W
+  * \f]
+  * is cached and it is re-computed only when the weights change.
+  * Without lateral interactions the weights matrix is returned.
+  *
+  * @return View of the forward matrix (outputs, n_features).
+  *
+  */
+  Eigen :: Map < const matrix_t > forward_weights ();
+
+  /**
+  * @brief Store the hyperparameters and the arrays of the model.
+  *
+  * @note In addition to the base members, the memory factor and
+  * the (eventual) interaction matrix are stored.
+  *
+  * @param file Model file builder.
+  *
+  */
+  void save_state (model_file :: writer & file) const;
+
+  /**
+  * @brief Restore the hyperparameters and the arrays of the model.
+  *
+  * @param file Model file.
+  *
+  */
+  void load_state (const model_file :: reader & file);
+
+  /**
+  * @brief Get the shape of the tiles of the forward kernel.
+  *
+  * @note The output tile fits in a portion of the L2 cache whatever the number
+  * of units, since the units are split in blocks of rows.
+  *
+  * @param outputs Number of hidden units.
+  * @param tile_rows Number of units of each tile.
+  * @param tile_cols Number of samples of each tile.
+  *
+  */
+  static void get_tile_shape (const int32_t & outputs, int32_t & tile_rows, int32_t & tile_cols);
+
   /**
   * @brief Core function of the predict formula
   *
@@ -181,16 +329,18 @@ private:
   * y = \sigma(\sum_i L_i^{-1} w_i x_i)
   * \f]
   * where \f$L\f$ is the interaction matrix between the neurons.
+  * The output is evaluated by the blocked forward kernel.
   *
-  * @param data Input matrix of data.
-  *
-  * @return Output matrix of the model.
+  * @param data Input matrix of data (n_features, n_samples).
+  * @param output Output matrix of the model.
   *
   */
-  Eigen :: MatrixXf _predict (const Eigen :: MatrixXf & data);
+  void _predict_into (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output);
 
 
 };
 
+using BCM = BCM_ < float >; ///< single precision BCM model (Cython interface)
+
 
 #endif // __bcm_h__
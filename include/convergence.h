@@ -0,0 +1,141 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __convergence_h__
+#define __convergence_h__
+
+#include <model_file.h>
+
+#include <Eigen/Dense>
+
+/**
+* @class convergence_window
+*
+* @brief Sliding window of the learning parameters for the convergence monitoring.
+*
+* @details The window stores the current vector and the "length" previous ones
+* (e.g. the theta array of each epoch) and the training is converged when all
+* the previous vectors are within the absolute tolerance from the current one,
+* unit by unit, i.e. when
+*
+* \f[
+* \max_i h_{i,u} - v_u \le atol \quad and \quad v_u - \min_i h_{i,u} \le atol \quad \forall u
+* \f]
+*
+* The minimum and maximum envelopes of the window are evaluated with the
+* van Herk/Gil-Werman scheme: the stream of vectors is split in blocks of length + 1
+* values, stored in a fixed ring buffer. The running (prefix) extremes of the current
+* block are updated at each step, while at the end of each block the ring is replaced
+* in place by its suffix extremes. Since the current value overwrites the oldest one,
+* the extremes of the window are given by the prefix of the current block and by the
+* suffix of the previous one at the next slot, so each check costs O(outputs)
+* (amortized) whatever the length of the window.
+*
+* @note The ring buffer grows (doubling) along the first block, so a long window
+* allocates only the memory of the vectors actually stored.
+*
+* @tparam Scalar Type of the monitored values (float or double).
+*
+*/
+template < class Scalar >
+class convergence_window_
+{
+
+  using matrix_t = Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic >; ///< matrix of the window values
+  using array_t = Eigen :: Array < Scalar, Eigen :: Dynamic, 1 >;                  ///< array of the window values
+
+  matrix_t ring_max; ///< values of the current block followed by the suffix maxima of the previous one (outputs, length + 1)
+  matrix_t ring_min; ///< values of the current block followed by the suffix minima of the previous one (outputs, length + 1)
+
+  array_t prefix_max; ///< running maximum of the current block
+  array_t prefix_min; ///< running minimum of the current block
+
+  int32_t length; ///< number of previous vectors compared with the current one
+  int32_t fill;   ///< number of vectors of the current block
+  int64_t count;  ///< number of vectors seen
+
+public:
+
+  // Constructors
+
+  /**
+  * @brief Default constructor (empty window).
+  *
+  */
+  convergence_window_ ();
+
+  // Destructors
+
+  ~convergence_window_ () = default;
+
+  /**
+  * @brief Clear the window.
+  *
+  * @param outputs Size of the monitored vectors.
+  * @param length Number of previous vectors compared with the current one.
+  *
+  */
+  void reset (const int32_t & outputs, const int32_t & length);
+
+  /**
+  * @brief Append the current vector and check the convergence.
+  *
+  * @param vec Current vector of the learning parameters.
+  * @param atol Absolute tolerance.
+  *
+  * @return True if the window is full and all the previous vectors are within the tolerance from the current one.
+  */
+  bool update (const array_t & vec, const float & atol);
+
+  /**
+  * @brief Get the number of vectors in the window (the current one included).
+  *
+  */
+  int32_t size () const;
+
+  /**
+  * @brief Store the state of the window in the given model file.
+  *
+  * @param file Model file builder.
+  *
+  */
+  void save (model_file :: writer & file) const;
+
+  /**
+  * @brief Restore the state of the window from the given model file.
+  *
+  * @param file Model file.
+  *
+  */
+  void load (const model_file :: reader & file);
+
+};
+
+using convergence_window = convergence_window_ < float >; ///< window of the single precision models
+
+#endif // __convergence_h__
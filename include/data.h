@@ -31,6 +31,7 @@
 
 #include <utils.hpp> // utility functions
 #include <fstream> // file stream
+#include <memory>  // std :: shared_ptr
 
 #ifdef __view__
 
@@ -42,6 +43,163 @@
 namespace data_loader
 {
 
+/**
+* @class buffer_view
+*
+* @brief View of the samples of a dataset buffer
+*
+* @details The object exposes a (possibly strided) sequence of samples
+* stored into a memory region shared with the other views of the same
+* file, i.e. an heap array or a memory mapped file.
+* Each sample is made by sample_size contiguous bytes, while consecutive
+* samples are stride bytes far from each other (e.g. the CIFAR-10 images
+* are interleaved by the label byte).
+* The element access by index follows the sequential (ravel) format of
+* the samples, as a plain array of uint8_t.
+*
+*/
+class buffer_view
+{
+
+  std :: shared_ptr < uint8_t > storage; ///< owner of the memory region (heap array or mapped file)
+  uint8_t * first;                       ///< pointer to the first element of the view
+  int64_t sample_size;                   ///< number of contiguous bytes of each sample
+  int64_t stride;                        ///< number of bytes between the beginning of consecutive samples
+
+public:
+
+  /**
+  * @brief Default constructor (empty view)
+  */
+  buffer_view ();
+
+  /**
+  * @brief Construct the view over the given memory region.
+  *
+  * @param storage Owner of the memory region.
+  * @param offset Position (in bytes) of the first sample in the region.
+  * @param sample_size Number of contiguous bytes of each sample.
+  * @param stride Number of bytes between the beginning of consecutive samples.
+  *
+  */
+  buffer_view (std :: shared_ptr < uint8_t > storage, const int64_t & offset,
+    const int64_t & sample_size, const int64_t & stride);
+
+  /**
+  * @brief Access the i-th element of the sequential buffer.
+  *
+  * @param i Index of the element.
+  *
+  * @return Reference to the element.
+  */
+  inline uint8_t & operator [] (const int64_t & i) const
+  {
+    return this->stride == this->sample_size ? this->first[i] :
+           this->first[(i / this->sample_size) * this->stride + i % this->sample_size];
+  }
+
+  /**
+  * @brief Get the pointer to the first element.
+  *
+  * @note The pointer can be used as sequential buffer only if the view
+  * is contiguous.
+  *
+  * @return Pointer to the first element (nullptr for empty views).
+  */
+  uint8_t * get () const;
+
+  /**
+  * @brief Get the pointer to the given sample.
+  *
+  * @param idx Index of the sample.
+  *
+  * @return Pointer to the sample_size contiguous bytes of the sample.
+  */
+  uint8_t * sample (const int64_t & idx) const;
+
+  /**
+  * @brief Check if the samples are stored without gaps.
+  *
+  * @return True if the view is a sequential buffer.
+  */
+  bool is_contiguous () const;
+
+  /**
+  * @brief Get the distance between consecutive samples.
+  *
+  * @details The value can be used as row stride of the raw (uint8_t)
+  * entry points of the models, so the strided views are used without copy.
+  *
+  * @return Number of bytes between the beginning of consecutive samples.
+  */
+  int64_t get_stride () const;
+
+  /**
+  * @brief Check if the view is not empty.
+  *
+  */
+  explicit operator bool () const;
+
+  /**
+  * @brief Copy the samples into a new (contiguous) heap buffer.
+  *
+  * @param num_samples Number of samples to copy.
+  *
+  * @return The view of the new buffer.
+  */
+  buffer_view clone (const int64_t & num_samples) const;
+
+};
+
+/**
+* @class sample_stream
+*
+* @brief Chunked source of samples for the streaming training
+*
+* @details The object converts the (uint8_t) samples of a buffer view into
+* chunks of float values, following the source signature required by the
+* fit_stream member of the plasticity models.
+* Each call fills the given chunk with the next samples of the buffer,
+* multiplied by the scale factor, and it returns the number of samples written.
+* At the end of the buffer a zero value is returned and the stream restarts
+* from the first sample.
+*
+*/
+class sample_stream
+{
+
+  buffer_view buffer;   ///< view of the samples
+  int64_t num_samples;  ///< number of samples in the buffer
+  int64_t sample_size;  ///< number of values of each sample
+  int64_t position;     ///< index of the next sample to read
+  float scale;          ///< scale factor applied to the values
+
+public:
+
+  /**
+  * @brief Construct the stream over the given buffer.
+  *
+  * @param buffer View of the samples.
+  * @param num_samples Number of samples in the buffer.
+  * @param sample_size Number of values of each sample.
+  * @param scale Scale factor applied to the values (e.g. 1/255).
+  *
+  */
+  sample_stream (const buffer_view & buffer, const int64_t & num_samples,
+    const int64_t & sample_size, const float & scale=1.f);
+
+  /**
+  * @brief Fill the chunk with the next samples.
+  *
+  * @param chunk Output buffer of (at least) max_rows * sample_size values.
+  * @param max_rows Maximum number of samples to write.
+  *
+  * @return The number of samples written (zero at the end of the stream).
+  */
+  int32_t operator () (float * chunk, const int32_t & max_rows);
+
+};
+
 /**
 * @class BaseData
 *
@@ -57,6 +215,10 @@ namespace data_loader
 * the corresponding index.
 * The shape of the images as much as the number of samples are stored
 * into the object.
+* If the memory_map mode is enabled the buffers are views of the (memory
+* mapped) files, so no data is copied at loading time and the pages are
+* shared among processes; the copy-on-write mapping allows the in-place
+* modification of the buffers without touching the files.
 *
 */
 class BaseData
@@ -70,17 +232,22 @@ public:
   int32_t cols; ///< number of columns in each training/testing image
   int32_t channels; ///< number of channels in each training/testing image
 
-  std :: unique_ptr < uint8_t [] > training_images; ///< training image sequential buffer
-  std :: unique_ptr < uint8_t [] > testing_images;  ///< testing image sequential buffer
-  std :: unique_ptr < uint8_t [] > training_labels; ///< training label sequential buffer
-  std :: unique_ptr < uint8_t [] > testing_labels;  ///< testing label sequential buffer
+  bool memory_map; ///< load the files as memory mapped views
+
+  buffer_view training_images; ///< training image sequential buffer
+  buffer_view testing_images;  ///< testing image sequential buffer
+  buffer_view training_labels; ///< training label sequential buffer
+  buffer_view testing_labels;  ///< testing label sequential buffer
 
   // Constructor
 
   /**
   * @brief Default constructor
+  *
+  * @param memory_map Load the files as memory mapped views instead of heap buffers.
+  *
   */
-  BaseData ();
+  BaseData (const bool & memory_map=false);
 
   // Copy Operator and Copy Constructor
 
@@ -89,6 +256,7 @@ public:
   *
   * @details The copy constructor provides a deep copy of the object, i.e. all the
   * arrays are copied and not moved.
+  * Memory mapped views are copied into contiguous heap buffers.
   *
   * @param x BaseData object
   *
@@ -240,6 +408,21 @@ public:
   */
   int32_t test_size ();
 
+protected:
+
+  /**
+  * @brief Open the given binary file.
+  *
+  * @details According to the memory_map member, the file is mapped into
+  * memory (copy-on-write) or its content is read into a single heap buffer.
+  *
+  * @param filename Filename/Path of the binary file.
+  * @param size Number of bytes of the file.
+  *
+  * @return The owner of the memory region of the file.
+  */
+  std :: shared_ptr < uint8_t > open_file (const std :: string & filename, int64_t & size) const;
+
 };
 
 
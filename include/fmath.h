@@ -33,6 +33,12 @@
 
 #include <cmath>    // std :: math functions
 
+#if defined __AVX2__ || defined __AVX512F__
+
+  #include <immintrin.h> // SIMD intrinsics
+
+#endif
+
 namespace math
 {
 
@@ -213,6 +219,215 @@ float sqrt (const float & x);
 */
 float rsqrt (const float & x);
 
+// Packet (SIMD) versions
+
+#ifdef __AVX2__
+
+/**
+* @brief Fast approximation of power of 2 on a packet of 8 floats.
+*
+* @details The approximation is the same of the scalar version applied
+* lane-wise using AVX2 instructions.
+*
+* @note The fast implementation is available if __fast_math__ is defined at compile time.
+* Otherwise the evaluation is performed lane-wise using std functions.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m256 pow2 (const __m256 & x);
+
+/**
+* @brief Fast approximation of exp function on a packet of 8 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m256 exp (const __m256 & x);
+
+/**
+* @brief Fast approximation of log2 function on a packet of 8 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m256 log2 (const __m256 & x);
+
+/**
+* @brief Fast approximation of pow function on a packet of 8 floats.
+*
+* @param a Input packet (base).
+* @param b Input packet (exponent).
+*
+* @return The result of the operation.
+*/
+__m256 pow (const __m256 & a, const __m256 & b);
+
+/**
+* @brief Fast approximation of tanh function on a packet of 8 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m256 tanh (const __m256 & x);
+
+/**
+* @brief Fast approximation of reverse sqrt function on a packet of 8 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m256 rsqrt (const __m256 & x);
+
+#endif // __AVX2__
+
+#ifdef __AVX512F__
+
+/**
+* @brief Fast approximation of power of 2 on a packet of 16 floats.
+*
+* @details The approximation is the same of the scalar version applied
+* lane-wise using AVX-512 instructions.
+*
+* @note The fast implementation is available if __fast_math__ is defined at compile time.
+* Otherwise the evaluation is performed lane-wise using std functions.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m512 pow2 (const __m512 & x);
+
+/**
+* @brief Fast approximation of exp function on a packet of 16 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m512 exp (const __m512 & x);
+
+/**
+* @brief Fast approximation of log2 function on a packet of 16 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m512 log2 (const __m512 & x);
+
+/**
+* @brief Fast approximation of pow function on a packet of 16 floats.
+*
+* @param a Input packet (base).
+* @param b Input packet (exponent).
+*
+* @return The result of the operation.
+*/
+__m512 pow (const __m512 & a, const __m512 & b);
+
+/**
+* @brief Fast approximation of tanh function on a packet of 16 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m512 tanh (const __m512 & x);
+
+/**
+* @brief Fast approximation of reverse sqrt function on a packet of 16 floats.
+*
+* @param x Input packet.
+*
+* @return The result of the operation.
+*/
+__m512 rsqrt (const __m512 & x);
+
+#endif // __AVX512F__
+
+// Span versions
+
+/**
+* @brief Fast approximation of power of 2 on a buffer.
+*
+* @details The buffer is processed using the widest packet available
+* (AVX-512 or AVX2) and the tail with the scalar version.
+* The input and output buffers can be the same (in-place evaluation).
+*
+* @param x Input buffer.
+* @param out Output buffer.
+* @param n Size of the buffers.
+*
+*/
+void pow2 (const float * x, float * out, const int32_t & n);
+
+/**
+* @brief Fast approximation of exp function on a buffer.
+*
+* @details The same considerations of the pow2 span function hold.
+*
+* @param x Input buffer.
+* @param out Output buffer.
+* @param n Size of the buffers.
+*
+*/
+void exp (const float * x, float * out, const int32_t & n);
+
+/**
+* @brief Fast approximation of log2 function on a buffer.
+*
+* @details The same considerations of the pow2 span function hold.
+*
+* @param x Input buffer.
+* @param out Output buffer.
+* @param n Size of the buffers.
+*
+*/
+void log2 (const float * x, float * out, const int32_t & n);
+
+/**
+* @brief Fast approximation of pow function on a buffer with a fixed exponent.
+*
+* @details The same considerations of the pow2 span function hold.
+*
+* @param a Input buffer (base).
+* @param b Exponent.
+* @param out Output buffer.
+* @param n Size of the buffers.
+*
+*/
+void pow (const float * a, const float & b, float * out, const int32_t & n);
+
+/**
+* @brief Fast approximation of tanh function on a buffer.
+*
+* @details The same considerations of the pow2 span function hold.
+*
+* @param x Input buffer.
+* @param out Output buffer.
+* @param n Size of the buffers.
+*
+*/
+void tanh (const float * x, float * out, const int32_t & n);
+
+/**
+* @brief Fast approximation of reverse sqrt function on a buffer.
+*
+* @details The same considerations of the pow2 span function hold.
+*
+* @param x Input buffer.
+* @param out Output buffer.
+* @param n Size of the buffers.
+*
+*/
+void rsqrt (const float * x, float * out, const int32_t & n);
+
 /**
 * @brief Evaluate the sign of the variable.
 *
@@ -0,0 +1,153 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __half_h__
+#define __half_h__
+
+#include <cstdint> // uint16_t
+#include <cstring> // std :: memcpy
+#include <cmath>   // std :: isnan
+
+#if defined __AVX2__ || defined __AVX512F__
+
+  #include <immintrin.h> // SIMD intrinsics
+
+#endif
+
+namespace precision
+{
+
+/**
+* @brief Convert a float to bfloat16.
+*
+* @details The bfloat16 value is the upper half of the float representation,
+* rounded to the nearest even value. NaN values are mapped to a quiet NaN.
+*
+* @param x Input variable.
+*
+* @return The bfloat16 representation.
+*/
+inline uint16_t to_bf16 (const float & x)
+{
+  if ( std :: isnan(x) )
+    return 0x7FC0;
+
+  uint32_t bits;
+  std :: memcpy(&bits, &x, sizeof(float));
+
+  bits += 0x7FFFu + ((bits >> 16) & 1u);
+  return static_cast < uint16_t >(bits >> 16);
+}
+
+/**
+* @brief Convert a bfloat16 to float.
+*
+* @param x Input bfloat16 representation.
+*
+* @return The float value (exact).
+*/
+inline float from_bf16 (const uint16_t & x)
+{
+  const uint32_t bits = static_cast < uint32_t >(x) << 16;
+  float res;
+  std :: memcpy(&res, &bits, sizeof(float));
+  return res;
+}
+
+/**
+* @brief Convert a float to IEEE half precision.
+*
+* @details The value is rounded to the nearest even value, the values out
+* of the half range are mapped to infinity and the small ones to subnormals (or zero).
+*
+* @param x Input variable.
+*
+* @return The half precision representation.
+*/
+uint16_t to_fp16 (const float & x);
+
+/**
+* @brief Convert an IEEE half precision value to float.
+*
+* @param x Input half precision representation.
+*
+* @return The float value (exact).
+*/
+float from_fp16 (const uint16_t & x);
+
+/**
+* @brief Convert an array of floats to bfloat16.
+*
+* @note The conversion is vectorized if AVX2/AVX512 support is enabled.
+*
+* @param x Input array.
+* @param out Output array.
+* @param n Number of elements.
+*
+*/
+void float_to_bf16 (const float * x, uint16_t * out, const int32_t & n);
+
+/**
+* @brief Convert an array of bfloat16 to floats.
+*
+* @note The conversion is vectorized if AVX2/AVX512 support is enabled.
+*
+* @param x Input array.
+* @param out Output array.
+* @param n Number of elements.
+*
+*/
+void bf16_to_float (const uint16_t * x, float * out, const int32_t & n);
+
+/**
+* @brief Convert an array of floats to half precision.
+*
+* @note The conversion is vectorized if AVX512 (or F16C) support is enabled.
+*
+* @param x Input array.
+* @param out Output array.
+* @param n Number of elements.
+*
+*/
+void float_to_fp16 (const float * x, uint16_t * out, const int32_t & n);
+
+/**
+* @brief Convert an array of half precision values to floats.
+*
+* @note The conversion is vectorized if AVX512 (or F16C) support is enabled.
+*
+* @param x Input array.
+* @param out Output array.
+* @param n Number of elements.
+*
+*/
+void fp16_to_float (const uint16_t * x, float * out, const int32_t & n);
+
+} // end namespace precision
+
+#endif // __half_h__
@@ -38,14 +38,39 @@
 *
 * @details
 *
+* @tparam Scalar Type of the weights (float or double).
+*
 */
-class Hopfield : public BasePlasticity
+template < class Scalar >
+class Hopfield_ : public BasePlasticity_ < Scalar >
 {
 
+public:
+
+  using matrix_t = typename BasePlasticity_ < Scalar > :: matrix_t; ///< matrix of the model values
+  using vector_t = typename BasePlasticity_ < Scalar > :: vector_t; ///< column vector of the model values
+
+private:
+
   int32_t k;    ///< ranking parameter
   float delta;  ///< Strength of the anti-hebbian learning
   float p;      ///< Lebesque norm of weights
 
+  Eigen :: VectorXi yl_first; ///< sparse ranking matrix: row of the first ranked unit (value 1) for each sample (batch)
+  Eigen :: VectorXi yl_kth;   ///< sparse ranking matrix: row of the k-th ranked unit (value -delta) for each sample (batch)
+  vector_t y_first;           ///< output of the first ranked unit for each sample (batch)
+  vector_t y_kth;             ///< output of the k-th ranked unit for each sample (batch)
+
+  matrix_t rank_values;          ///< running top-k values of each sample (k, batch)
+  Eigen :: MatrixXi rank_index;  ///< running top-k units of each sample (k, batch)
+  matrix_t tiles;                ///< workspace of the output tiles, one for each thread (tile_rows, tile_cols * n_threads)
+  matrix_t scatter_update;          ///< transposed weights update accumulated by the scatter-add (n_features, outputs)
+
+  static constexpr int32_t tile_rows = 128; ///< number of units of an output tile
+  static constexpr int32_t tile_cols = 512; ///< number of samples of an output tile
+  matrix_t wnorm;          ///< cache of the normalized weights (outputs, n_features)
+  int64_t wnorm_version;   ///< weights version of the cached normalized weights
+
 
 public:
 
@@ -71,7 +96,7 @@ public:
   * @param k Ranking parameter, must be integer that is bigger or equal than 2.
   *
   */
-  Hopfield (const int32_t & outputs, const int32_t & batch_size,
+  Hopfield_ (const int32_t & outputs, const int32_t & batch_size,
     update_args optimizer=update_args(optimizer_t :: sgd),
     weights_initialization weights_init=weights_initialization(weights_init_t :: normal),
     int32_t epochs_for_convergency=1, float convergency_atol=0.01,
@@ -90,7 +115,7 @@ public:
   * @param b Hopfield object
   *
   */
-  Hopfield (const Hopfield & b);
+  Hopfield_ (const Hopfield_ & b);
 
   /**
   * @brief Copy operator.
@@ -102,7 +127,7 @@ public:
   * @param b Hopfield object
   *
   */
-  Hopfield & operator = (const Hopfield & b);
+  Hopfield_ & operator = (const Hopfield_ & b);
 
   // Destructor
 
@@ -113,30 +138,104 @@ public:
   * the arrays.
   *
   */
-  ~Hopfield () = default;
+  ~Hopfield_ () = default;
 
 private:
 
   /**
   * @brief Check the given parameters.
   *
-  * @note The function checks if the input variable k is positive defined
-  * and greater than 2.
+  * @note The function checks if the input variable k is positive defined,
+  * greater than 2 and not greater than the number of outputs.
   *
   */
   void check_params ();
 
+  /**
+  * @brief Reset the running ranking of the given sample.
+  *
+  * @param i Index of the sample (column) in the batch.
+  *
+  */
+  void reset_rank (const int32_t & i);
+
+  /**
+  * @brief Merge a segment of output column into the running ranking of the given sample.
+  *
+  * @note The ranking does not require the full sort of the column, but
+  * only a partial selection: the two largest values are tracked for k = 2,
+  * while a bounded min-heap of k elements is used otherwise.
+  * Since the state is kept along the calls, the column can be given
+  * by segments (e.g. the rows of an output tile).
+  *
+  * @param col Pointer to the segment of the output column.
+  * @param n Number of values in the segment.
+  * @param offset Index of the unit corresponding to the first value of the segment.
+  * @param i Index of the sample (column) in the batch.
+  *
+  */
+  void merge_rank (const Scalar * col, const int32_t & n, const int32_t & offset, const int32_t & i);
+
+  /**
+  * @brief Store the units ranked first and k-th (and their outputs) of the given sample.
+  *
+  * @param i Index of the sample (column) in the batch.
+  *
+  */
+  void select_rank (const int32_t & i);
+
+  /**
+  * @brief Compute the weights update from the ranking of the batch.
+  *
+  * @note The theta array and the weights update are evaluated using only the
+  * sparse entries of the ranking matrix, i.e. the first and k-th ranked units.
+  *
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  *
+  */
+  void ranking_update_into (const matrix_t & X, matrix_t & weights_update);
+
   /**
   * @brief Approximation introduced by Krotov.
   *
   * @note Instead of solving dynamical equations we use the currents as a proxy
   * for ranking of the final activities.
   *
-  * @param X array in ravel format of the input variables/features.
-  * @param output Output of the model as computed by the _predict function
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param output Output of the model as computed by the _predict_into function
+  * @param weights_update Matrix of updates (aka dW) for weights.
   *
   */
-  Eigen :: MatrixXf weights_update (const Eigen :: MatrixXf & X, const Eigen :: MatrixXf & output);
+  void weights_update_into (const matrix_t & X, const matrix_t & output,
+    matrix_t & weights_update);
+
+  /**
+  * @brief Fused forward and ranking of the training step.
+  *
+  * @note The product W @ X is evaluated by tiles of (units, samples) and each
+  * tile is merged into the running top-k of its samples while it is in cache,
+  * so the full output matrix is never stored along the training.
+  * The blocks of samples are independent, so they are distributed among the threads.
+  *
+  * @param X Batch of data (n_features, batch), i.e. one sample for each column.
+  * @param weights_update Matrix of updates (aka dW) for weights.
+  *
+  */
+  void forward_update_into (const matrix_t & X, matrix_t & weights_update);
+
+  /**
+  * @brief Allocate the training workspace.
+  *
+  * @note In addition to the base buffers, the function allocates
+  * the ranking matrix, the output tiles and the normalized weights used
+  * by the Hopfield rule.
+  * The output workspace is released, since the training never stores it.
+  *
+  * @param n_features Number of features in the training set.
+  *
+  */
+  void init_workspace (const int32_t & n_features);
 
   /**
   * @brief Apply the Lebesgue norm to the weights.
@@ -148,23 +247,73 @@ private:
   * W = sign(W) * abs(W)**(p - 1)
   * \f]
   *
+  * and it stores the result into the wnorm cache.
+  * Integer and half-integer exponents are evaluated with products
+  * (and a square root) without any call to the pow function.
+  *
   */
   void normalize_weights ();
 
+  /**
+  * @brief Get the matrix applied to the input data in the forward step.
+  *
+  * @note For p = 2 the weights matrix is returned, otherwise the normalized
+  * weights are cached and re-computed only when the weights change.
+  *
+  * @return View of the forward matrix (outputs, n_features).
+  *
+  */
+  Eigen :: Map < const matrix_t > forward_weights ();
+
+  /**
+  * @brief Store the hyperparameters and the arrays of the model.
+  *
+  * @note In addition to the base members, the ranking parameter,
+  * the anti-hebbian strength and the Lebesgue norm are stored.
+  *
+  * @param file Model file builder.
+  *
+  */
+  void save_state (model_file :: writer & file) const;
+
+  /**
+  * @brief Restore the hyperparameters and the arrays of the model.
+  *
+  * @param file Model file.
+  *
+  */
+  void load_state (const model_file :: reader & file);
+
+  /**
+  * @brief Estimate the cost of the training stages for a batch.
+  *
+  * @note The forward is the dense product W @ X, while the update adds (or
+  * subtracts) each sample only to the rows of the first and k-th ranked
+  * units and then it applies the theta scaling and the normalization to dW.
+  *
+  * @param n_features Number of features in the training set.
+  * @param flops Floating point operations of each stage (stage_t).
+  * @param bytes Bytes moved by each stage (stage_t).
+  *
+  */
+  void stage_costs (const int32_t & n_features,
+    std :: array < double, num_stages > & flops, std :: array < double, num_stages > & bytes) const;
+
   /**
   * @brief Core function of the predict formula
   *
-  * @note The function computes the output as W @ X.T.
+  * @note The function computes the output as W @ X, with the samples stored as columns of X.
   * We use the GEMM algorithm with OpenMP support for a fast evaluation
   *
-  * @param data Input matrix of data
-  *
-  * @return Output matrix of the model.
+  * @param data Input matrix of data (n_features, n_samples)
+  * @param output Output matrix of the model.
   *
   */
-  Eigen :: MatrixXf _predict (const Eigen :: MatrixXf & data);
+  void _predict_into (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output);
 
 };
 
+using Hopfield = Hopfield_ < float >; ///< single precision Hopfield model (Cython interface)
+
 
 #endif // __hopfield_h__
@@ -0,0 +1,239 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __inference_h__
+#define __inference_h__
+
+#include <base.h>
+
+#include <atomic>  // std :: atomic
+#include <chrono>  // std :: chrono :: microseconds
+#include <future>  // std :: promise, std :: future
+#include <memory>  // std :: unique_ptr
+#include <thread>  // std :: thread
+#include <vector>  // std :: vector
+
+/**
+* @class request_queue
+*
+* @brief Bounded lock-free queue of prediction requests.
+*
+* @details The queue is a ring buffer in which each slot stores a sequence
+* counter together with the request. Producers and consumers reserve a slot
+* with a single compare-and-swap on the enqueue/dequeue position and the
+* sequence counter of the slot publishes the request to the other side,
+* so multiple producers (client threads) and consumers never take a lock.
+*
+*/
+class request_queue
+{
+
+public:
+
+  /**
+  * @brief Single sample prediction request.
+  *
+  */
+  struct request
+  {
+    const float * sample;         ///< input sample (n_features)
+    float * output;               ///< output buffer (outputs)
+    std :: promise < void > done; ///< completion signal of the request
+  };
+
+private:
+
+  struct slot
+  {
+    std :: atomic < int64_t > sequence; ///< publication counter of the slot
+    request data;                       ///< stored request
+  };
+
+  std :: unique_ptr < slot [] > buffer; ///< ring buffer of slots
+  int64_t mask;                         ///< capacity - 1 (the capacity is a power of 2)
+
+  alignas(64) std :: atomic < int64_t > enqueue_pos; ///< position of the next push
+  alignas(64) std :: atomic < int64_t > dequeue_pos; ///< position of the next pop
+
+public:
+
+  /**
+  * @brief Construct the queue.
+  *
+  * @param capacity Minimum number of requests stored (rounded to the next power of 2).
+  *
+  */
+  request_queue (const int64_t & capacity);
+
+  // Destructor
+  ~request_queue () = default;
+
+  /**
+  * @brief Push a request into the queue.
+  *
+  * @param req Request to move into the queue.
+  *
+  * @return False if the queue is full (the request is not moved).
+  */
+  bool push (request & req);
+
+  /**
+  * @brief Pop a request from the queue.
+  *
+  * @param req Destination of the popped request.
+  *
+  * @return False if the queue is empty.
+  */
+  bool pop (request & req);
+
+};
+
+
+/**
+* @class inference_engine
+*
+* @brief Batched streaming inference of a fitted model.
+*
+* @details The engine serves single sample predictions submitted by any
+* number of client threads. The requests are stored into a lock-free queue
+* and a worker thread coalesces them into micro-batches, so that the model
+* output is evaluated with a single GEMM for the whole batch instead of
+* a GEMV for each sample.
+* A micro-batch is processed when it reaches the maximum batch size or when
+* the maximum latency has elapsed since its first request was collected.
+* All the buffers are allocated only once in the constructor.
+*
+* @note The model must be fitted before the construction of the engine and
+* it must not be modified (trained) while the engine is running, since the
+* worker thread reads the model weights without any synchronization.
+*
+*/
+class inference_engine
+{
+
+  BasePlasticity & model; ///< fitted model used for the prediction
+
+  int32_t n_features;     ///< number of input features
+  int32_t outputs;        ///< number of hidden units
+  int32_t max_batch;      ///< maximum number of samples in a micro-batch
+  std :: chrono :: microseconds max_latency; ///< maximum waiting time of the first request of a micro-batch
+
+  request_queue queue;    ///< queue of the pending requests
+
+  std :: vector < request_queue :: request > pending; ///< requests of the current micro-batch
+  Eigen :: MatrixXf batch_data;   ///< buffer of the micro-batch samples (n_features, max_batch)
+  Eigen :: MatrixXf batch_output; ///< buffer of the micro-batch outputs (outputs, max_batch)
+
+  std :: atomic < bool > running;       ///< flag of the worker loop
+  std :: atomic < int64_t > num_requests; ///< number of served requests
+  std :: atomic < int64_t > num_batches;  ///< number of processed micro-batches
+
+  std :: thread worker; ///< worker thread
+
+public:
+
+  /**
+  * @brief Construct the engine and start the worker thread.
+  *
+  * @param model Fitted model (BCM or Hopfield).
+  * @param max_batch Maximum number of samples in a micro-batch.
+  * @param max_latency Maximum waiting time (microseconds) before processing an incomplete micro-batch.
+  *
+  */
+  inference_engine (BasePlasticity & model, const int32_t & max_batch=64,
+    const std :: chrono :: microseconds & max_latency=std :: chrono :: microseconds(200));
+
+  // Copy Operator and Copy Constructor
+
+  inference_engine (const inference_engine & e) = delete;
+  inference_engine & operator = (const inference_engine & e) = delete;
+
+  /**
+  * @brief Destructor.
+  *
+  * @details The pending requests are served before the worker thread is joined.
+  *
+  */
+  ~inference_engine ();
+
+  /**
+  * @brief Submit a single sample prediction.
+  *
+  * @note The function returns immediately: the output buffer is filled
+  * by the worker thread and the returned future becomes ready when the
+  * prediction is available. Both the buffers must be kept alive until then.
+  *
+  * @param sample Input sample (n_features values).
+  * @param output Output buffer (outputs values).
+  *
+  * @return Future of the request completion.
+  */
+  std :: future < void > submit (const float * sample, float * output);
+
+  /**
+  * @brief Predict a single sample (blocking call).
+  *
+  * @param sample Input sample (n_features values).
+  * @param output Output buffer (outputs values).
+  *
+  */
+  void predict (const float * sample, float * output);
+
+  /**
+  * @brief Get the number of served requests.
+  *
+  */
+  int64_t get_num_requests () const;
+
+  /**
+  * @brief Get the number of processed micro-batches.
+  *
+  */
+  int64_t get_num_batches () const;
+
+private:
+
+  /**
+  * @brief Main loop of the worker thread.
+  *
+  */
+  void serve ();
+
+  /**
+  * @brief Evaluate the model output for the pending requests.
+  *
+  * @note The samples are copied into the columns of the batch buffer,
+  * the output is evaluated by the model and then it is scattered into
+  * the request buffers. Possible errors are forwarded to the requests.
+  *
+  */
+  void process_batch ();
+
+};
+
+#endif // __inference_h__
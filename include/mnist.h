@@ -66,8 +66,11 @@ public:
 
   /**
   * @brief Default constructor
+  *
+  * @param memory_map Load the files as memory mapped views instead of heap buffers.
+  *
   */
-  MNIST ();
+  MNIST (const bool & memory_map=false);
 
   // Copy Operator and Copy Constructor
 
@@ -174,7 +177,7 @@ private:
   * @param nsample Number of training/test variable set into this function.
   *
   */
-  void load_file (const std :: string & filename, std :: unique_ptr < uint8_t [] > & buffer,
+  void load_file (const std :: string & filename, buffer_view & buffer,
     const uint32_t & magic_key, int32_t & nsample);
 
   /*!
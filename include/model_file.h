@@ -0,0 +1,377 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __model_file_h__
+#define __model_file_h__
+
+#include <utils.h>
+
+#include <map>        // std :: map
+#include <memory>     // std :: shared_ptr
+#include <sstream>    // std :: ostringstream
+#include <string>     // std :: string
+#include <vector>     // std :: vector
+
+#include <Eigen/Dense>
+
+namespace model_file
+{
+
+/**
+* @brief Identifiers of the sections stored in a model file
+*
+*/
+enum section_t { params_section = 0, weights_section, theta_section, interaction_section,
+                 m_section, v_section, history_section, indices_section, sum_theta_section,
+                 history_min_section, envelope_section };
+
+/**
+* @brief Data type of a section
+*
+*/
+enum dtype_t { text_data = 0, float_data, int32_data, double_data };
+
+/**
+* @brief Binary layout of the model file.
+*
+* @details The file starts with a fixed size header, followed by the table
+* of the sections and by the sections data:
+*
+* | header (64 bytes) | section table (48 bytes x n) | pad | section 0 | pad | section 1 | ...
+*
+* Each section starts at a 64-byte aligned offset, so the float matrices can be
+* used directly from a memory mapping of the file (the mapping itself is page aligned).
+* The matrices are stored in column-major order, as the Eigen matrices.
+* The header stores the (native) byte order tag and the CRC-32C checksum of the
+* section table, while each entry of the table stores the checksum of its section.
+*
+*/
+static constexpr char magic[8] = {'P', 'L', 'A', 'S', 'T', 'I', 'C', '\0'}; ///< file signature
+static constexpr uint32_t format_version = 1;                               ///< version of the file layout
+static constexpr uint32_t byte_order = 0x01020304;                          ///< tag of the byte order
+static constexpr int64_t alignment = 64;                                    ///< alignment (in bytes) of the sections
+
+/**
+* @brief Header of the model file.
+*
+*/
+struct header
+{
+  char magic[8];           ///< file signature
+  uint32_t version;        ///< version of the file layout
+  uint32_t byte_order;     ///< tag of the byte order used by the writer
+  uint32_t num_sections;   ///< number of entries in the section table
+  uint32_t table_checksum; ///< CRC-32C of the section table
+  uint64_t file_size;      ///< size of the whole file (in bytes)
+  uint8_t reserved[32];    ///< reserved for future uses (zeros)
+};
+
+/**
+* @brief Entry of the section table.
+*
+*/
+struct section_entry
+{
+  uint32_t id;       ///< section identifier (section_t)
+  uint32_t dtype;    ///< data type of the section (dtype_t)
+  uint64_t offset;   ///< position of the section from the beginning of the file
+  uint64_t size;     ///< size of the section (in bytes)
+  int64_t rows;      ///< number of rows of the matrix (or number of bytes of the text)
+  int64_t cols;      ///< number of columns of the matrix (1 for the text)
+  uint32_t checksum; ///< CRC-32C of the section data
+  uint32_t reserved; ///< padding (zero)
+};
+
+static_assert(sizeof(header) == 64, "Invalid size of the model file header");
+static_assert(sizeof(section_entry) == 48, "Invalid size of the model file section entry");
+
+/**
+* @brief Compute the CRC-32C (Castagnoli) checksum of a buffer.
+*
+* @details The hardware instructions are used if available (SSE4.2).
+*
+* @param data Pointer to the buffer.
+* @param size Size of the buffer (in bytes).
+* @param crc Initial value of the checksum (to compute it by pieces).
+*
+* @return The checksum of the buffer.
+*/
+uint32_t crc32c (const void * data, const int64_t & size, uint32_t crc=0);
+
+
+/**
+* @class writer
+*
+* @brief Builder of a model file.
+*
+* @details The hyperparameters are collected as (key, value) pairs and they are
+* stored as a text section ("key=value" lines), while the matrices are stored as
+* raw float sections.
+*
+* @note By default the matrices are not copied: they must be valid until the save call.
+* An owning writer copies them instead, so it can be saved later (e.g. by a background task)
+* while the original arrays are modified.
+*
+*/
+class writer
+{
+
+  std :: map < std :: string, std :: string > params;   ///< hyperparameters of the model
+  std :: vector < section_entry > entries;              ///< sections of the arrays
+  std :: vector < const void * > buffers;               ///< data of the arrays
+  std :: vector < std :: vector < uint8_t > > storage;  ///< copies of the arrays (owning writer)
+  bool owning;                                          ///< copy the arrays into the writer
+
+public:
+
+  /**
+  * @brief Constructor.
+  *
+  * @param owning Copy the arrays into the writer.
+  *
+  */
+  writer (const bool & owning=false);
+
+  /**
+  * @brief Set the value of a hyperparameter.
+  *
+  * @details The floating point values are printed with the number of
+  * digits required for an exact round trip.
+  *
+  * @param key Name of the hyperparameter.
+  * @param value Value of the hyperparameter.
+  *
+  * @tparam T Type of the value (any type with the stream operator).
+  *
+  */
+  template < class T >
+  void set (const std :: string & key, const T & value)
+  {
+    std :: ostringstream os;
+    os.precision(9);
+    os << value;
+    this->params[key] = os.str();
+  }
+
+  /**
+  * @brief Add a matrix section.
+  *
+  * @param id Identifier of the section (section_t).
+  * @param matrix Matrix to store (column-major).
+  *
+  */
+  void add (const int32_t & id, const Eigen :: Ref < const Eigen :: MatrixXf > & matrix);
+
+  /**
+  * @brief Add a matrix section in double precision.
+  *
+  * @param id Identifier of the section (section_t).
+  * @param matrix Matrix to store (column-major).
+  *
+  */
+  void add (const int32_t & id, const Eigen :: Ref < const Eigen :: MatrixXd > & matrix);
+
+  /**
+  * @brief Add an integer array section.
+  *
+  * @param id Identifier of the section (section_t).
+  * @param data Pointer to the array.
+  * @param size Number of elements of the array.
+  *
+  */
+  void add (const int32_t & id, const int32_t * data, const int64_t & size);
+
+  /**
+  * @brief Check if the writer copies the arrays.
+  *
+  */
+  bool is_owning () const;
+
+  /**
+  * @brief Write the model file.
+  *
+  * @param filename Filename or path of the file.
+  *
+  */
+  void save (const std :: string & filename) const;
+
+private:
+
+  /**
+  * @brief Append a section to the table.
+  *
+  * @param entry Entry of the section (without offset and checksum).
+  * @param data Pointer to the section data (copied by an owning writer).
+  *
+  */
+  void push (const section_entry & entry, const void * data);
+
+};
+
+
+/**
+* @class reader
+*
+* @brief Read-only view of a model file.
+*
+* @details The file can be memory mapped (read-only), so the matrices are used
+* without any copy and the pages are shared among the processes which map the
+* same file, or it can be read into an heap buffer.
+* The header, the byte order and the table of the sections are always validated,
+* while the checksums of the sections are verified only if required.
+*
+*/
+class reader
+{
+
+  std :: shared_ptr < uint8_t > storage;              ///< owner of the memory region (heap buffer or mapped file)
+  int64_t size;                                       ///< size of the file
+  std :: vector < section_entry > entries;            ///< table of the sections
+  std :: map < std :: string, std :: string > params; ///< hyperparameters of the model
+
+public:
+
+  /**
+  * @brief Open the model file.
+  *
+  * @param filename Filename or path of the file.
+  * @param memory_map Map the file instead of reading it.
+  * @param verify Verify the checksums of all the sections.
+  *
+  */
+  reader (const std :: string & filename, const bool & memory_map=true, const bool & verify=true);
+
+  /**
+  * @brief Check if the given file is a model file (by its signature).
+  *
+  * @param filename Filename or path of the file.
+  *
+  * @return True if the file starts with the model file signature.
+  */
+  static bool is_model_file (const std :: string & filename);
+
+  /**
+  * @brief Check if the file stores the given section.
+  *
+  * @param id Identifier of the section (section_t).
+  *
+  */
+  bool has (const int32_t & id) const;
+
+  /**
+  * @brief Get the view of a matrix section.
+  *
+  * @note The view is valid until the reader (or a copy of it) is alive.
+  * The section must store values of the requested type (float_data or double_data).
+  *
+  * @param id Identifier of the section (section_t).
+  *
+  * @tparam Scalar Type of the matrix values (float or double).
+  *
+  * @return Read-only map of the matrix.
+  */
+  template < class Scalar = float >
+  Eigen :: Map < const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > > matrix (const int32_t & id) const;
+
+  /**
+  * @brief Get the view of an integer array section.
+  *
+  * @note The view is valid until the reader (or a copy of it) is alive.
+  *
+  * @param id Identifier of the section (section_t).
+  *
+  * @return Read-only map of the array.
+  */
+  Eigen :: Map < const Eigen :: VectorXi > index_array (const int32_t & id) const;
+
+  /**
+  * @brief Check if the file stores the given hyperparameter.
+  *
+  * @param key Name of the hyperparameter.
+  *
+  */
+  bool has (const std :: string & key) const;
+
+  /**
+  * @brief Get the value of a hyperparameter.
+  *
+  * @param key Name of the hyperparameter.
+  *
+  * @tparam T Type of the value (any type with the stream operator).
+  *
+  * @return The value of the hyperparameter.
+  */
+  template < class T >
+  T get (const std :: string & key) const
+  {
+    const auto it = this->params.find(key);
+
+    if ( it == this->params.end() )
+      throw std :: runtime_error("Invalid model file. Missing hyperparameter: " + key);
+
+    T value;
+    std :: istringstream is(it->second);
+    is >> value;
+
+    return value;
+  }
+
+private:
+
+  /**
+  * @brief Find the entry of the given section.
+  *
+  * @param id Identifier of the section (section_t).
+  *
+  * @return Pointer to the entry (nullptr if not found).
+  */
+  const section_entry * find (const int32_t & id) const;
+
+};
+
+/**
+* @brief Get the value of a text hyperparameter.
+*
+* @note The whole value is returned, including the eventual spaces.
+*
+*/
+template < >
+inline std :: string reader :: get < std :: string > (const std :: string & key) const
+{
+  const auto it = this->params.find(key);
+
+  if ( it == this->params.end() )
+    throw std :: runtime_error("Invalid model file. Missing hyperparameter: " + key);
+
+  return it->second;
+}
+
+} // end namespace model_file
+
+
+#endif // __model_file_h__
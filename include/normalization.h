@@ -0,0 +1,123 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __normalization_h__
+#define __normalization_h__
+
+#include <cstdint> // uint8_t
+#include <cmath>   // std :: fma
+
+#if defined __AVX2__ || defined __AVX512F__
+
+  #include <immintrin.h> // SIMD intrinsics
+
+#endif
+
+
+/**
+* @class input_normalization
+*
+* @brief Conversion of raw (uint8_t) input data into the float values used by the models
+*
+* @details The object describes the preprocessing of the raw pixels
+* (e.g. the MNIST/CIFAR-10 images) as
+*
+* \f[
+* x_{float} = x \cdot scale + offset
+* \f]
+*
+* or, if the binarization is enabled, as
+*
+* \f[
+* x_{float} = x > threshold
+* \f]
+*
+* The conversion is performed on the fly (in the batch gather of the models),
+* so the float copy of the whole dataset is never stored.
+*
+*/
+class input_normalization
+{
+
+public:
+
+  float scale;       ///< Scale factor of the raw values
+  float offset;      ///< Offset added to the scaled values
+  bool binarize;     ///< Enable the binarization of the raw values
+  int32_t threshold; ///< Binarization threshold (raw values greater than it are set to 1)
+
+  // Constructors
+
+  /**
+  * @brief Construct the object using the list of parameters.
+  *
+  * @param scale Scale factor of the raw values (e.g. 1/255).
+  * @param offset Offset added to the scaled values.
+  * @param binarize Enable the binarization of the raw values (scale and offset are ignored).
+  * @param threshold Binarization threshold.
+  *
+  */
+  input_normalization (float scale=1.f, float offset=0.f, bool binarize=false, int32_t threshold=0);
+
+  // Destructors
+
+  /**
+  * @brief Destructor.
+  *
+  */
+  ~input_normalization () = default;
+
+  /**
+  * @brief Convert a buffer of raw values.
+  *
+  * @details The conversion uses the AVX2/AVX-512 instructions (if available)
+  * to process 8/16 values at once.
+  * All the paths (SIMD lanes and scalar tail) compute the value as a single
+  * fused multiply-add, so the result does not depend on the instruction set
+  * or on the position of the value in the buffer.
+  *
+  * @param x Input buffer of raw values.
+  * @param out Output buffer of float values.
+  * @param n Number of values to convert.
+  *
+  */
+  void apply (const uint8_t * x, float * out, const int32_t & n) const;
+
+  /**
+  * @brief Convert a buffer of raw values in double precision.
+  *
+  * @param x Input buffer of raw values.
+  * @param out Output buffer of double values.
+  * @param n Number of values to convert.
+  *
+  */
+  void apply (const uint8_t * x, double * out, const int32_t & n) const;
+
+};
+
+#endif // __normalization_h__
@@ -30,10 +30,13 @@
 #define __update_args_h__
 
 #include <fmath.h>       // fast math functions
+#include <model_file.h>  // model_file :: writer
 
 #include <iostream>      // std :: cerr
 #include <unordered_map> // std :: unordered_map
+#include <algorithm>     // std :: min
 #include <Eigen/Dense>   // Eigen classes
+#include <vector>        // std :: vector
 
 
 enum optimizer_t { adam = 0, momentum, nesterov_momentum,
@@ -41,6 +44,9 @@ enum optimizer_t { adam = 0, momentum, nesterov_momentum,
                    adamax, sgd
 }; ///< optimizer types
 
+enum state_precision_t { float32 = 0, float16, bfloat16, float64
+}; ///< storage precision of the optimizer supporting arrays
+
 namespace optimizer
 {
 
@@ -81,13 +87,17 @@ static const std :: unordered_map < std :: string, int32_t > get_optimizer {
 class update_args
 {
 
-  static float epsil; ///< Numerical precision
-
 protected:
 
   Eigen :: MatrixXf m; ///< Adam supporting array
   Eigen :: MatrixXf v; ///< Adam supporting array
 
+  Eigen :: MatrixXd m_double; ///< Adam supporting array in double precision
+  Eigen :: MatrixXd v_double; ///< Adam supporting array in double precision
+
+  std :: vector < uint16_t > m_half; ///< Adam supporting array in reduced precision
+  std :: vector < uint16_t > v_half; ///< Adam supporting array in reduced precision
+
 public:
 
   int32_t type;        ///< Optimization type to use
@@ -99,6 +109,10 @@ public:
   float B2;            ///< Adam-like parameter
   float rho;           ///< Decay factor
 
+  int32_t state_precision; ///< Storage precision of the supporting arrays
+
+  static float epsil; ///< Numerical precision
+
   // Constructors
 
   /**
@@ -123,10 +137,12 @@ public:
   * @param B1 Adam parameter.
   * @param B2 Adam parameter.
   * @param rho TODO.
+  * @param state_precision Storage precision of the supporting arrays (float32, float16, bfloat16 or float64).
   *
   */
   update_args (const int32_t & type, float learning_rate=0.02, float momentum=.9f,
-    float decay=0.0001, float B1=.9f, float B2=.999f, float rho=0.f);
+    float decay=0.0001, float B1=.9f, float B2=.999f, float rho=0.f,
+    int32_t state_precision=state_precision_t :: float32);
 
   // Destructors
 
@@ -169,102 +185,212 @@ public:
   *
   * @details This function init the member arrays used for the
   * optimization steps.
+  * With a reduced state precision the arrays are stored as 16 bit
+  * values (half the memory traffic of the update), while all the
+  * computations are still performed in the precision of the weights
+  * (float or double).
+  *
+  * @note With the float16 precision the arrays of squared values
+  * (e.g. the Adam second moment) are stored as bfloat16: the float16
+  * format flushes to zero the values lower than ~6e-8, i.e. the
+  * (1 - B2) g^2 term of the gradients lower than ~8e-3 (with the
+  * default B2), and the step m / (sqrt(v) + epsil) would be inflated
+  * up to 1/epsil.
   *
   * @param rows Number of weights/parameters rows to update.
   * @param cols Number of weights/parameters cols to update.
   */
   void init_arrays (const int32_t & rows, const int32_t & cols);
 
+  /**
+  * @brief Check if the member arrays are allocated for the given number of weights.
+  *
+  * @param rows Number of weights/parameters rows to update.
+  * @param cols Number of weights/parameters cols to update.
+  *
+  * @return True if the arrays are already initialized with the given shape.
+  */
+  bool has_arrays (const int32_t & rows, const int32_t & cols) const;
+
+  /**
+  * @brief Store the supporting arrays in the given model file.
+  *
+  * @details The reduced precision arrays are expanded into floats,
+  * which represent exactly all the 16 bit values, while the float64
+  * arrays are stored as double sections.
+  *
+  * @note The expanded arrays are temporary, so they require an owning writer.
+  *
+  * @param file Model file builder.
+  */
+  void save_arrays (model_file :: writer & file) const;
+
+  /**
+  * @brief Restore the supporting arrays from the given model file.
+  *
+  * @details The arrays are converted into the current state precision.
+  *
+  * @param file Model file.
+  */
+  void load_arrays (const model_file :: reader & file);
+
+  /**
+  * @brief Get the memory traffic of an update step for each weight.
+  *
+  * @details The weights are read and written, the weights update is read
+  * and each supporting array used by the algorithm is read and written
+  * in the storage precision.
+  *
+  * @param scalar_size Size in bytes of the weights (e.g. sizeof(double) for a double model).
+  *
+  * @return Number of bytes moved by the update of a single weight.
+  */
+  int32_t nbytes_per_weight (const int32_t & scalar_size=sizeof(float)) const;
+
   /**
   * @brief Update the given parameters using the optimization algorithm
   *
   * @details This is the core functio of the object.
+  * The runtime type of the optimizer selects the corresponding
+  * (pre-instantiated) policy kernel, i.e. the templated update member
+  * is called with the policy of the optimizer namespace.
+  *
+  * @tparam Scalar Type of the weights (float or double).
   *
   * @param iteration Current iteration number
   * @param weights Array of input parameters
   * @param weights_update Array of input gradients.
+  * @param n_threads Number of threads to use (effective only with OpenMP support).
   *
   */
-  void update ( const int32_t & iteration, Eigen :: MatrixXf & weights,
-    const Eigen :: MatrixXf & weights_update );
-
-private:
+  template < class Scalar >
+  void update ( const int32_t & iteration, Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights,
+    const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights_update, const int32_t & n_threads=1 );
 
   /**
-  * @brief Adam optimization step
+  * @brief Update the given parameters using the given optimization policy
+  *
+  * @details The update of the weights and of the supporting arrays is performed
+  * by a single fused pass over the memory: the arrays are split in blocks
+  * small enough to stay in cache, and each block is fully updated by the
+  * (vectorized) kernel of the policy, inlined at compile time, before moving
+  * to the next one. The blocks are distributed among the given number of threads.
+  * When the storage precision differs from the precision of the weights
+  * (e.g. a reduced state precision) each block of the supporting arrays
+  * is expanded into a buffer of weights type before the kernel call and
+  * then rounded back into the storage.
+  *
+  * @note The policy must match the type of the optimizer, since the supporting
+  * arrays are shared between the algorithms with a different meaning.
+  *
+  * @tparam Policy Optimization policy (e.g. optimizer :: Adam).
+  * @tparam Scalar Type of the weights (float or double).
   *
   * @param iteration Current iteration number
   * @param weights Array of input parameters
   * @param weights_update Array of input gradients.
+  * @param n_threads Number of threads to use (effective only with OpenMP support).
+  *
+  */
+  template < class Policy, class Scalar >
+  void update ( const int32_t & iteration, Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights,
+    const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights_update, const int32_t & n_threads=1 );
+
+private:
+
+  static constexpr int32_t block_size = 1024; ///< number of elements processed by each kernel call
+
+  /**
+  * @brief Get the number of elements of the supporting arrays.
   *
+  * @return The size of the arrays in the current storage precision.
   */
-  void adam_update ( const int32_t & iteration, Eigen :: MatrixXf & weights,
-    const Eigen :: MatrixXf & weights_update );
+  int64_t num_states () const;
 
   /**
-  * @brief Stochastic Gradient Descent optimization step
+  * @brief Get the storage precision of a supporting array.
   *
-  * @param weights Array of input parameters
-  * @param weights_update Array of input gradients.
+  * @details The arrays of squared values use the bfloat16 format
+  * in place of the float16 one, since they need the float range.
+  *
+  * @param squared True if the array stores squared values.
   *
+  * @return The precision of the array (state_precision_t).
   */
-  void sgd_update ( Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update );
+  int32_t array_precision ( const bool & squared ) const;
 
   /**
-  * @brief Momentum optimization step
+  * @brief Check which supporting arrays store squared values.
   *
-  * @param weights Array of input parameters
-  * @param weights_update Array of input gradients.
+  * @details The flags are given by the policy of the current optimizer type.
+  *
+  * @param squared_m Flag of the first supporting array.
+  * @param squared_v Flag of the second supporting array.
   *
   */
-  void momentum_update ( Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update );
+  void squared_arrays ( bool & squared_m, bool & squared_v ) const;
 
   /**
-  * @brief Nesterov momentum optimization step
+  * @brief Expand a block of a reduced precision array into floats.
   *
-  * @param weights Array of input parameters
-  * @param weights_update Array of input gradients.
+  * @param x Block of the reduced precision array.
+  * @param out Float buffer.
+  * @param n Number of elements.
+  * @param format Storage precision of the array (float16 or bfloat16).
   *
   */
-  void nesterov_momentum_update ( Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update );
+  static void load_state ( const uint16_t * x, float * out, const int32_t & n, const int32_t & format );
 
   /**
-  * @brief AdaDrad optimization step
+  * @brief Round a float buffer into a block of a reduced precision array.
   *
-  * @param weights Array of input parameters
-  * @param weights_update Array of input gradients.
+  * @param x Float buffer.
+  * @param out Block of the reduced precision array.
+  * @param n Number of elements.
+  * @param format Storage precision of the array (float16 or bfloat16).
   *
   */
-  void adagrad_update ( Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update );
+  static void store_state ( const float * x, uint16_t * out, const int32_t & n, const int32_t & format );
 
   /**
-  * @brief RMSProp optimization step
+  * @brief Expand a block of a supporting array into a buffer of weights type.
   *
-  * @param weights Array of input parameters
-  * @param weights_update Array of input gradients.
+  * @details The block is read from the storage of the current precision.
+  *
+  * @tparam Scalar Type of the weights (float or double).
+  *
+  * @param first True for the first supporting array (m), false for the second one (v).
+  * @param offset Position of the block in the array.
+  * @param out Buffer of the block.
+  * @param n Number of elements.
+  * @param format Storage precision of the array.
   *
   */
-  void rmsprop_update ( Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update );
+  template < class Scalar >
+  void load_block ( const bool & first, const int32_t & offset, Scalar * out, const int32_t & n, const int32_t & format ) const;
 
   /**
-  * @brief AdaDelta optimization step
+  * @brief Round a buffer of weights type into a block of a supporting array.
   *
-  * @param weights Array of input parameters
-  * @param weights_update Array of input gradients.
+  * @tparam Scalar Type of the weights (float or double).
+  *
+  * @param first True for the first supporting array (m), false for the second one (v).
+  * @param x Buffer of the block.
+  * @param offset Position of the block in the array.
+  * @param n Number of elements.
+  * @param format Storage precision of the array.
   *
   */
-  void adadelta_update ( Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update );
+  template < class Scalar >
+  void store_block ( const bool & first, const Scalar * x, const int32_t & offset, const int32_t & n, const int32_t & format );
 
   /**
-  * @brief AdaMax optimization step
+  * @brief Apply the learning rate decay.
   *
   * @param iteration Current iteration number
-  * @param weights Array of input parameters
-  * @param weights_update Array of input gradients.
   *
   */
-  void adamax_update ( const int32_t & iteration, Eigen :: MatrixXf & weights,
-    const Eigen :: MatrixXf & weights_update );
+  void decay_learning_rate ( const int32_t & iteration );
 
 };
 
@@ -0,0 +1,124 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __prefetch_h__
+#define __prefetch_h__
+
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <thread>
+#include <exception>
+#include <condition_variable>
+
+/**
+* @class prefetch_worker
+*
+* @brief Persistent background thread which runs a task on request.
+*
+* @details The worker is started once (e.g. for the whole training) and
+* it runs the given task each time a request is submitted, so the next
+* batch (or chunk) is loaded while the current one is processed without
+* creating a thread (and its shared state) for each of them.
+* The task is stored by value and called with the argument of the request,
+* i.e. the task writes into the second slot of a double buffer, while
+* the caller uses the first one. The caller waits the end of the request
+* before swapping the slots and submitting the next request.
+*
+* @note Only one request can be pending at a time.
+*
+* @tparam Task void function (lambda) with a const int32_t & argument.
+*
+*/
+template < class Task >
+class prefetch_worker
+{
+
+  Task task;                         ///< function called by the worker
+  int32_t arg;                       ///< argument of the pending request
+  bool pending;                      ///< true while a request is waiting or running
+  bool stop;                         ///< true when the worker must exit
+  std :: exception_ptr error;        ///< exception raised by the last request (if any)
+
+  std :: mutex mtx;                  ///< lock of the request state
+  std :: condition_variable ready;   ///< notification of the request state changes
+  std :: thread worker;              ///< background thread
+
+public:
+
+  // Constructors
+
+  /**
+  * @brief Start the background thread.
+  *
+  * @param task Function called at each request.
+  *
+  */
+  prefetch_worker (Task task);
+
+  // Destructors
+
+  /**
+  * @brief Stop and join the background thread.
+  *
+  * @details A running request is completed before the exit, while
+  * a request not yet started is discarded.
+  *
+  */
+  ~prefetch_worker ();
+
+  // the thread can not be shared
+  prefetch_worker (const prefetch_worker & w) = delete;
+  prefetch_worker & operator = (const prefetch_worker & w) = delete;
+
+  /**
+  * @brief Submit a new request.
+  *
+  * @param arg Argument of the task.
+  *
+  */
+  void submit (const int32_t & arg);
+
+  /**
+  * @brief Wait the end of the pending request (if any).
+  *
+  * @note The exception raised by the task is re-thrown by this function.
+  *
+  */
+  void wait ();
+
+private:
+
+  /**
+  * @brief Main loop of the background thread.
+  *
+  */
+  void run ();
+};
+
+#endif // __prefetch_h__
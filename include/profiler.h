@@ -0,0 +1,256 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __profiler_h__
+#define __profiler_h__
+
+#include <array>   // std :: array
+#include <chrono>  // std :: chrono :: steady_clock
+#include <string>  // std :: string
+#include <vector>  // std :: vector
+
+/**
+* @brief Stages of a training step recorded by the profiler
+*
+* @details The forward_update stage is the whole computation of the output and
+* of the weights update: the models with a fused kernel record only this one,
+* while the default (two step) implementation records also its predict and
+* weights_update parts.
+*
+*/
+enum stage_t { gather_stage = 0, forward_update_stage, predict_stage, weights_update_stage,
+               decay_stage, optimizer_stage, callback_stage, num_stages };
+
+
+/**
+* @class training_profiler
+*
+* @brief Per batch timing of the training stages.
+*
+* @details For each batch the wall time of each stage is recorded, while the
+* number of floating point operations and the bytes moved by each stage are
+* estimated once from the shape of the problem (they are the same for all the batches),
+* so the throughput (GFLOP/s) and the bandwidth (GB/s) of each stage can be evaluated.
+* The gather stage is the time spent by the training thread to provide the next batch,
+* i.e. the copy of the rows or the wait of the background prefetch.
+* The records can be exported as JSON or CSV traces.
+*
+*/
+class training_profiler
+{
+
+public:
+
+  /**
+  * @brief Timing of a batch.
+  *
+  */
+  struct record
+  {
+    int32_t epoch;                                ///< epoch of the batch (zero for the partial_fit)
+    int32_t batch;                                ///< index of the batch in the epoch (optimizer iteration for the partial_fit)
+    std :: array < double, num_stages > seconds;  ///< wall time of each stage
+  };
+
+private:
+
+  std :: vector < record > records;             ///< timing of the batches
+  std :: array < double, num_stages > flops;    ///< floating point operations of each stage for a batch
+  std :: array < double, num_stages > bytes;    ///< bytes moved by each stage for a batch
+
+public:
+
+  // Constructors
+
+  /**
+  * @brief Default constructor (empty trace).
+  *
+  */
+  training_profiler ();
+
+  // Destructors
+
+  ~training_profiler () = default;
+
+  /**
+  * @brief Set the estimated cost of the stages and clear the trace.
+  *
+  * @param flops Floating point operations of each stage for a batch.
+  * @param bytes Bytes moved by each stage for a batch.
+  *
+  */
+  void start (const std :: array < double, num_stages > & flops, const std :: array < double, num_stages > & bytes);
+
+  /**
+  * @brief Set the estimated cost of the stages (the trace is kept).
+  *
+  * @param flops Floating point operations of each stage for a batch.
+  * @param bytes Bytes moved by each stage for a batch.
+  *
+  */
+  void set_costs (const std :: array < double, num_stages > & flops, const std :: array < double, num_stages > & bytes);
+
+  /**
+  * @brief Start the record of a new batch.
+  *
+  * @param epoch Epoch of the batch (zero for the partial_fit).
+  * @param batch Index of the batch in the epoch (optimizer iteration for the partial_fit).
+  *
+  */
+  void begin_batch (const int32_t & epoch, const int32_t & batch);
+
+  /**
+  * @brief Add the elapsed time of a stage to the current batch.
+  *
+  * @param stage Stage of the training step (stage_t).
+  * @param seconds Elapsed time.
+  *
+  */
+  void add (const int32_t & stage, const double & seconds);
+
+  /**
+  * @brief Clear the trace.
+  *
+  */
+  void clear ();
+
+  /**
+  * @brief Get the recorded batches.
+  *
+  */
+  const std :: vector < record > & get_records () const;
+
+  /**
+  * @brief Get the total time of a stage along the trace.
+  *
+  * @param stage Stage of the training step (stage_t).
+  *
+  * @return The sum of the stage times of all the batches (seconds).
+  */
+  double total (const int32_t & stage) const;
+
+  /**
+  * @brief Get the throughput of a stage along the trace.
+  *
+  * @param stage Stage of the training step (stage_t).
+  *
+  * @return The estimated GFLOP/s of the stage (zero if not recorded).
+  */
+  double gflops (const int32_t & stage) const;
+
+  /**
+  * @brief Get the bandwidth of a stage along the trace.
+  *
+  * @param stage Stage of the training step (stage_t).
+  *
+  * @return The estimated GB/s of the stage (zero if not recorded).
+  */
+  double bandwidth (const int32_t & stage) const;
+
+  /**
+  * @brief Get the name of a stage.
+  *
+  * @param stage Stage of the training step (stage_t).
+  *
+  */
+  static std :: string stage_name (const int32_t & stage);
+
+  /**
+  * @brief Write the trace as a JSON file.
+  *
+  * @details The file stores the estimated cost of each stage for a batch,
+  * the summary (total time, GFLOP/s and GB/s) of each stage and the list of
+  * the batches with the time of each stage.
+  *
+  * @param filename Filename or path of the file.
+  *
+  */
+  void save_json (const std :: string & filename) const;
+
+  /**
+  * @brief Write the trace as a CSV file.
+  *
+  * @details The file stores a row for each (batch, stage) pair, with the
+  * columns epoch, batch, stage, seconds, gflops and gbytes_per_second.
+  *
+  * @param filename Filename or path of the file.
+  *
+  */
+  void save_csv (const std :: string & filename) const;
+
+};
+
+
+/**
+* @class stage_timer
+*
+* @brief Scoped timer of a training stage.
+*
+* @details The elapsed time between the construction and the destruction
+* of the object is added to the current batch of the profiler.
+* With a null profiler the timer does nothing (not even the clock read).
+*
+*/
+class stage_timer
+{
+
+  training_profiler * profiler;                                ///< destination of the timing (nullptr = disabled)
+  int32_t stage;                                               ///< stage of the training step
+  std :: chrono :: time_point < std :: chrono :: steady_clock > start; ///< starting time
+
+public:
+
+  /**
+  * @brief Start the timer.
+  *
+  * @param profiler Destination of the timing (nullptr disables the timer).
+  * @param stage Stage of the training step (stage_t).
+  *
+  */
+  stage_timer (training_profiler * profiler, const int32_t & stage) : profiler (profiler), stage (stage), start ()
+  {
+    if ( this->profiler )
+      this->start = std :: chrono :: steady_clock :: now();
+  }
+
+  /**
+  * @brief Stop the timer and record the elapsed time.
+  *
+  */
+  ~stage_timer ()
+  {
+    if ( this->profiler )
+      this->profiler->add(this->stage, std :: chrono :: duration < double >(std :: chrono :: steady_clock :: now() - this->start).count());
+  }
+
+  stage_timer (const stage_timer &) = delete;
+  stage_timer & operator = (const stage_timer &) = delete;
+
+};
+
+#endif // __profiler_h__
@@ -0,0 +1,208 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#ifndef __quantized_h__
+#define __quantized_h__
+
+#include <normalization.h>
+
+#include <memory>     // std :: unique_ptr
+#include <vector>     // std :: vector
+#include <functional> // std :: function
+
+#include <Eigen/Dense>
+
+/**
+* @brief Precision of the quantized weights
+*
+*/
+enum quantization_t { int8 = 0, bf16 };
+
+
+/**
+* @class quantized_model
+*
+* @brief Frozen reduced-precision copy of a fitted model for the inference.
+*
+* @details The object stores the forward matrix of the model (i.e. the weights
+* with the interaction/normalization already applied) in reduced precision,
+* together with its activation function, and it evaluates the model output
+* directly on raw uint8 inputs.
+*
+* - int8: each row of the weights is quantized symmetrically with its own scale
+* factor (max(|w|) / 127). The products are evaluated as int8 x uint8 dot products
+* accumulated in int32 (VNNI instructions if available) and the input normalization
+* is folded into the de-quantization of the result:
+*
+* \f[
+* y_i = s_i (scale * \sum_j q_{ij} u_j + offset * \sum_j q_{ij})
+* \f]
+*
+* - bf16: each weight is stored as the upper half of its float representation
+* (round to nearest even) and the products are accumulated in float.
+*
+* In both cases the weights are 4x (int8) or 2x (bf16) smaller than the float ones.
+*
+*/
+class quantized_model
+{
+
+  int32_t type;       ///< quantization type
+  int32_t outputs;    ///< number of hidden units
+  int32_t n_features; ///< number of input features
+  int32_t ld;         ///< leading dimension (padded row length) of the quantized weights
+
+  std :: vector < int8_t > qweights;     ///< int8 weights in row-major order (outputs, ld)
+  std :: vector < int32_t > row_sums;    ///< sum of the int8 weights of each row
+  std :: vector < float > scales;        ///< de-quantization scale of each row
+  std :: vector < uint16_t > bweights;   ///< bf16 weights in row-major order (outputs, ld)
+
+  std :: function < void(float *, const int32_t &) > batch_activation; ///< vectorized activation function
+
+  int32_t num_threads; ///< number of threads used by the parallel sections (OpenMP)
+
+  std :: vector < uint8_t > ubuf;  ///< workspace of the binarized samples, one tile for each thread (int8)
+  std :: vector < int32_t > dots;  ///< workspace of the int32 products, one tile for each thread (int8)
+  std :: vector < float > xbuf;    ///< workspace of the normalized (padded) samples, one tile for each thread (bf16)
+  std :: vector < float > ybuf;    ///< workspace of the output, one tile for each thread (bf16)
+
+public:
+
+  // Constructors
+
+  /**
+  * @brief Default constructor (empty model).
+  *
+  */
+  quantized_model ();
+
+  /**
+  * @brief Quantize the given forward matrix.
+  *
+  * @param weights Forward matrix of the model (outputs, n_features).
+  * @param batch_activation Vectorized activation function applied to the output.
+  * @param type Quantization type (int8 or bf16).
+  * @param num_threads Number of threads used in the prediction.
+  *
+  */
+  quantized_model (const Eigen :: Ref < const Eigen :: MatrixXf > & weights,
+    std :: function < void(float *, const int32_t &) > batch_activation,
+    const int32_t & type=quantization_t :: int8, const int32_t & num_threads=1);
+
+  // Destructors
+
+  ~quantized_model () = default;
+
+  /**
+  * @brief Predict the model output on raw inputs.
+  *
+  * @param X Input matrix of raw values in ravel format (n_samples, n_features).
+  * @param n_samples Number of samples.
+  * @param n_features Number of features.
+  * @param stride Distance (in bytes) between the beginning of consecutive samples (n_features for packed samples).
+  * @param norm Conversion of the raw values (the same used in the training).
+  *
+  * @return Output buffer of the model (outputs, n_samples) in column-major ravel format.
+  */
+  std :: unique_ptr < float [] > predict (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+    const int64_t & stride, const input_normalization & norm=input_normalization());
+
+  /**
+  * @brief Predict the model output on raw inputs into the given buffer.
+  *
+  * @note The tiles are processed in the workspace of the object, so the
+  * concurrent calls on the same object are not allowed.
+  *
+  * @param X Input matrix of raw values in ravel format (n_samples, n_features).
+  * @param n_samples Number of samples.
+  * @param n_features Number of features.
+  * @param stride Distance (in bytes) between the beginning of consecutive samples (n_features for packed samples).
+  * @param norm Conversion of the raw values (the same used in the training).
+  * @param output Output buffer with at least outputs * n_samples values.
+  *
+  */
+  void predict_into (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+    const int64_t & stride, const input_normalization & norm, float * output);
+
+  /**
+  * @brief Get the de-quantized weights.
+  *
+  * @return The approximated forward matrix (outputs, n_features).
+  */
+  Eigen :: MatrixXf get_weights () const;
+
+  /**
+  * @brief Get the quantization type.
+  *
+  */
+  int32_t get_type () const;
+
+  /**
+  * @brief Get the memory size of the quantized weights.
+  *
+  * @return Number of bytes of the weights and of the de-quantization parameters.
+  */
+  int64_t nbytes () const;
+
+  /**
+  * @brief Set the number of threads used in the prediction.
+  *
+  * @param n_threads Number of threads (ignored if the library is built without OpenMP support).
+  *
+  */
+  void set_num_threads (const int32_t & n_threads);
+
+private:
+
+  /**
+  * @brief Allocate the workspace of the tiles for the current number of threads.
+  *
+  */
+  void init_workspace ();
+
+  /**
+  * @brief Evaluate the int8 products of a tile of samples.
+  *
+  * @param u Raw (or binarized) samples of the tile.
+  * @param dot Output of the int32 dot products with the rows of the weights (tile, outputs).
+  *
+  */
+  void dot_int8 (const uint8_t * const * u, int32_t * dot) const;
+
+  /**
+  * @brief Evaluate the bf16 products of a tile of samples.
+  *
+  * @param x Normalized samples of the tile (padded to the leading dimension).
+  * @param y Output of the model (tile, outputs).
+  *
+  */
+  void dot_bf16 (const float * const * x, float * y) const;
+
+};
+
+#endif // __quantized_h__
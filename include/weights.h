@@ -169,6 +169,18 @@ public:
   */
   void init (float * weights, const int32_t & inputs, const int32_t & outputs);
 
+  /**
+  * @brief Init the weights of a double precision model
+  *
+  * @details The values are drawn as in the float version and then
+  * converted, so the models of different precision start from the same weights.
+  *
+  * @param weights Matrix of weights in ravel format.
+  * @param inputs Number of rows of the weight matrix.
+  * @param outputs Number of columns of the weight matrix.
+  */
+  void init (double * weights, const int32_t & inputs, const int32_t & outputs);
+
 private:
 
   /**
@@ -6,6 +6,13 @@ from libcpp.string cimport string
 from update_args cimport update_args
 from weights_initialization cimport weights_initialization
 
+cdef extern from "profiler.h" nogil:
+
+  cppclass training_profiler:
+
+    void save_json (const string & filename) except +
+    void save_csv (const string & filename) except +
+
 cdef extern from "bcm.h" nogil:
 
   cppclass BCM:
@@ -17,12 +24,21 @@ cdef extern from "bcm.h" nogil:
     ## Methods
 
     void fit (float * X, const int & n_samples, const int & n_features, const int & num_epochs, int seed) except +
-    float * predict (const float * X, const int & n_samples, const int & n_features) except +
+    void partial_fit (const float * X, const int & n_samples, const int & n_features) except +
+    void predict_into (const float * X, const int & n_samples, const int & n_features, float * output) except +
 
     void save_weights (const string & filename) except +
     void load_weights (const string & filename) except +
+    void load_mmap (const string & filename, bint verify) except +
+
+    void set_checkpoint (const string & filename, const int & frequency, const int & unit) except +
+    void resume (const string & filename) except +
+    void set_convergence_check (const int & check) except +
+    void set_profiling (const bint & enable) except +
+    training_profiler & get_profiler ()
 
-    float * get_weights ()
+    const float * get_weights ()
+    void set_weights (const float * W, const int & outputs, const int & n_features) except +
 
 cdef extern from "<utility>" namespace "std" nogil:
 
@@ -35,22 +35,56 @@ cdef class _BCM:
     self.n_features = n_features
     deref(self.thisptr).fit(&X[0], n_samples, n_features, num_epochs, seed)
 
+  def partial_fit (self, float[::1] X, int n_samples, int n_features):
+
+    self.n_features = n_features
+    deref(self.thisptr).partial_fit(&X[0], n_samples, n_features)
+
   def predict (self, float[::1] X, int n_samples, int n_features):
 
-    cdef float * res = deref(self.thisptr).predict(&X[0], n_samples, n_features)
-    return np.asarray(<np.float32_t[: self.outputs * n_samples]> res)
+    output = np.empty(shape=(self.outputs * n_samples, ), dtype=np.float32)
+    cdef float[::1] res = output
+    deref(self.thisptr).predict_into(&X[0], n_samples, n_features, &res[0])
+    return output
 
   def get_weights (self):
 
     if self.n_features == 0:
       return (None, None)
 
-    cdef float * w = deref(self.thisptr).get_weights()
-    weights = np.asarray(<np.float32_t[:self.outputs * self.n_features]> w)
+    # NOTE: the view is read-only, the weights are modified by the set_weights function
+    cdef const float * w = deref(self.thisptr).get_weights()
+    weights = np.asarray(<const np.float32_t[:self.outputs * self.n_features]> w)
     return weights.reshape(self.outputs, self.n_features)
 
+  def set_weights (self, float[::1] W, int n_features):
+
+    self.n_features = n_features
+    deref(self.thisptr).set_weights(&W[0], self.outputs, n_features)
+
   def save_weights (self, string filename):
     deref(self.thisptr).save_weights(filename)
 
   def load_weights (self, string filename):
     deref(self.thisptr).load_weights(filename)
+
+  def load_mmap (self, string filename, bint verify=True):
+    deref(self.thisptr).load_mmap(filename, verify)
+
+  def set_checkpoint (self, string filename, int frequency, int unit=0):
+    deref(self.thisptr).set_checkpoint(filename, frequency, unit)
+
+  def resume (self, string filename):
+    deref(self.thisptr).resume(filename)
+
+  def set_convergence_check (self, int check):
+    deref(self.thisptr).set_convergence_check(check)
+
+  def set_profiling (self, bint enable):
+    deref(self.thisptr).set_profiling(enable)
+
+  def save_profile (self, string filename):
+    if filename.endswith(b'.csv'):
+      deref(self.thisptr).get_profiler().save_csv(filename)
+    else:
+      deref(self.thisptr).get_profiler().save_json(filename)
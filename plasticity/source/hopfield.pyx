@@ -4,6 +4,9 @@
 from libcpp.string cimport string
 from cython.operator cimport dereference as deref
 
+cimport numpy as np
+import numpy as np
+
 from hopfield cimport Hopfield
 from update_args cimport _update_args
 from weights_initialization cimport _weights_initialization
@@ -33,21 +36,54 @@ cdef class _Hopfield:
     self.n_features = n_features
     deref(self.thisptr).fit(&X[0], n_samples, n_features, num_epochs, seed)
 
+  def partial_fit (self, float[::1] X, int n_samples, int n_features):
+
+    self.n_features = n_features
+    deref(self.thisptr).partial_fit(&X[0], n_samples, n_features)
+
   def predict (self, float[::1] X, int n_samples, int n_features):
 
-    cdef float * res = deref(self.thisptr).predict(&X[0], n_samples, n_features)
-    return [res[i] for i in range(self.outputs * n_samples)]
+    output = np.empty(shape=(self.outputs * n_samples, ), dtype=np.float32)
+    cdef float[::1] res = output
+    deref(self.thisptr).predict_into(&X[0], n_samples, n_features, &res[0])
+    return output
 
   def get_weights (self):
 
     if self.n_features == 0:
       return (None, None)
 
-    cdef float * w = deref(self.thisptr).get_weights()
+    cdef const float * w = deref(self.thisptr).get_weights()
     return ([w[i] for i in range(self.outputs * self.n_features)], (self.outputs, self.n_features))
 
+  def set_weights (self, float[::1] W, int n_features):
+
+    self.n_features = n_features
+    deref(self.thisptr).set_weights(&W[0], self.outputs, n_features)
+
   def save_weights (self, string filename):
     deref(self.thisptr).save_weights(filename)
 
   def load_weights (self, string filename):
     deref(self.thisptr).load_weights(filename)
+
+  def load_mmap (self, string filename, bint verify=True):
+    deref(self.thisptr).load_mmap(filename, verify)
+
+  def set_checkpoint (self, string filename, int frequency, int unit=0):
+    deref(self.thisptr).set_checkpoint(filename, frequency, unit)
+
+  def resume (self, string filename):
+    deref(self.thisptr).resume(filename)
+
+  def set_convergence_check (self, int check):
+    deref(self.thisptr).set_convergence_check(check)
+
+  def set_profiling (self, bint enable):
+    deref(self.thisptr).set_profiling(enable)
+
+  def save_profile (self, string filename):
+    if filename.endswith(b'.csv'):
+      deref(self.thisptr).get_profiler().save_csv(filename)
+    else:
+      deref(self.thisptr).get_profiler().save_json(filename)
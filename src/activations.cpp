@@ -26,12 +26,10 @@
 //
 //M*/
 
-#include <activations.h>
+#include <activations.hpp>
 
 namespace transfer
 {
-  static __unused float leaky_coeff = 1e-1f; ///< Internal coefficient of Leaky activation function
-  static __unused float steepness = 1.f;     ///< Internal coefficient of Elliot function
 
   float linear (const float & x)
   {
@@ -251,7 +249,8 @@ namespace transfer
     return (temp + 1.f) * (2.f - temp - 1.f);
   }
 
-  std :: function < float(const float &) > activate ( const int32_t & active)
+  template < >
+  std :: function < float(const float &) > activate < float > ( const int32_t & active)
   {
     switch (active)
     {
@@ -278,7 +277,8 @@ namespace transfer
     }
   }
 
-  std :: function < float(const float &) > gradient ( const int32_t & active)
+  template < >
+  std :: function < float(const float &) > gradient < float > ( const int32_t & active)
   {
     switch (active)
     {
@@ -306,4 +306,100 @@ namespace transfer
   }
 
 
+
+  template < class Scalar >
+  std :: function < void(Scalar *, const int32_t &) > activate_array ( const int32_t & active)
+  {
+    switch (active)
+    {
+      case transfer_t :: logistic:       return Logistic :: activate < Scalar >;
+      case transfer_t :: loggy:          return Loggy :: activate < Scalar >;
+      case transfer_t :: relu:           return Relu :: activate < Scalar >;
+      case transfer_t :: elu:            return Elu :: activate < Scalar >;
+      case transfer_t :: relie:          return Relie :: activate < Scalar >;
+      case transfer_t :: ramp:           return Ramp :: activate < Scalar >;
+      case transfer_t :: linear:         return Linear :: activate < Scalar >;
+      case transfer_t :: Tanh:           return Tanhy :: activate < Scalar >;
+      case transfer_t :: plse:           return Plse :: activate < Scalar >;
+      case transfer_t :: leaky:          return Leaky :: activate < Scalar >;
+      case transfer_t :: stair:          return Stair :: activate < Scalar >;
+      case transfer_t :: hardtan:        return Hardtan :: activate < Scalar >;
+      case transfer_t :: lhtan:          return Lhtan :: activate < Scalar >;
+      case transfer_t :: selu:           return Selu :: activate < Scalar >;
+      case transfer_t :: elliot:         return Elliot :: activate < Scalar >;
+      case transfer_t :: symm_elliot:    return SymmElliot :: activate < Scalar >;
+      case transfer_t :: softplus:       return Softplus :: activate < Scalar >;
+      case transfer_t :: softsign:       return Softsign :: activate < Scalar >;
+      case transfer_t :: asymm_logistic: return AsymmLogistic :: activate < Scalar >;
+      default:                           return nullptr;
+    }
+  }
+
+  template < class Scalar >
+  std :: function < void(Scalar *, const int32_t &) > gradient_array ( const int32_t & active)
+  {
+    switch (active)
+    {
+      case transfer_t :: logistic:       return Logistic :: gradient < Scalar >;
+      case transfer_t :: loggy:          return Loggy :: gradient < Scalar >;
+      case transfer_t :: relu:           return Relu :: gradient < Scalar >;
+      case transfer_t :: elu:            return Elu :: gradient < Scalar >;
+      case transfer_t :: relie:          return Relie :: gradient < Scalar >;
+      case transfer_t :: ramp:           return Ramp :: gradient < Scalar >;
+      case transfer_t :: linear:         return Linear :: gradient < Scalar >;
+      case transfer_t :: Tanh:           return Tanhy :: gradient < Scalar >;
+      case transfer_t :: plse:           return Plse :: gradient < Scalar >;
+      case transfer_t :: leaky:          return Leaky :: gradient < Scalar >;
+      case transfer_t :: stair:          return Stair :: gradient < Scalar >;
+      case transfer_t :: hardtan:        return Hardtan :: gradient < Scalar >;
+      case transfer_t :: lhtan:          return Lhtan :: gradient < Scalar >;
+      case transfer_t :: selu:           return Selu :: gradient < Scalar >;
+      case transfer_t :: elliot:         return Elliot :: gradient < Scalar >;
+      case transfer_t :: symm_elliot:    return SymmElliot :: gradient < Scalar >;
+      case transfer_t :: softplus:       return Softplus :: gradient < Scalar >;
+      case transfer_t :: softsign:       return Softsign :: gradient < Scalar >;
+      case transfer_t :: asymm_logistic: return AsymmLogistic :: gradient < Scalar >;
+      default:                           return nullptr;
+    }
+  }
+
+  template < class Scalar >
+  std :: function < Scalar(const Scalar &) > activate ( const int32_t & active)
+  {
+    const auto batch = transfer :: activate_array < Scalar >(active);
+
+    if ( ! batch )
+      return nullptr;
+
+    return [batch] (const Scalar & x)
+           {
+             Scalar y = x;
+             batch(&y, 1);
+             return y;
+           };
+  }
+
+  template < class Scalar >
+  std :: function < Scalar(const Scalar &) > gradient ( const int32_t & active)
+  {
+    const auto batch = transfer :: gradient_array < Scalar >(active);
+
+    if ( ! batch )
+      return nullptr;
+
+    return [batch] (const Scalar & x)
+           {
+             Scalar y = x;
+             batch(&y, 1);
+             return y;
+           };
+  }
+
+  template std :: function < void(float *, const int32_t &) > activate_array < float > ( const int32_t & active );
+  template std :: function < void(double *, const int32_t &) > activate_array < double > ( const int32_t & active );
+  template std :: function < void(float *, const int32_t &) > gradient_array < float > ( const int32_t & active );
+  template std :: function < void(double *, const int32_t &) > gradient_array < double > ( const int32_t & active );
+  template std :: function < double(const double &) > activate < double > ( const int32_t & active );
+  template std :: function < double(const double &) > gradient < double > ( const int32_t & active );
+
 }
@@ -26,18 +26,28 @@
 //
 //M*/
 
-#include <base.h>
+#include <base.hpp>
 
-float BasePlasticity :: precision = 1e-30f;
+template < class Scalar >
+Scalar BasePlasticity_ < Scalar > :: precision = static_cast < Scalar >(1e-30);
 
-BasePlasticity :: BasePlasticity () : optimizer (), w_init (), weights (),
+template < class Scalar >
+BasePlasticity_ < Scalar > :: BasePlasticity_ () : optimizer (), w_init (), weights (),
   history (), theta (), activation (nullptr), gradient (nullptr),
-  batch (100), outputs (100), epochs_for_convergency (0), convergency_atol (0.f),
-  decay (0.f)
+  batch_activation (nullptr), batch_gradient (nullptr),
+  batch (100), outputs (100), epochs_for_convergency (0), convergency_check (convergence_t :: epoch_check), convergency_atol (0.f),
+  decay (0.f), weights_version (0), iteration (0), pending (), num_pending (0),
+  num_threads (1), activation_type (transfer_t :: logistic), mapping (nullptr),
+  checkpoint_file (), checkpoint_frequency (0), checkpoint_unit (checkpoint_t :: per_epoch), checkpoint_task (),
+  resume_point (nullptr), profiling (false), profiler ()
 {
+#ifdef _OPENMP
+  this->num_threads = omp_get_max_threads();
+#endif
 }
 
-BasePlasticity :: BasePlasticity (const int32_t & outputs, const int32_t & batch_size,
+template < class Scalar >
+BasePlasticity_ < Scalar > :: BasePlasticity_ (const int32_t & outputs, const int32_t & batch_size,
   int32_t activation,
   update_args optimizer,
   weights_initialization weights_init,
@@ -45,65 +55,149 @@ BasePlasticity :: BasePlasticity (const int32_t & outputs, const int32_t & batch
   float decay
   ) : optimizer (optimizer), w_init (weights_init), weights (), history (),
       theta (), activation (nullptr), gradient (nullptr),
+      batch_activation (nullptr), batch_gradient (nullptr),
       batch (batch_size), outputs (outputs), epochs_for_convergency (epochs_for_convergency),
-      convergency_atol (convergency_atol), decay (decay)
+      convergency_check (convergence_t :: epoch_check),
+      convergency_atol (convergency_atol), decay (decay), weights_version (0),
+      iteration (0), pending (), num_pending (0), num_threads (1),
+      activation_type (activation), mapping (nullptr),
+      checkpoint_file (), checkpoint_frequency (0), checkpoint_unit (checkpoint_t :: per_epoch), checkpoint_task (),
+      resume_point (nullptr), profiling (false), profiler ()
 {
+#ifdef _OPENMP
+  this->num_threads = omp_get_max_threads();
+#endif
+
   // correct epochs_for_convergency
   //this->epochs_for_convergency = std :: max(this->epochs_for_convergency, 1);
 
-  this->activation = transfer :: activate( activation );
-  this->gradient   = transfer :: gradient( activation );
+  this->activation = transfer :: activate < Scalar >( activation );
+  this->gradient   = transfer :: gradient < Scalar >( activation );
+
+  this->batch_activation = transfer :: activate_array < Scalar >( activation );
+  this->batch_gradient   = transfer :: gradient_array < Scalar >( activation );
 }
 
-BasePlasticity :: BasePlasticity (const BasePlasticity & b)
+template < class Scalar >
+BasePlasticity_ < Scalar > :: BasePlasticity_ (const BasePlasticity_ & b)
 {
   this->activation = b.activation;
   this->gradient   = b.gradient;
 
+  this->batch_activation = b.batch_activation;
+  this->batch_gradient   = b.batch_gradient;
+
   this->batch    = b.batch;
   this->outputs  = b.outputs;
   this->epochs_for_convergency = b.epochs_for_convergency;
+  this->convergency_check = b.convergency_check;
 
   this->convergency_atol = b.convergency_atol;
+  this->decay = b.decay;
 
   this->optimizer = b.optimizer;
   this->w_init = b.w_init;
 
   this->weights = b.weights;
-
-  //this->theta = b.theta; // it is useless
+  this->theta = b.theta;
+  this->history = b.history;
+  this->weights_version = b.weights_version;
+  this->iteration = b.iteration;
+  this->pending = b.pending;
+  this->num_pending = b.num_pending;
+  this->num_threads = b.num_threads;
+
+  this->activation_type = b.activation_type;
+  this->mapping = b.mapping;
+
+  // NOTE: the pending checkpoint and the resume point belong to the original object
+  this->checkpoint_file = b.checkpoint_file;
+  this->checkpoint_frequency = b.checkpoint_frequency;
+  this->checkpoint_unit = b.checkpoint_unit;
+
+  this->profiling = b.profiling;
+  this->profiler = b.profiler;
 }
 
-BasePlasticity & BasePlasticity :: operator = (const BasePlasticity & b)
+template < class Scalar >
+BasePlasticity_ < Scalar > & BasePlasticity_ < Scalar > :: operator = (const BasePlasticity_ & b)
 {
   this->activation = b.activation;
   this->gradient   = b.gradient;
 
+  this->batch_activation = b.batch_activation;
+  this->batch_gradient   = b.batch_gradient;
+
   this->batch    = b.batch;
   this->outputs  = b.outputs;
   this->epochs_for_convergency = b.epochs_for_convergency;
+  this->convergency_check = b.convergency_check;
 
   this->convergency_atol = b.convergency_atol;
+  this->decay = b.decay;
 
   this->optimizer = b.optimizer;
   this->w_init = b.w_init;
 
   this->weights = b.weights;
+  this->theta = b.theta;
+  this->history = b.history;
+  this->weights_version = b.weights_version;
+  this->iteration = b.iteration;
+  this->pending = b.pending;
+  this->num_pending = b.num_pending;
+  this->num_threads = b.num_threads;
+
+  this->activation_type = b.activation_type;
+  this->mapping = b.mapping;
+
+  // NOTE: the pending checkpoint and the resume point belong to the original object
+  this->checkpoint_file = b.checkpoint_file;
+  this->checkpoint_frequency = b.checkpoint_frequency;
+  this->checkpoint_unit = b.checkpoint_unit;
 
-  //this->theta = b.theta; // it is useless
+  this->profiling = b.profiling;
+  this->profiler = b.profiler;
 
   return *this;
 }
 
-float * BasePlasticity :: predict (float * X, const int32_t & n_samples, const int32_t & n_features)
+template < class Scalar >
+std :: unique_ptr < Scalar [] > BasePlasticity_ < Scalar > :: predict (const Scalar * X, const int32_t & n_samples, const int32_t & n_features)
 {
-  // convert the input array to Eigen matrix
-  Eigen :: Map < Eigen :: Matrix < float, Eigen :: Dynamic, Eigen :: Dynamic, Eigen :: RowMajor > > data(X, n_samples, n_features);
+  // check if the model has already stored the weights matrix (aka the fit function has already run)
+  this->check_is_fitted ();
+  // check if the input dimensions are consistent with the training ones
+  this->check_dims (n_features);
+
+  // allocate the output buffer owned by the caller
+  std :: unique_ptr < Scalar [] > output(new Scalar[static_cast < int64_t >(this->outputs) * n_samples]);
+
   // call the "real" function
-  return this->predict(data);
+  this->predict_into(X, n_samples, n_features, output.get());
+
+  return output;
 }
 
-float * BasePlasticity :: predict (const Eigen :: MatrixXf & X)
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: predict_into (const Scalar * X, const int32_t & n_samples, const int32_t & n_features, Scalar * output)
+{
+  // check if the model has already stored the weights matrix (aka the fit function has already run)
+  this->check_is_fitted ();
+  // check if the input dimensions are consistent with the training ones
+  this->check_dims (n_features);
+
+  // wrap the input and output arrays into Eigen matrices (no copy)
+  // NOTE: in ravel format each sample is a column of the (n_features, n_samples) matrix
+  Eigen :: Map < const matrix_t > data(X, n_features, n_samples);
+  Eigen :: Map < matrix_t > out(output, this->outputs, n_samples);
+
+  // perform the prediction using the core (overrided) function
+  this->_predict_into (data, out);
+}
+
+template < class Scalar >
+typename BasePlasticity_ < Scalar > :: matrix_t BasePlasticity_ < Scalar > :: predict (const matrix_t & X)
 {
   // extracthe the number of features as the number of columns of the input matrix
   const int32_t n_features = X.cols();
@@ -114,39 +208,176 @@ float * BasePlasticity :: predict (const Eigen :: MatrixXf & X)
   this->check_dims (n_features);
 
   // perform the prediction using the core (overrided) function
-  Eigen :: MatrixXf output = this->_predict (X);
+  // NOTE: the core function requires the samples as columns
+  return this->_predict (X.transpose());
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: set_num_threads (const int32_t & n_threads)
+{
+  if ( n_threads < 1 )
+    throw std :: runtime_error("num_threads must be an integer bigger or equal than 1");
+
+#ifdef _OPENMP
+  this->num_threads = n_threads;
+#endif
+}
+
+template < class Scalar >
+int32_t BasePlasticity_ < Scalar > :: get_num_threads () const
+{
+  return this->num_threads;
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: set_profiling (const bool & enable)
+{
+  this->profiling = enable;
+}
+
+template < class Scalar >
+const training_profiler & BasePlasticity_ < Scalar > :: get_profiler () const
+{
+  return this->profiler;
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: set_convergence_check (const int32_t & check)
+{
+  if ( check != convergence_t :: epoch_check && check != convergence_t :: batch_check )
+    throw std :: runtime_error("Invalid convergence check. Given : " + std :: to_string(check));
+
+  this->convergency_check = check;
+}
 
-  return output.data();
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: set_checkpoint (const std :: string & filename, const int32_t & frequency, const int32_t & unit)
+{
+  if ( frequency < 0 )
+    throw std :: runtime_error("checkpoint frequency must be an integer bigger or equal than 0");
+
+  if ( unit != checkpoint_t :: per_epoch && unit != checkpoint_t :: per_batch )
+    throw std :: runtime_error("Invalid checkpoint unit. Given : " + std :: to_string(unit));
+
+  if ( frequency > 0 && filename.empty() )
+    throw std :: runtime_error("Invalid checkpoint filename. The filename must be not empty");
+
+  this->checkpoint_file = filename;
+  this->checkpoint_frequency = frequency;
+  this->checkpoint_unit = unit;
 }
 
-void BasePlasticity :: save_weights (const std :: string & filename)
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: resume (const std :: string & filename)
+{
+  // check if the provided file exists trying to open it
+  if ( ! utils :: file_exists(filename) )
+    // throw the exception with the appropriated error
+    throw std :: runtime_error("File not found. Given : " + filename);
+
+  // complete the eventual checkpoint which is writing the same file
+  this->wait_checkpoint();
+
+  std :: unique_ptr < model_file :: reader > file (new model_file :: reader(filename, false, true));
+
+  if ( ! file->has("checkpoint.epoch") )
+    throw std :: runtime_error("Invalid checkpoint file. The file stores only the model. Given : " + filename);
+
+  this->load_state(*file);
+  this->weights = file->matrix < Scalar >(model_file :: section_t :: weights_section);
+  this->mapping.reset();
+
+  // invalidate the cached matrices
+  ++ this->weights_version;
+
+  // NOTE: the optimizer object is re-created by the load_state function
+  this->optimizer.load_arrays(*file);
+
+  this->history.load(*file);
+
+  // the position in the training loop is restored by the next fit call
+  this->resume_point = std :: move(file);
+}
+
+template < class Scalar >
+std :: unique_ptr < Scalar [] > BasePlasticity_ < Scalar > :: predict (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+  const int64_t & stride, const input_normalization & norm)
 {
   // check if the model has already stored the weights matrix (aka the fit function has already run)
   this->check_is_fitted ();
+  // check if the input dimensions are consistent with the training ones
+  this->check_dims (n_features);
 
-  // open the output stream file as binary
-  std :: ofstream os(filename, std :: ios :: out | std :: ios :: binary | std :: ios :: trunc);
+  // allocate the output buffer owned by the caller
+  std :: unique_ptr < Scalar [] > output(new Scalar[static_cast < int64_t >(this->outputs) * n_samples]);
+  Eigen :: Map < matrix_t > out(output.get(), this->outputs, n_samples);
 
-  // temporary variables for the matrix shape
-  typename Eigen :: MatrixXf :: Index rows = this->weights.rows();
-  typename Eigen :: MatrixXf :: Index cols = this->weights.cols();
-
-  // dump the shape variables
-  os.write((char *) (&rows), sizeof ( typename Eigen :: MatrixXf :: Index ) );
-  os.write((char *) (&cols), sizeof ( typename Eigen :: MatrixXf :: Index ) );
-  // dump the matrix data buffer
-  os.write((char *) this->weights.data(), rows * cols * sizeof ( typename Eigen :: MatrixXf :: Scalar) );
-  // close the file stream
-  os.close();
+  // the raw values are converted in tiles of (at most) batch samples,
+  // so the floating point copy of the whole input is never stored
+  const int32_t tile_size = std :: max(1, std :: min(this->batch, n_samples));
+
+  matrix_t tile(n_features, tile_size);
+  std :: vector < int32_t > indices(tile_size);
+
+  for (int32_t first = 0; first < n_samples; first += tile_size)
+  {
+    const int32_t size = std :: min(tile_size, n_samples - first);
+
+    std :: iota(indices.begin(), indices.begin() + size, first);
+    this->gather_batch(X, stride, indices.data(), norm, tile.leftCols(size), this->num_threads);
+
+    // perform the prediction using the core (overrided) function
+    this->_predict_into (tile.leftCols(size), out.middleCols(first, size));
+  }
+
+  return output;
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: save_weights (const std :: string & filename)
+{
+  // check if the model has already stored the weights matrix (aka the fit function has already run)
+  this->check_is_fitted ();
+
+  // NOTE: the sections are not copied, so the views must be valid until the save
+  const Eigen :: Map < const matrix_t > weights = this->weights_view();
+
+  model_file :: writer file;
+  this->save_state(file);
+  file.add(model_file :: section_t :: weights_section, weights);
+
+  // write a temporary file and then replace the previous one: the processes which
+  // have mapped the old file (load_mmap) keep using its (unchanged) inode
+  const std :: string tmp = filename + ".tmp";
+  file.save(tmp);
+
+  if ( std :: rename(tmp.c_str(), filename.c_str()) != 0 )
+    throw std :: runtime_error("Cannot rename the file " + tmp + " into " + filename);
 }
 
-void BasePlasticity :: load_weights (const std :: string & filename)
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: load_weights (const std :: string & filename)
 {
   // check if the provided file exists trying to open it
   if ( ! utils :: file_exists(filename) )
     // throw the exception with the appropriated error
     throw std :: runtime_error("File not found. Given : " + filename);
 
+  if ( model_file :: reader :: is_model_file(filename) )
+  {
+    model_file :: reader file (filename, false, true);
+
+    this->load_state(file);
+    this->weights = file.matrix < Scalar >(model_file :: section_t :: weights_section);
+    this->mapping.reset();
+
+    // invalidate the cached matrices
+    ++ this->weights_version;
+    return;
+  }
+
+  // previous (raw) format
+
   // open the file stream as binary
   std :: ifstream is(filename, std :: ios :: in | std :: ios :: binary);
 
@@ -157,84 +388,528 @@ void BasePlasticity :: load_weights (const std :: string & filename)
   // read the shape variables
   is.read((char*) (&rows), sizeof ( typename Eigen :: MatrixXf :: Index ) );
   is.read((char*) (&cols), sizeof ( typename Eigen :: MatrixXf :: Index ) );
-  // resize the weights matrix
-  this->weights.resize(rows, cols);
   // read the matrix data buffer
-  is.read( (char *) this->weights.data(), rows * cols * sizeof ( typename Eigen :: MatrixXf :: Scalar) );
+  // NOTE: the previous format stores always float values
+  Eigen :: MatrixXf legacy (rows, cols);
+  is.read( (char *) legacy.data(), rows * cols * sizeof ( typename Eigen :: MatrixXf :: Scalar) );
   // close the file stream
   is.close();
+
+  this->weights = legacy.cast < Scalar >();
+
+  this->mapping.reset();
+
+  // invalidate the cached matrices
+  ++ this->weights_version;
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: load_mmap (const std :: string & filename, const bool & verify)
+{
+  auto file = std :: make_shared < model_file :: reader >(filename, true, verify);
+
+  this->load_state(*file);
+
+  // the weights are used directly from the mapped file
+  this->weights.resize(0, 0);
+  this->mapping = file;
+
+  // invalidate the cached matrices
+  ++ this->weights_version;
 }
 
-float * BasePlasticity :: get_weights ()
+template < class Scalar >
+const Scalar * BasePlasticity_ < Scalar > :: get_weights () const
 {
-  // extract the pointer to the data stored into the weight Eigen Matrix
-  return this->weights.data();
+  // extract the pointer to the data stored into the weight Eigen Matrix (or into the mapped file)
+  return this->weights_view().data();
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: set_weights (const Scalar * W, const int32_t & outputs, const int32_t & n_features)
+{
+  if ( outputs != this->outputs )
+    throw std :: runtime_error("Invalid dimensions found. The number of rows of the weights (" +
+                               std :: to_string(outputs) + ") is inconsistent with the number of outputs (" +
+                               std :: to_string(this->outputs) + ")");
+
+  // the given values replace the eventual mapped weights
+  this->mapping.reset();
+  this->weights = Eigen :: Map < const matrix_t >(W, outputs, n_features);
+
+  // invalidate the cached matrices
+  ++ this->weights_version;
+}
+
+template < class Scalar >
+quantized_model BasePlasticity_ < Scalar > :: quantize (const int32_t & type)
+{
+  // check if the model has already stored the weights matrix (aka the fit function has already run)
+  this->check_is_fitted ();
+
+  // NOTE: the linear activation (e.g. Hopfield) is an identity also in the quantized model
+  if constexpr ( std :: is_same < Scalar, float > :: value )
+    return quantized_model(this->forward_weights(), this->batch_activation, type, this->num_threads);
+  else
+    // the quantized model works in single precision
+    return quantized_model(this->forward_weights().template cast < float >(), transfer :: activate_array < float >(this->activation_type),
+                           type, this->num_threads);
 }
 
 
 // Private members
 
-void BasePlasticity :: check_dims (const int32_t & n_features)
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: init_training (const int32_t & n_samples, const int32_t & n_features)
+{
+  if (this->batch > n_samples)
+    throw std :: runtime_error("Incorrect batch_size found. "
+      "The batch_size must be less or equal to the number of samples. "
+      "Given " + std :: to_string(this->batch) + " for " +
+      std :: to_string(n_samples) + " samples");
+
+  // the resumed training continues from the restored weights and optimizer arrays
+  if ( this->resume_point )
+  {
+    if ( this->weights.cols() != n_features )
+      throw std :: runtime_error("Invalid dimensions found. The input number of features (" + std :: to_string(n_features) +
+                                 ") is inconsistent with the checkpoint (" + std :: to_string(this->weights.cols()) + ")");
+
+    // allocate the buffers used along the training
+    this->init_workspace(n_features);
+    return;
+  }
+
+  // allocate the weights matrix (releasing the eventual mapped file)
+  this->mapping.reset();
+  this->weights = matrix_t(this->outputs, n_features);
+  // init the weight matrix using the given initializer
+  this->w_init.init(this->weights.data(), this->outputs, n_features);
+  ++ this->weights_version;
+
+  // init the optimizer object with the required parameters
+  this->optimizer.init_arrays(this->weights.rows(), this->weights.cols());
+  this->iteration = 0;
+
+  // clear the convergency monitoring
+  this->history.reset(this->outputs, this->epochs_for_convergency);
+
+  // discard the pending rows of a previous partial_fit
+  this->num_pending = 0;
+
+  // allocate the buffers used along the training
+  this->init_workspace(n_features);
+}
+
+template < class Scalar >
+training_profiler * BasePlasticity_ < Scalar > :: init_profiler (const int32_t & n_features, const bool & restart)
+{
+  if ( ! this->profiling )
+    return nullptr;
+
+  std :: array < double, num_stages > flops;
+  std :: array < double, num_stages > bytes;
+
+  flops.fill(0.);
+  bytes.fill(0.);
+
+  this->stage_costs(n_features, flops, bytes);
+
+  if ( restart )
+    this->profiler.start(flops, bytes);
+  else
+    this->profiler.set_costs(flops, bytes);
+
+  return &this->profiler;
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: init_partial (const int32_t & n_features)
+{
+  if ( this->resume_point )
+    throw std :: runtime_error("Checkpoint error. The resume of the training is supported only by the fit function");
+
+  if ( this->weights.size() == 0 && ! this->mapping )
+  {
+    // first call: allocate and init the weights matrix as in the fit function
+    this->weights = matrix_t(this->outputs, n_features);
+    this->w_init.init(this->weights.data(), this->outputs, n_features);
+    ++ this->weights_version;
+  }
+  else
+  {
+    // check if the input dimensions are consistent with the current weights
+    this->check_dims (n_features);
+
+    // the mapped weights are read-only, so an owned copy is created
+    if ( this->mapping )
+    {
+      this->weights = this->weights_view();
+      this->mapping.reset();
+      ++ this->weights_version;
+    }
+  }
+
+  // the optimizer moments are kept along the calls
+  if ( ! this->optimizer.has_arrays(this->weights.rows(), this->weights.cols()) )
+  {
+    this->optimizer.init_arrays(this->weights.rows(), this->weights.cols());
+    // NOTE: the new moments require the bias correction of the first iterations
+    this->iteration = 0;
+  }
+
+  if ( this->theta.size() != this->outputs )
+    this->theta = vector_t :: Zero(this->outputs);
+
+  // allocate the buffers used along the training only if their shape changes
+  if ( this->batch_update.rows() != this->outputs || this->batch_update.cols() != n_features )
+    this->init_workspace(n_features);
+
+  if ( this->pending.rows() != n_features || this->pending.cols() != this->batch )
+  {
+    this->pending.resize(n_features, this->batch);
+    this->num_pending = 0;
+  }
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: init_workspace (const int32_t & n_features)
+{
+  this->batch_output.resize(this->outputs, this->batch);
+  this->batch_update.resize(this->outputs, n_features);
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: check_dims (const int32_t & n_features)
 {
   // Check the shape consistency between the input data (n_samples, n_features)
   // and the weights matrix (outputs, n_features)
   // This function is used just to be sure that the dataset provided for the
   // prediction are consistent with the data (shape) provided for the training
-  if ( this->outputs * n_features != this->weights.size() )
+  const int64_t num_weights = this->weights_view().size();
+
+  if ( this->outputs * n_features != num_weights )
     throw std :: runtime_error("Invalid dimensions found. The input (n_samples, n_features)"
                                "shape is inconsistent with the number of weights (" +
-                                std :: to_string(this->weights.size()) + ")");
+                                std :: to_string(num_weights) + ")");
 }
 
-void BasePlasticity :: check_is_fitted ()
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: check_is_fitted ()
 {
   // If the model has not yet called the fit function the weights matrix is empty!
-  if ( this->weights.rows() == 0 && this->weights.cols() == 0 )
+  if ( this->weights.size() == 0 && ! this->mapping )
     throw std :: runtime_error("Fitted error. The model is not fitted yet.\n"
                                "Please call the fit function before using the predict member.");
 }
 
-void BasePlasticity :: check_params ()
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: check_params ()
 {
   // the number of epochs for the convergency must be a positive non null integer!
   if ( this->epochs_for_convergency <= 0 )
     throw std :: runtime_error("epochs_for_convergency must be an integer bigger or equal than 1");
 }
 
-bool BasePlasticity :: check_convergence (const Eigen :: ArrayXf & vec)
+template < class Scalar >
+bool BasePlasticity_ < Scalar > :: check_convergence (const array_t & vec)
+{
+  // append the current vector to the window and compare it with the
+  // running envelopes (minimum and maximum) of the stored ones.
+  // If all the abs differences are lower than the given tollerance
+  // the convergency is reached and a stop is returned.
+  return this->history.update(vec, this->convergency_atol);
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: gather_batch (const uint8_t * X, const int64_t & stride, const int32_t * indices,
+  const input_normalization & norm, Eigen :: Ref < matrix_t > batch_data, const int32_t & n_threads)
+{
+  const int32_t n_features = static_cast < int32_t >(batch_data.rows());
+  const int32_t n_cols = static_cast < int32_t >(batch_data.cols());
+
+  if ( stride < n_features )
+    throw std :: runtime_error("Invalid stride found. The distance between consecutive rows (" +
+                               std :: to_string(stride) + ") must be greater or equal than the number of features (" +
+                               std :: to_string(n_features) + ")");
+
+  // convert each row of the input buffer directly into the (contiguous) column of the batch
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads (n_threads) if (n_threads > 1)
+#else
+  (void)n_threads;
+#endif
+  for (int32_t j = 0; j < n_cols; ++j)
+    norm.apply(X + indices[j] * stride, batch_data.col(j).data(), n_features);
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: train_batch (const matrix_t & batch_data, const int32_t & iteration)
 {
-  // If the history queue is not full append the last (current) vector to the history
-  if ( static_cast < int32_t >(this->history.size()) < this->epochs_for_convergency )
+  training_profiler * const profiler = this->profiling ? &this->profiler : nullptr;
+
   {
-    this->history.emplace_back(vec);
-    return false;
+    stage_timer timer (profiler, stage_t :: forward_update_stage);
+
+    // perform the prediction of the model and compute the gradient of the weights matrix (aka dW)
+    this->forward_update_into(batch_data, this->batch_update);
   }
 
-  // Otherwise evaluate the distances between the current vector
-  // and the history arrays. The distance is evaluated as the abs differences
-  // between each historical vector and the current one.
-  // If the maximum value of the differences is lower than the given tollerance
-  // the convergency is reached and a stop is returned.
+  // (eventually) perform a weight decay
+  if (this->decay != 0.f)
+  {
+    stage_timer timer (profiler, stage_t :: decay_stage);
+    this->batch_update -= this->decay * this->weights;
+  }
 
-  for (int32_t i = 0; i < this->epochs_for_convergency; ++i)
   {
-    // compute the vector of abs differences
-    const bool equal = vec.isApprox(this->history[i], this->convergency_atol);
+    stage_timer timer (profiler, stage_t :: optimizer_stage);
 
-    if ( !equal )
-      return true;
+    // perform the update of the weights using the properly set optimizer
+    this->optimizer_step(iteration);
   }
 
-  // Since this is the case in which the history queue is full
-  // we have to remove the older vector and append the current one (LIFO behavior)
-  this->history.pop_front();
-  this->history.emplace_back(vec);
+  ++ this->weights_version;
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: save_checkpoint (const int32_t & epoch, const int32_t & next_batch,
+  const std :: vector < int32_t > & indices, const std :: mt19937 & engine,
+  const array_t & sum_theta)
+{
+  // only a checkpoint at a time is written
+  this->wait_checkpoint();
+
+  // NOTE: the owning writer copies the arrays, so the training can go on
+  // while the checkpoint is written by the background task
+  model_file :: writer file (true);
+
+  this->save_state(file);
+  file.add(model_file :: section_t :: weights_section, this->weights);
+  this->optimizer.save_arrays(file);
+
+  this->history.save(file);
+  file.add(model_file :: section_t :: indices_section, indices.data(), static_cast < int64_t >(indices.size()));
+  file.add(model_file :: section_t :: sum_theta_section, sum_theta.matrix());
+
+  std :: ostringstream state;
+  state << engine;
+
+  file.set("checkpoint.epoch", epoch);
+  file.set("checkpoint.batch", next_batch);
+  file.set("checkpoint.engine", state.str());
+
+  const std :: string filename = this->checkpoint_file;
+
+  this->checkpoint_task = std :: async(std :: launch :: async,
+                                       [file = std :: move(file), filename]
+                                       {
+                                         // write a temporary file and then replace the previous checkpoint,
+                                         // so an interruption never leaves a partial checkpoint
+                                         const std :: string tmp = filename + ".tmp";
+                                         file.save(tmp);
+
+                                         if ( std :: rename(tmp.c_str(), filename.c_str()) != 0 )
+                                           throw std :: runtime_error("Checkpoint error. Cannot rename the file " + tmp);
+                                       });
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: wait_checkpoint ()
+{
+  if ( this->checkpoint_task.valid() )
+    this->checkpoint_task.get();
+}
+
+template < class Scalar >
+bool BasePlasticity_ < Scalar > :: restore_checkpoint (int32_t & epoch, int32_t & next_batch,
+  std :: vector < int32_t > & indices, std :: mt19937 & engine,
+  array_t & sum_theta)
+{
+  if ( ! this->resume_point )
+    return false;
+
+  // consume the resume point
+  const std :: unique_ptr < model_file :: reader > file = std :: move(this->resume_point);
+
+  const auto permutation = file->index_array(model_file :: section_t :: indices_section);
+
+  if ( permutation.size() != static_cast < int64_t >(indices.size()) )
+    throw std :: runtime_error("Invalid checkpoint file. The number of samples (" + std :: to_string(indices.size()) +
+                               ") is inconsistent with the checkpoint (" + std :: to_string(permutation.size()) + ")");
+
+  epoch = file->get < int32_t >("checkpoint.epoch");
+  next_batch = file->get < int32_t >("checkpoint.batch");
+
+  std :: copy_n(permutation.data(), permutation.size(), indices.begin());
+
+  std :: istringstream state (file->get < std :: string >("checkpoint.engine"));
+  state >> engine;
+
+  sum_theta = file->matrix < Scalar >(model_file :: section_t :: sum_theta_section).col(0).array();
+
+  return true;
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: forward_update_into (const matrix_t & X, matrix_t & weights_update)
+{
+  training_profiler * const profiler = this->profiling ? &this->profiler : nullptr;
+
+  {
+    stage_timer timer (profiler, stage_t :: predict_stage);
+
+    // perform the prediction of the model with the current weight matrix
+    this->_predict_into(X, this->batch_output);
+  }
+
+  stage_timer timer (profiler, stage_t :: weights_update_stage);
+
+  // compute the gradient of the weights matrix (aka dW)
+  this->weights_update_into(X, this->batch_output, weights_update);
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: stage_costs (const int32_t & n_features,
+  std :: array < double, num_stages > & flops, std :: array < double, num_stages > & bytes) const
+{
+  const double num_weights = static_cast < double >(this->outputs) * n_features;
+  const double num_inputs = static_cast < double >(n_features) * this->batch;
+  const double num_outputs = static_cast < double >(this->outputs) * this->batch;
+
+  // copy of the rows into the batch buffer
+  bytes[stage_t :: gather_stage] = 2. * num_inputs * sizeof(Scalar);
+
+  // output = W * X
+  flops[stage_t :: predict_stage] = 2. * num_weights * this->batch;
+  bytes[stage_t :: predict_stage] = (num_weights + num_inputs + num_outputs) * sizeof(Scalar);
+
+  // dW = f(output) * X^T
+  flops[stage_t :: weights_update_stage] = 2. * num_weights * this->batch;
+  bytes[stage_t :: weights_update_stage] = (num_outputs + num_inputs + num_weights) * sizeof(Scalar);
+
+  flops[stage_t :: forward_update_stage] = flops[stage_t :: predict_stage] + flops[stage_t :: weights_update_stage];
+  bytes[stage_t :: forward_update_stage] = bytes[stage_t :: predict_stage] + bytes[stage_t :: weights_update_stage];
+
+  // dW -= decay * W
+  flops[stage_t :: decay_stage] = 2. * num_weights;
+  bytes[stage_t :: decay_stage] = 3. * num_weights * sizeof(Scalar);
+
+  bytes[stage_t :: optimizer_stage] = num_weights * this->optimizer.nbytes_per_weight(sizeof(Scalar));
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: optimizer_step (const int32_t & iteration)
+{
+  this->optimizer.update(iteration, this->weights, this->batch_update, this->num_threads);
+}
+
+template < class Scalar >
+Eigen :: Map < const typename BasePlasticity_ < Scalar > :: matrix_t > BasePlasticity_ < Scalar > :: forward_weights ()
+{
+  return this->weights_view();
+}
+
+template < class Scalar >
+bool BasePlasticity_ < Scalar > :: is_mapped () const
+{
+  return this->mapping != nullptr;
+}
+
+template < class Scalar >
+Eigen :: Map < const typename BasePlasticity_ < Scalar > :: matrix_t > BasePlasticity_ < Scalar > :: weights_view () const
+{
+  if ( this->mapping )
+    return this->mapping->matrix < Scalar >(model_file :: section_t :: weights_section);
+
+  return Eigen :: Map < const matrix_t >(this->weights.data(), this->weights.rows(), this->weights.cols());
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: save_state (model_file :: writer & file) const
+{
+  file.set("outputs", this->outputs);
+  file.set("batch", this->batch);
+  file.set("activation", this->activation_type);
+  file.set("epochs_for_convergency", this->epochs_for_convergency);
+  file.set("convergency_check", this->convergency_check);
+  file.set("convergency_atol", this->convergency_atol);
+  file.set("decay", this->decay);
+  file.set("iteration", this->iteration);
+
+  file.set("optimizer.type", this->optimizer.type);
+  file.set("optimizer.learning_rate", this->optimizer.learning_rate);
+  file.set("optimizer.momentum", this->optimizer.momentum);
+  file.set("optimizer.decay", this->optimizer.decay);
+  file.set("optimizer.B1", this->optimizer.B1);
+  file.set("optimizer.B2", this->optimizer.B2);
+  file.set("optimizer.rho", this->optimizer.rho);
+  file.set("optimizer.state_precision", this->optimizer.state_precision);
+
+  if ( this->theta.size() )
+    file.add(model_file :: section_t :: theta_section, this->theta);
+}
+
+template < class Scalar >
+void BasePlasticity_ < Scalar > :: load_state (const model_file :: reader & file)
+{
+  if ( ! file.has(model_file :: section_t :: weights_section) )
+    throw std :: runtime_error("Invalid model file. Missing weights");
+
+  // NOTE: the sections are checked before any member is modified, so a file
+  // stored with a different precision leaves the model unchanged
+  const auto weights = file.matrix < Scalar >(model_file :: section_t :: weights_section);
+  const int32_t outputs = file.get < int32_t >("outputs");
+
+  if ( weights.rows() != outputs )
+    throw std :: runtime_error("Invalid model file. The number of weights rows (" + std :: to_string(weights.rows()) +
+                               ") must be equal to the number of outputs (" + std :: to_string(outputs) + ")");
+
+  this->outputs = outputs;
+  this->batch = file.get < int32_t >("batch");
+  this->epochs_for_convergency = file.get < int32_t >("epochs_for_convergency");
+  this->convergency_check = file.has("convergency_check") ? file.get < int32_t >("convergency_check") : convergence_t :: epoch_check;
+  this->convergency_atol = file.get < float >("convergency_atol");
+  this->decay = file.get < float >("decay");
+  this->iteration = file.has("iteration") ? file.get < int32_t >("iteration") : 0;
+
+  // the pending rows of a previous partial_fit belong to the replaced model
+  this->num_pending = 0;
+
+  // clear the convergency monitoring
+  this->history.reset(this->outputs, this->epochs_for_convergency);
+
+  this->activation_type = file.get < int32_t >("activation");
+
+  this->activation = transfer :: activate < Scalar >( this->activation_type );
+  this->gradient   = transfer :: gradient < Scalar >( this->activation_type );
+
+  this->batch_activation = transfer :: activate_array < Scalar >( this->activation_type );
+  this->batch_gradient   = transfer :: gradient_array < Scalar >( this->activation_type );
+
+  this->optimizer = update_args(file.get < int32_t >("optimizer.type"),
+                                file.get < float >("optimizer.learning_rate"),
+                                file.get < float >("optimizer.momentum"),
+                                file.get < float >("optimizer.decay"),
+                                file.get < float >("optimizer.B1"),
+                                file.get < float >("optimizer.B2"),
+                                file.get < float >("optimizer.rho"),
+                                file.get < int32_t >("optimizer.state_precision"));
+
+  if ( file.has(model_file :: section_t :: theta_section) )
+    this->theta = file.matrix < Scalar >(model_file :: section_t :: theta_section);
+  else
+    this->theta.resize(0);
 
-  return false;
 }
 
-Eigen :: MatrixXf BasePlasticity :: _predict (__unused const Eigen :: MatrixXf & data)
+template < class Scalar >
+typename BasePlasticity_ < Scalar > :: matrix_t BasePlasticity_ < Scalar > :: _predict (const Eigen :: Ref < const matrix_t > & data)
 {
-  return Eigen :: MatrixXf {};
+  matrix_t output (this->outputs, data.cols());
+  this->_predict_into (data, output);
+  return output;
 }
 
+template class BasePlasticity_ < float >;
+template class BasePlasticity_ < double >;
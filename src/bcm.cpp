@@ -26,40 +26,67 @@
 //
 //M*/
 
-#include <bcm.h>
+#include <bcm.hpp>
 
-BCM :: BCM (const int32_t & outputs, const int32_t & batch_size,
+template < class Scalar >
+BCM_ < Scalar > :: BCM_ (const int32_t & outputs, const int32_t & batch_size,
   int32_t activation, update_args optimizer, weights_initialization weights_init,
   int32_t epochs_for_convergency, float convergency_atol,
   float decay, float memory_factor,
   float interaction_strength
-  ) : BasePlasticity (outputs, batch_size, activation, optimizer,
+  ) : BasePlasticity_ < Scalar > (outputs, batch_size, activation, optimizer,
                       weights_init, epochs_for_convergency,
                       convergency_atol, decay)
 {
   this->init_interaction_matrix(interaction_strength);
   this->memory_factor = memory_factor;
+  this->effective_version = -1;
+
+  BCM_ :: get_tile_shape(this->outputs, this->tile_rows, this->tile_size);
 }
 
-BCM :: BCM (const BCM & b) : BasePlasticity (b)
+template < class Scalar >
+BCM_ < Scalar > :: BCM_ (const BCM_ & b) : BasePlasticity_ < Scalar > (b), interaction_matrix (b.interaction_matrix),
+  memory_factor (b.memory_factor), effective_weights (), effective_version (-1),
+  tile_rows (b.tile_rows), tile_size (b.tile_size)
 {
-  this->memory_factor = memory_factor;
 }
 
-BCM & BCM :: operator = (const BCM & b)
+template < class Scalar >
+BCM_ < Scalar > & BCM_ < Scalar > :: operator = (const BCM_ & b)
 {
-  BasePlasticity :: operator = (b);
-  this->memory_factor = memory_factor;
+  BasePlasticity_ < Scalar > :: operator = (b);
+  this->interaction_matrix = b.interaction_matrix;
+  this->memory_factor = b.memory_factor;
+  this->effective_version = -1;
+  this->tile_rows = b.tile_rows;
+  this->tile_size = b.tile_size;
 
   return *this;
 }
 
-void BCM :: init_interaction_matrix (const float & interaction_strength)
+template < class Scalar >
+void BCM_ < Scalar > :: get_tile_shape (const int32_t & outputs, int32_t & tile_rows, int32_t & tile_cols)
+{
+  // set the shape of each tile so that the output tile fits in (a portion of)
+  // the L2 cache, with a multiple of the SIMD width.
+  // NOTE: the units are split in blocks of rows, so a wide layer gives short and
+  // wide tiles instead of tiles of a few samples which re-read the whole forward matrix
+  // NOTE: the double tiles have the same size in bytes of the float ones
+  const int32_t tile_floats = static_cast < int32_t >(32768 * sizeof(float) / sizeof(Scalar));
+  const int32_t max_rows = 256;
+
+  tile_rows = std :: min(std :: max(outputs, 1), max_rows);
+  tile_cols = (tile_floats / tile_rows) / 16 * 16;
+}
+
+template < class Scalar >
+void BCM_ < Scalar > :: init_interaction_matrix (const float & interaction_strength)
 {
   if (interaction_strength != 0.f)
   {
     // create a temporary matrix with all the elements set as -interaction_strength
-    Eigen :: MatrixXf temp = Eigen :: MatrixXf :: Constant(this->outputs, this->outputs, -interaction_strength);
+    matrix_t temp = matrix_t :: Constant(this->outputs, this->outputs, -interaction_strength);
 
     // // local interaction setting a symmetric matrix
     // Eigen :: MatrixXf symm = Eigen :: MatrixXf :: Zero(this->outputs, this->outputs);
@@ -70,7 +97,7 @@ void BCM :: init_interaction_matrix (const float & interaction_strength)
     // Eigen :: MatrixXf temp = symm + symm.transpose();
 
     // re-fill only the diagonal values with the identity
-    temp.diagonal() = Eigen :: ArrayXf :: Ones(this->outputs);
+    temp.diagonal() = vector_t :: Ones(this->outputs);
 
     // invert the matrix
     this->interaction_matrix = temp.inverse();
@@ -79,43 +106,134 @@ void BCM :: init_interaction_matrix (const float & interaction_strength)
   else
     // without the lateral interactions the interaction_matrix is just the inverse of
     // the identity matrix, i.e the identity matrix!
-    this->interaction_matrix = Eigen :: MatrixXf :: Identity(this->outputs, this->outputs);
+    // So we can avoid its storage and the useless product with the weights
+    this->interaction_matrix.resize(0, 0);
 }
 
-Eigen :: MatrixXf BCM :: weights_update (const Eigen :: MatrixXf & X, const Eigen :: MatrixXf & output)
+template < class Scalar >
+Eigen :: Map < const typename BCM_ < Scalar > :: matrix_t > BCM_ < Scalar > :: forward_weights ()
+{
+  // without interactions the forward matrix is the weights matrix
+  if (this->interaction_matrix.size() == 0)
+    return this->weights_view();
+
+  // re-compute the effective matrix only if the weights are changed
+  if (this->effective_version != this->weights_version)
+  {
+    this->effective_weights.noalias() = this->interaction_matrix * this->weights_view();
+    this->effective_version = this->weights_version;
+  }
+
+  return Eigen :: Map < const matrix_t >(this->effective_weights.data(), this->effective_weights.rows(), this->effective_weights.cols());
+}
+
+template < class Scalar >
+void BCM_ < Scalar > :: save_state (model_file :: writer & file) const
+{
+  BasePlasticity_ < Scalar > :: save_state(file);
+
+  file.set("model", "BCM");
+  file.set("memory_factor", this->memory_factor);
+
+  if (this->interaction_matrix.size())
+    file.add(model_file :: section_t :: interaction_section, this->interaction_matrix);
+}
+
+template < class Scalar >
+void BCM_ < Scalar > :: load_state (const model_file :: reader & file)
+{
+  if ( file.get < std :: string >("model") != "BCM" )
+    throw std :: runtime_error("Invalid model file. The file stores a " + file.get < std :: string >("model") + " model");
+
+  BasePlasticity_ < Scalar > :: load_state(file);
+
+  this->memory_factor = file.get < float >("memory_factor");
+
+  if ( file.has(model_file :: section_t :: interaction_section) )
+    this->interaction_matrix = file.matrix < Scalar >(model_file :: section_t :: interaction_section);
+  else
+    this->interaction_matrix.resize(0, 0);
+
+  this->effective_version = -1;
+  BCM_ :: get_tile_shape(this->outputs, this->tile_rows, this->tile_size);
+}
+
+template < class Scalar >
+void BCM_ < Scalar > :: init_workspace (const int32_t & n_features)
+{
+  BasePlasticity_ < Scalar > :: init_workspace(n_features);
+
+  const int32_t n_tiles = (this->batch + this->tile_size - 1) / this->tile_size;
+
+  this->phi.resize(this->outputs, this->batch);
+  this->batch_theta.resize(this->outputs);
+  this->tile_theta.resize(this->outputs, n_tiles);
+}
+
+template < class Scalar >
+void BCM_ < Scalar > :: weights_update_into (const matrix_t & X, const matrix_t & output,
+  matrix_t & weights_update)
 {
   // evaluate the theta array as the average of the output rows
-  Eigen :: VectorXf theta = output.array().square().rowwise().mean();
+  this->batch_theta = output.array().square().rowwise().mean();
+
+  this->law_cooper_update_into(X, output, weights_update);
+}
+
+template < class Scalar >
+void BCM_ < Scalar > :: forward_update_into (const matrix_t & X, matrix_t & weights_update)
+{
+  this->fused_update_into(X, weights_update, this->batch_activation);
+}
 
+template < class Scalar >
+void BCM_ < Scalar > :: law_cooper_update_into (const matrix_t & X, const matrix_t & output,
+  matrix_t & weights_update)
+{
   // update the theta array with the moving average
-  this->theta = this->memory_factor * this->theta + (1.f - this->memory_factor) * theta;
+  this->theta = this->memory_factor * this->theta + (1.f - this->memory_factor) * this->batch_theta;
 
   // compute the phi array, i.e the Law and Cooper function
   // Step 1 : φ = y * (y - θ)
   // Step 2: φ = φ / θ
-  Eigen :: MatrixXf phi = output.cwiseProduct(output.colwise() - theta);
   // NOTE: add an extra epsilon term in the denominator to avoid possible numerical issues
-  phi = phi.array().colwise() / (theta.array() + BasePlasticity :: precision);
+  // NOTE: the tiles of samples are independent, so they are computed in parallel
+  const int32_t n_cols = static_cast < int32_t >(output.cols());
+  const int32_t n_tiles = (n_cols + this->tile_size - 1) / this->tile_size;
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads (this->num_threads)
+#endif
+  for (int32_t t = 0; t < n_tiles; ++t)
+  {
+    const int32_t first = t * this->tile_size;
+    const int32_t len = std :: min(this->tile_size, n_cols - first);
+
+    const auto theta = this->batch_theta.array();
+    const auto y = output.middleCols(first, len).array();
+
+    auto phi = this->phi.middleCols(first, len).array();
+    phi = y * (y.colwise() - theta);
+    phi.colwise() /= (theta + BasePlasticity_ < Scalar > :: precision);
+  }
 
   // compute the weights update using Law and Cooper rule
   // dw/dt = φ * x
-  Eigen :: MatrixXf weights_update = phi * X;
+  weights_update.noalias() = this->phi * X.transpose();
 
   // normalize the weights update according to the number of samples
-  const float max_abs_val = 1.f / X.rows();
+  const Scalar max_abs_val = Scalar(1) / X.cols();
   // Add the minus for compatibility with optimization algorithms
-  weights_update = weights_update.array() * (-max_abs_val);
-
-  return weights_update;
+  weights_update *= -max_abs_val;
 }
 
-Eigen :: MatrixXf BCM :: _predict (const Eigen :: MatrixXf & data)
+template < class Scalar >
+void BCM_ < Scalar > :: _predict_into (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output)
 {
-  // Apply the interaction matrix to the weights and compute the output
-  Eigen :: MatrixXf output = this->interaction_matrix * this->weights * data.transpose();
-
-  // apply the activation function
-  output = output.unaryExpr([&](const float & out) -> float {return this->activation(out);});
-
-  return output;
+  // Compute the output using the (cached) interaction matrix applied to the weights
+  // and apply the (vectorized) activation function on each output tile
+  this->forward_tiles(data, output, this->batch_activation, false);
 }
+
+template class BCM_ < float >;
+template class BCM_ < double >;
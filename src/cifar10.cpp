@@ -28,10 +28,12 @@
 
 #include <cifar10.h>
 
+#include <cstring> // std :: memmove
+
 namespace data_loader
 {
 
-CIFAR10 :: CIFAR10 () : BaseData ()
+CIFAR10 :: CIFAR10 (const bool & memory_map) : BaseData (memory_map)
 {
 }
 
@@ -96,28 +98,18 @@ void CIFAR10 :: load_testing_labels (const std :: string & testing_labels)
 
 // Private members
 
-void CIFAR10 :: load_file (const std :: string & filename, std :: unique_ptr < uint8_t [] > & data,
+void CIFAR10 :: load_file (const std :: string & filename, buffer_view & data,
   const uint32_t & magic_key, int32_t & nsample)
 {
-  // open the file
-  std :: ifstream is(filename, std :: ios :: in | std :: ios :: binary | std :: ios :: ate);
-
-  // determine the file size
-  std :: streamsize size = is.tellg();
-  // reset the stream position
-  is.seekg(0, std :: ios :: beg);
-  // allocate the global buffer
-  std :: unique_ptr < char [] > buffer(new char[size]);
-  // read the file content
-  is.read(buffer.get(), size);
-
-  // close the file
-  is.close();
+  // open (map or read) the file
+  int64_t size = 0;
+  std :: shared_ptr < uint8_t > buffer = this->open_file(filename, size);
 
-  const int32_t image_size = 32 * 32 * 3;
+  const int64_t image_size = 32 * 32 * 3;
+  const int64_t record_size = image_size + 1; // 32x32x3 images + 1 byte label
 
   // read the number of files
-  nsample = size / (image_size + 1); // 32x32x3 images + 1 byte label
+  nsample = static_cast < int32_t >(size / record_size);
 
   // start the processing
 
@@ -130,23 +122,41 @@ void CIFAR10 :: load_file (const std :: string & filename, std :: unique_ptr < u
       this->cols = 32;
       this->channels = 3; // 3-channels images (aka RGB)
 
-      // read the buffer of data
-      data.reset(new uint8_t[size - nsample]); // nsample is the number of labels
-
-      for (int32_t i = 0; i < nsample; ++i)
-        std :: move(buffer.get() + i * image_size + i + 1,
-                    buffer.get() + i * image_size + i + 1 + image_size,
-                    data.get() + i * image_size);
+      if ( this->memory_map )
+      {
+        // strided view of the images which skips the label bytes
+        data = buffer_view(buffer, 1, image_size, record_size);
+      }
+      else
+      {
+        // compact the images in-place removing the label bytes
+        for (int64_t i = 0; i < nsample; ++i)
+          std :: memmove(buffer.get() + i * image_size,
+                         buffer.get() + i * record_size + 1,
+                         image_size);
+
+        data = buffer_view(buffer, 0, image_size, image_size);
+      }
 
     } break;
 
     case CIFAR10_LABEL_MAGIC_CODE:
     {
-      // read the buffer of data
-      data.reset(new uint8_t[nsample]);
-
-      for (int32_t i = 0; i < nsample; ++i)
-        data[i] = buffer[i * (image_size + 1)];
+      if ( this->memory_map )
+      {
+        // strided view of the label bytes
+        data = buffer_view(buffer, 0, 1, record_size);
+      }
+      else
+      {
+        // copy the labels into a (small) buffer releasing the file content
+        std :: shared_ptr < uint8_t > labels(new uint8_t[nsample], std :: default_delete < uint8_t [] >());
+
+        for (int64_t i = 0; i < nsample; ++i)
+          labels.get()[i] = buffer.get()[i * record_size];
+
+        data = buffer_view(labels, 0, 1, 1);
+      }
 
     } break;
   }
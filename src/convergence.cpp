@@ -0,0 +1,163 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#include <convergence.h>
+
+#include <algorithm> // std :: min
+#include <stdexcept> // std :: runtime_error
+
+template < class Scalar >
+convergence_window_ < Scalar > :: convergence_window_ () : ring_max (), ring_min (), prefix_max (), prefix_min (),
+  length (0), fill (0), count (0)
+{
+}
+
+template < class Scalar >
+void convergence_window_ < Scalar > :: reset (const int32_t & outputs, const int32_t & length)
+{
+  this->length = length;
+  this->fill = 0;
+  this->count = 0;
+
+  // NOTE: the ring is allocated along the first block
+  this->ring_max.resize(outputs, 0);
+  this->ring_min.resize(outputs, 0);
+
+  this->prefix_max.resize(outputs);
+  this->prefix_min.resize(outputs);
+}
+
+template < class Scalar >
+bool convergence_window_ < Scalar > :: update (const array_t & vec, const float & atol)
+{
+  if ( this->length < 1 )
+    return false;
+
+  if ( this->prefix_max.size() != vec.size() )
+    this->reset(static_cast < int32_t >(vec.size()), this->length);
+
+  // the window holds the current vector and the length previous ones
+  const int32_t span = this->length + 1;
+
+  // grow the ring (only along the first block)
+  if ( this->fill == this->ring_max.cols() )
+  {
+    const int32_t cols = std :: min(span, std :: max(1, 2 * static_cast < int32_t >(this->ring_max.cols())));
+    this->ring_max.conservativeResize(Eigen :: NoChange, cols);
+    this->ring_min.conservativeResize(Eigen :: NoChange, cols);
+  }
+
+  // the current vector replaces the oldest one
+  this->ring_max.col(this->fill) = vec.matrix();
+  this->ring_min.col(this->fill) = vec.matrix();
+
+  if ( this->fill == 0 )
+  {
+    this->prefix_max = vec;
+    this->prefix_min = vec;
+  }
+  else
+  {
+    this->prefix_max = this->prefix_max.max(vec);
+    this->prefix_min = this->prefix_min.min(vec);
+  }
+
+  ++ this->fill;
+  ++ this->count;
+
+  bool converged = false;
+
+  if ( this->count >= span )
+  {
+    // the window is given by the current block and by the tail of the previous one
+    if ( this->fill < span )
+      converged = ( (this->prefix_max.max(this->ring_max.col(this->fill).array()) - vec) <= atol ).all() &&
+                  ( (vec - this->prefix_min.min(this->ring_min.col(this->fill).array())) <= atol ).all();
+    else
+      converged = ( (this->prefix_max - vec) <= atol ).all() && ( (vec - this->prefix_min) <= atol ).all();
+  }
+
+  // at the end of the block replace the values with their suffix extremes
+  if ( this->fill == span )
+  {
+    for (int32_t i = span - 2; i >= 0; --i)
+    {
+      this->ring_max.col(i) = this->ring_max.col(i).cwiseMax(this->ring_max.col(i + 1));
+      this->ring_min.col(i) = this->ring_min.col(i).cwiseMin(this->ring_min.col(i + 1));
+    }
+
+    this->fill = 0;
+  }
+
+  return converged;
+}
+
+template < class Scalar >
+int32_t convergence_window_ < Scalar > :: size () const
+{
+  return static_cast < int32_t >(std :: min(this->count, static_cast < int64_t >(this->length) + 1));
+}
+
+template < class Scalar >
+void convergence_window_ < Scalar > :: save (model_file :: writer & file) const
+{
+  // NOTE: the prefix matrix is temporary, so the writer must be an owning one
+  if ( ! file.is_owning() )
+    throw std :: runtime_error("Invalid model file writer. The convergence window requires an owning writer");
+
+  file.set("history.length", this->length);
+  file.set("history.fill", this->fill);
+  file.set("history.count", this->count);
+
+  file.add(model_file :: section_t :: history_section, this->ring_max);
+  file.add(model_file :: section_t :: history_min_section, this->ring_min);
+
+  matrix_t prefix (this->prefix_max.size(), 2);
+  prefix.col(0) = this->prefix_max.matrix();
+  prefix.col(1) = this->prefix_min.matrix();
+
+  file.add(model_file :: section_t :: envelope_section, prefix);
+}
+
+template < class Scalar >
+void convergence_window_ < Scalar > :: load (const model_file :: reader & file)
+{
+  this->length = file.get < int32_t >("history.length");
+  this->fill = file.get < int32_t >("history.fill");
+  this->count = file.get < int64_t >("history.count");
+
+  this->ring_max = file.matrix < Scalar >(model_file :: section_t :: history_section);
+  this->ring_min = file.matrix < Scalar >(model_file :: section_t :: history_min_section);
+
+  const auto prefix = file.matrix < Scalar >(model_file :: section_t :: envelope_section);
+  this->prefix_max = prefix.col(0).array();
+  this->prefix_min = prefix.col(1).array();
+}
+
+template class convergence_window_ < float >;
+template class convergence_window_ < double >;
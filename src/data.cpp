@@ -28,30 +28,118 @@
 
 #include <data.h>
 
+#ifndef _WIN32
+
+  #include <fcntl.h>    // open
+  #include <unistd.h>   // close
+  #include <sys/mman.h> // mmap, munmap
+  #include <sys/stat.h> // fstat
+
+#endif
+
 namespace data_loader
 {
 
-BaseData :: BaseData () : num_train_sample (0), num_test_sample (0),
-  rows (0), cols (0), channels (0),
-  training_images (nullptr), testing_images (nullptr),
-  training_labels (nullptr), testing_labels (nullptr)
+// buffer_view
+
+buffer_view :: buffer_view () : storage (nullptr), first (nullptr), sample_size (1), stride (1)
 {
+}
 
+buffer_view :: buffer_view (std :: shared_ptr < uint8_t > storage, const int64_t & offset,
+  const int64_t & sample_size, const int64_t & stride) : storage (storage), first (storage.get() + offset),
+                                                         sample_size (sample_size), stride (stride)
+{
 }
 
-BaseData :: BaseData (const BaseData & x) : num_train_sample (x.num_train_sample), num_test_sample (x.num_test_sample),
-rows (x.rows), cols (x.cols), channels (x.channels)
+uint8_t * buffer_view :: get () const
+{
+  return this->first;
+}
+
+uint8_t * buffer_view :: sample (const int64_t & idx) const
+{
+  return this->first + idx * this->stride;
+}
+
+bool buffer_view :: is_contiguous () const
+{
+  return this->stride == this->sample_size;
+}
+
+int64_t buffer_view :: get_stride () const
+{
+  return this->stride;
+}
+
+buffer_view :: operator bool () const
+{
+  return this->first != nullptr;
+}
+
+buffer_view buffer_view :: clone (const int64_t & num_samples) const
+{
+  if ( ! (*this) )
+    return buffer_view();
+
+  std :: shared_ptr < uint8_t > buffer(new uint8_t[num_samples * this->sample_size], std :: default_delete < uint8_t [] >());
+
+  for (int64_t i = 0; i < num_samples; ++i)
+    std :: copy_n(this->sample(i), this->sample_size, buffer.get() + i * this->sample_size);
+
+  return buffer_view(buffer, 0, this->sample_size, this->sample_size);
+}
+
+// sample_stream
+
+sample_stream :: sample_stream (const buffer_view & buffer, const int64_t & num_samples,
+  const int64_t & sample_size, const float & scale) : buffer (buffer), num_samples (num_samples),
+                                                      sample_size (sample_size), position (0), scale (scale)
+{
+}
+
+int32_t sample_stream :: operator () (float * chunk, const int32_t & max_rows)
+{
+  // end of the stream: restart from the first sample
+  if ( this->position == this->num_samples )
+  {
+    this->position = 0;
+    return 0;
+  }
+
+  const int64_t n_rows = std :: min(static_cast < int64_t >(max_rows), this->num_samples - this->position);
+
+  for (int64_t i = 0; i < n_rows; ++i)
+  {
+    const uint8_t * sample = this->buffer.sample(this->position + i);
+    float * row = chunk + i * this->sample_size;
+
+    for (int64_t j = 0; j < this->sample_size; ++j)
+      row[j] = static_cast < float >(sample[j]) * this->scale;
+  }
+
+  this->position += n_rows;
+
+  return static_cast < int32_t >(n_rows);
+}
+
+// BaseData
+
+BaseData :: BaseData (const bool & memory_map) : num_train_sample (0), num_test_sample (0),
+  rows (0), cols (0), channels (0), memory_map (memory_map),
+  training_images (), testing_images (),
+  training_labels (), testing_labels ()
 {
-  this->training_images.reset(new uint8_t[this->train_size()]);
-  this->testing_images.reset(new uint8_t[this->test_size()]);
 
-  this->training_labels.reset(new uint8_t[this->num_train_sample]);
-  this->testing_labels.reset(new uint8_t[this->num_test_sample]);
+}
 
-  std :: copy_n(x.training_images.get(), this->train_size(), this->training_images.get());
-  std :: copy_n(x.testing_images.get(), this->test_size(), this->testing_images.get());
-  std :: copy_n(x.training_labels.get(), this->num_train_sample, this->training_labels.get());
-  std :: copy_n(x.testing_labels.get(), this->num_test_sample, this->testing_labels.get());
+BaseData :: BaseData (const BaseData & x) : num_train_sample (x.num_train_sample), num_test_sample (x.num_test_sample),
+rows (x.rows), cols (x.cols), channels (x.channels), memory_map (x.memory_map)
+{
+  this->training_images = x.training_images.clone(this->num_train_sample);
+  this->testing_images = x.testing_images.clone(this->num_test_sample);
+  this->training_labels = x.training_labels.clone(this->num_train_sample);
+  this->testing_labels = x.testing_labels.clone(this->num_test_sample);
 }
 
 BaseData & BaseData :: operator = (const BaseData & x)
@@ -61,19 +149,73 @@ BaseData & BaseData :: operator = (const BaseData & x)
   this->rows = x.rows;
   this->cols = x.cols;
   this->channels = x.channels;
+  this->memory_map = x.memory_map;
+
+  this->training_images = x.training_images.clone(this->num_train_sample);
+  this->testing_images = x.testing_images.clone(this->num_test_sample);
+  this->training_labels = x.training_labels.clone(this->num_train_sample);
+  this->testing_labels = x.testing_labels.clone(this->num_test_sample);
+
+  return *this;
+}
 
-  this->training_images.reset(new uint8_t[this->train_size()]);
-  this->testing_images.reset(new uint8_t[this->test_size()]);
 
-  this->training_labels.reset(new uint8_t[this->num_train_sample]);
-  this->testing_labels.reset(new uint8_t[this->num_test_sample]);
+std :: shared_ptr < uint8_t > BaseData :: open_file (const std :: string & filename, int64_t & size) const
+{
 
-  std :: copy_n(x.training_images.get(), this->train_size(), this->training_images.get());
-  std :: copy_n(x.testing_images.get(), this->test_size(), this->testing_images.get());
-  std :: copy_n(x.training_labels.get(), this->num_train_sample, this->training_labels.get());
-  std :: copy_n(x.testing_labels.get(), this->num_test_sample, this->testing_labels.get());
+#ifndef _WIN32
 
-  return *this;
+  if ( this->memory_map )
+  {
+    const int fd = :: open(filename.c_str(), O_RDONLY);
+
+    if ( fd < 0 )
+      throw std :: runtime_error("File not found. Given: " + filename);
+
+    struct stat info;
+
+    if ( :: fstat(fd, &info) < 0 || info.st_size == 0 )
+    {
+      :: close(fd);
+      throw std :: runtime_error("Invalid file size. Given: " + filename);
+    }
+
+    size = static_cast < int64_t >(info.st_size);
+
+    // private (copy-on-write) mapping: the pages are shared until they are modified
+    void * region = :: mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    // the mapping is still valid after the file closing
+    :: close(fd);
+
+    if ( region == MAP_FAILED )
+      throw std :: runtime_error("Memory mapping failed. Given: " + filename);
+
+    return std :: shared_ptr < uint8_t >(static_cast < uint8_t * >(region),
+                                         [size] (uint8_t * ptr)
+                                         {
+                                           :: munmap(ptr, size);
+                                         });
+  }
+
+#endif // _WIN32
+
+  // open the file
+  std :: ifstream is(filename, std :: ios :: in | std :: ios :: binary | std :: ios :: ate);
+
+  // determine the file size
+  size = static_cast < int64_t >(is.tellg());
+  // reset the stream position
+  is.seekg(0, std :: ios :: beg);
+
+  // allocate the global buffer and read the file content
+  std :: shared_ptr < uint8_t > buffer(new uint8_t[size], std :: default_delete < uint8_t [] >());
+  is.read(reinterpret_cast < char * >(buffer.get()), size);
+
+  // close the file
+  is.close();
+
+  return buffer;
 }
 
 
@@ -103,24 +245,18 @@ cv :: Mat BaseData :: get_train_image (const std :: size_t & idx)
 {
   CV_Assert(static_cast < int32_t > (idx) < this->num_train_sample);
 
-  // get the initial buffer position
-  const int32_t start = idx * this->rows * this->cols * this->channels;
-
   return cv :: Mat(this->rows, this->cols,
                    CV_MAKETYPE(CV_8U, (this->channels)),
-                   this->training_images.get() + start);
+                   this->training_images.sample(idx));
 }
 
 cv :: Mat BaseData :: get_test_image (const std :: size_t & idx)
 {
   CV_Assert(static_cast < int32_t > (idx) < this->num_test_sample);
 
-  // get the initial buffer position
-  const int32_t start = idx * this->rows * this->cols * this->channels;
-
   return cv :: Mat(this->rows, this->cols,
                    CV_MAKETYPE(CV_8U, (this->channels)),
-                   this->testing_images.get() + start);
+                   this->testing_images.sample(idx));
 }
 
 #endif // __view__
@@ -28,6 +28,8 @@
 
 #include <fmath.h>
 
+#include <cstring> // std :: memcpy
+
 namespace math
 {
 
@@ -214,7 +216,7 @@ float rsqrt (const float & x)
 
   const float xhalf = x * 0.5f;
   float y;
-  union { float x; long i;} u;
+  union { float x; int32_t i;} u;
   u.x = x;
   u.i = 0x5f3759df - ( u.i >> 1 );          // what the fuck?
   y   = u.x * ( 1.5f - xhalf * u.x * u.x ); // 1st iteration
@@ -231,6 +233,360 @@ float rsqrt (const float & x)
 
 
 
+// Packet (SIMD) versions
+
+#if !defined __fast_math__ && (defined __AVX2__ || defined __AVX512F__)
+
+/**
+* @brief Apply the scalar function lane-wise on a packet.
+*
+* @note This is the fallback used when the fast approximations are disabled.
+*
+*/
+template < class Packet, class Func >
+static Packet lanewise (const Packet & x, Func func)
+{
+  constexpr int32_t size = sizeof(Packet) / sizeof(float);
+  alignas(Packet) float buffer[size];
+  std :: memcpy(buffer, &x, sizeof(Packet));
+
+  for (int32_t i = 0; i < size; ++i)
+    buffer[i] = func(buffer[i]);
+
+  Packet res;
+  std :: memcpy(&res, buffer, sizeof(Packet));
+  return res;
+}
+
+#endif
+
+#ifdef __AVX2__
+
+__m256 pow2 (const __m256 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m256 one    = _mm256_set1_ps(1.f);
+  const __m256 offset = _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ), one);
+  const __m256 clipp  = _mm256_max_ps(x, _mm256_set1_ps(-126.f));
+  const __m256 z      = _mm256_add_ps(_mm256_sub_ps(clipp, _mm256_round_ps(clipp, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)), offset);
+
+  __m256 v = _mm256_add_ps(clipp, _mm256_set1_ps(121.2740575f));
+  v = _mm256_add_ps(v, _mm256_div_ps(_mm256_set1_ps(27.7280233f), _mm256_sub_ps(_mm256_set1_ps(4.84252568f), z)));
+  v = _mm256_sub_ps(v, _mm256_mul_ps(_mm256_set1_ps(1.49012907f), z));
+  v = _mm256_mul_ps(v, _mm256_set1_ps(static_cast < float >(1 << 23)));
+
+  return _mm256_castsi256_ps(_mm256_cvttps_epi32(v));
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: pow2(xi); });
+
+#endif
+}
+
+__m256 exp (const __m256 & x)
+{
+
+#ifdef __fast_math__
+
+  return math :: pow2(_mm256_mul_ps(_mm256_set1_ps(1.442695040f), x));
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: exp(xi); });
+
+#endif
+}
+
+__m256 log2 (const __m256 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m256i vx = _mm256_castps_si256(x);
+  const __m256  mx = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(vx, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3f000000)));
+  const __m256  y  = _mm256_mul_ps(_mm256_cvtepi32_ps(vx), _mm256_set1_ps(1.1920928955078125e-7f));
+
+  __m256 res = _mm256_sub_ps(y, _mm256_set1_ps(124.22551499f));
+  res = _mm256_sub_ps(res, _mm256_mul_ps(_mm256_set1_ps(1.498030302f), mx));
+  res = _mm256_sub_ps(res, _mm256_div_ps(_mm256_set1_ps(1.72587999f), _mm256_add_ps(_mm256_set1_ps(0.3520887068f), mx)));
+
+  return res;
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: log2(xi); });
+
+#endif
+}
+
+__m256 pow (const __m256 & a, const __m256 & b)
+{
+
+#ifdef __fast_math__
+
+  return math :: pow2(_mm256_mul_ps(b, math :: log2(a)));
+
+#else
+
+  alignas(__m256) float exponent[8];
+  _mm256_store_ps(exponent, b);
+  int32_t lane = 0;
+  return lanewise(a, [&](const float & ai) { return math :: pow(ai, exponent[lane++]); });
+
+#endif
+}
+
+__m256 tanh (const __m256 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 e   = math :: pow2(_mm256_mul_ps(_mm256_set1_ps(-2.88539008f), x));
+
+  return _mm256_div_ps(_mm256_sub_ps(one, e), _mm256_add_ps(one, e));
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: tanh(xi); });
+
+#endif
+}
+
+__m256 rsqrt (const __m256 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m256 xhalf = _mm256_mul_ps(x, _mm256_set1_ps(.5f));
+  const __m256 three_half = _mm256_set1_ps(1.5f);
+
+  __m256 y = _mm256_castsi256_ps(_mm256_sub_epi32(_mm256_set1_epi32(0x5f3759df), _mm256_srli_epi32(_mm256_castps_si256(x), 1)));
+  y = _mm256_mul_ps(y, _mm256_sub_ps(three_half, _mm256_mul_ps(xhalf, _mm256_mul_ps(y, y)))); // 1st iteration
+  y = _mm256_mul_ps(y, _mm256_sub_ps(three_half, _mm256_mul_ps(xhalf, _mm256_mul_ps(y, y)))); // 2nd iteration
+
+  return y;
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: rsqrt(xi); });
+
+#endif
+}
+
+#endif // __AVX2__
+
+
+#ifdef __AVX512F__
+
+__m512 pow2 (const __m512 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m512 offset = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_LT_OQ), _mm512_set1_ps(1.f));
+  const __m512 clipp  = _mm512_max_ps(x, _mm512_set1_ps(-126.f));
+  const __m512 z      = _mm512_add_ps(_mm512_sub_ps(clipp, _mm512_roundscale_ps(clipp, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)), offset);
+
+  __m512 v = _mm512_add_ps(clipp, _mm512_set1_ps(121.2740575f));
+  v = _mm512_add_ps(v, _mm512_div_ps(_mm512_set1_ps(27.7280233f), _mm512_sub_ps(_mm512_set1_ps(4.84252568f), z)));
+  v = _mm512_sub_ps(v, _mm512_mul_ps(_mm512_set1_ps(1.49012907f), z));
+  v = _mm512_mul_ps(v, _mm512_set1_ps(static_cast < float >(1 << 23)));
+
+  return _mm512_castsi512_ps(_mm512_cvttps_epi32(v));
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: pow2(xi); });
+
+#endif
+}
+
+__m512 exp (const __m512 & x)
+{
+
+#ifdef __fast_math__
+
+  return math :: pow2(_mm512_mul_ps(_mm512_set1_ps(1.442695040f), x));
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: exp(xi); });
+
+#endif
+}
+
+__m512 log2 (const __m512 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m512i vx = _mm512_castps_si512(x);
+  const __m512  mx = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(vx, _mm512_set1_epi32(0x007FFFFF)), _mm512_set1_epi32(0x3f000000)));
+  const __m512  y  = _mm512_mul_ps(_mm512_cvtepi32_ps(vx), _mm512_set1_ps(1.1920928955078125e-7f));
+
+  __m512 res = _mm512_sub_ps(y, _mm512_set1_ps(124.22551499f));
+  res = _mm512_sub_ps(res, _mm512_mul_ps(_mm512_set1_ps(1.498030302f), mx));
+  res = _mm512_sub_ps(res, _mm512_div_ps(_mm512_set1_ps(1.72587999f), _mm512_add_ps(_mm512_set1_ps(0.3520887068f), mx)));
+
+  return res;
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: log2(xi); });
+
+#endif
+}
+
+__m512 pow (const __m512 & a, const __m512 & b)
+{
+
+#ifdef __fast_math__
+
+  return math :: pow2(_mm512_mul_ps(b, math :: log2(a)));
+
+#else
+
+  alignas(__m512) float exponent[16];
+  _mm512_store_ps(exponent, b);
+  int32_t lane = 0;
+  return lanewise(a, [&](const float & ai) { return math :: pow(ai, exponent[lane++]); });
+
+#endif
+}
+
+__m512 tanh (const __m512 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m512 one = _mm512_set1_ps(1.f);
+  const __m512 e   = math :: pow2(_mm512_mul_ps(_mm512_set1_ps(-2.88539008f), x));
+
+  return _mm512_div_ps(_mm512_sub_ps(one, e), _mm512_add_ps(one, e));
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: tanh(xi); });
+
+#endif
+}
+
+__m512 rsqrt (const __m512 & x)
+{
+
+#ifdef __fast_math__
+
+  const __m512 xhalf = _mm512_mul_ps(x, _mm512_set1_ps(.5f));
+  const __m512 three_half = _mm512_set1_ps(1.5f);
+
+  __m512 y = _mm512_castsi512_ps(_mm512_sub_epi32(_mm512_set1_epi32(0x5f3759df), _mm512_srli_epi32(_mm512_castps_si512(x), 1)));
+  y = _mm512_mul_ps(y, _mm512_sub_ps(three_half, _mm512_mul_ps(xhalf, _mm512_mul_ps(y, y)))); // 1st iteration
+  y = _mm512_mul_ps(y, _mm512_sub_ps(three_half, _mm512_mul_ps(xhalf, _mm512_mul_ps(y, y)))); // 2nd iteration
+
+  return y;
+
+#else
+
+  return lanewise(x, [](const float & xi) { return math :: rsqrt(xi); });
+
+#endif
+}
+
+#endif // __AVX512F__
+
+
+// Span versions
+
+/**
+* @brief Apply the function to the whole buffer.
+*
+* @note With the fast approximations enabled the buffer is processed using
+* the widest packet available and the tail with the scalar version.
+* Otherwise the std functions are applied element-wise.
+*
+*/
+template < class Func >
+static void apply_span (const float * x, float * out, const int32_t & n, Func func)
+{
+  int32_t i = 0;
+
+#ifdef __fast_math__
+
+#ifdef __AVX512F__
+
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(out + i, func(_mm512_loadu_ps(x + i)));
+
+#endif
+
+#ifdef __AVX2__
+
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, func(_mm256_loadu_ps(x + i)));
+
+#endif
+
+#endif // __fast_math__
+
+  for (; i < n; ++i)
+    out[i] = func(x[i]);
+}
+
+/**
+* @brief Functor of the pow function with a fixed exponent.
+*
+*/
+struct pow_exponent
+{
+  float b; ///< exponent value
+
+  float operator () (const float & a) const { return math :: pow(a, this->b); }
+
+#ifdef __AVX2__
+  __m256 operator () (const __m256 & a) const { return math :: pow(a, _mm256_set1_ps(this->b)); }
+#endif
+
+#ifdef __AVX512F__
+  __m512 operator () (const __m512 & a) const { return math :: pow(a, _mm512_set1_ps(this->b)); }
+#endif
+};
+
+void pow2 (const float * x, float * out, const int32_t & n)
+{
+  apply_span(x, out, n, [](const auto & xi) { return math :: pow2(xi); });
+}
+
+void exp (const float * x, float * out, const int32_t & n)
+{
+  apply_span(x, out, n, [](const auto & xi) { return math :: exp(xi); });
+}
+
+void log2 (const float * x, float * out, const int32_t & n)
+{
+  apply_span(x, out, n, [](const auto & xi) { return math :: log2(xi); });
+}
+
+void pow (const float * a, const float & b, float * out, const int32_t & n)
+{
+  apply_span(a, out, n, pow_exponent { b });
+}
+
+void tanh (const float * x, float * out, const int32_t & n)
+{
+  apply_span(x, out, n, [](const auto & xi) { return math :: tanh(xi); });
+}
+
+void rsqrt (const float * x, float * out, const int32_t & n)
+{
+  apply_span(x, out, n, [](const auto & xi) { return math :: rsqrt(xi); });
+}
+
+
+
 int32_t sign (const float & x)
 {
   return (x > 0) ? 1 : ((x < 0) ? -1 : 0);
@@ -0,0 +1,212 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+#include <half.h>
+
+namespace precision
+{
+
+uint16_t to_fp16 (const float & x)
+{
+  uint32_t bits;
+  std :: memcpy(&bits, &x, sizeof(float));
+
+  const uint16_t sign = static_cast < uint16_t >((bits >> 16) & 0x8000u);
+  bits &= 0x7FFFFFFFu;
+
+  // infinity and NaN
+  if (bits >= 0x7F800000u)
+    return sign | (bits > 0x7F800000u ? 0x7E00u : 0x7C00u);
+
+  // overflow (the values >= 65520 are rounded to infinity)
+  if (bits >= 0x477FF000u)
+    return sign | 0x7C00u;
+
+  // subnormal half values (< 2^-14)
+  if (bits < 0x38800000u)
+  {
+    // underflow (<= 2^-25 is rounded to zero)
+    if (bits <= 0x33000000u)
+      return sign;
+
+    const uint32_t mantissa = (bits & 0x7FFFFFu) | 0x800000u;
+    const uint32_t shift = 126u - (bits >> 23);
+    const uint32_t rem = mantissa & ((1u << shift) - 1u);
+    const uint32_t half = 1u << (shift - 1u);
+
+    uint32_t res = mantissa >> shift;
+    res += (rem > half || (rem == half && (res & 1u)));
+
+    return sign | static_cast < uint16_t >(res);
+  }
+
+  // normal values: re-bias the exponent and round the mantissa
+  uint32_t res = (bits - 0x38000000u) >> 13;
+  const uint32_t rem = bits & 0x1FFFu;
+  res += (rem > 0x1000u || (rem == 0x1000u && (res & 1u)));
+
+  return sign | static_cast < uint16_t >(res);
+}
+
+float from_fp16 (const uint16_t & x)
+{
+  const uint32_t sign = static_cast < uint32_t >(x & 0x8000u) << 16;
+  const uint32_t exponent = (x >> 10) & 0x1Fu;
+  const uint32_t mantissa = x & 0x3FFu;
+
+  // zero and subnormal values (mantissa * 2^-24)
+  if (exponent == 0)
+  {
+    const float res = static_cast < float >(mantissa) * 5.9604644775390625e-8f;
+    return sign ? -res : res;
+  }
+
+  const uint32_t bits = exponent == 0x1Fu ? sign | 0x7F800000u | (mantissa << 13)
+                                          : sign | ((exponent + 112u) << 23) | (mantissa << 13);
+  float res;
+  std :: memcpy(&res, &bits, sizeof(float));
+  return res;
+}
+
+void float_to_bf16 (const float * x, uint16_t * out, const int32_t & n)
+{
+  int32_t i = 0;
+
+#if defined __AVX512F__
+
+  const __m512i bias = _mm512_set1_epi32(0x7FFF);
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i qnan = _mm512_set1_epi32(0x7FC0);
+
+  for (; i + 16 <= n; i += 16)
+  {
+    const __m512 v = _mm512_loadu_ps(x + i);
+    const __m512i bits = _mm512_castps_si512(v);
+
+    // round to nearest even and keep the upper half
+    __m512i res = _mm512_add_epi32(bits, _mm512_add_epi32(bias, _mm512_and_si512(_mm512_srli_epi32(bits, 16), one)));
+    res = _mm512_srli_epi32(res, 16);
+    res = _mm512_mask_mov_epi32(res, _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q), qnan);
+
+    _mm256_storeu_si256(reinterpret_cast < __m256i * >(out + i), _mm512_cvtepi32_epi16(res));
+  }
+
+#elif defined __AVX2__
+
+  const __m256i bias = _mm256_set1_epi32(0x7FFF);
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i qnan = _mm256_set1_epi32(0x7FC0);
+
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m256 v = _mm256_loadu_ps(x + i);
+    const __m256i bits = _mm256_castps_si256(v);
+
+    // round to nearest even and keep the upper half
+    __m256i res = _mm256_add_epi32(bits, _mm256_add_epi32(bias, _mm256_and_si256(_mm256_srli_epi32(bits, 16), one)));
+    res = _mm256_srli_epi32(res, 16);
+    res = _mm256_blendv_epi8(res, qnan, _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q)));
+
+    _mm_storeu_si128(reinterpret_cast < __m128i * >(out + i),
+                     _mm_packus_epi32(_mm256_castsi256_si128(res), _mm256_extracti128_si256(res, 1)));
+  }
+
+#endif
+
+  for (; i < n; ++i)
+    out[i] = to_bf16(x[i]);
+}
+
+void bf16_to_float (const uint16_t * x, float * out, const int32_t & n)
+{
+  int32_t i = 0;
+
+#if defined __AVX512F__
+
+  for (; i + 16 <= n; i += 16)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast < const __m256i * >(x + i));
+    _mm512_storeu_ps(out + i, _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(v), 16)));
+  }
+
+#elif defined __AVX2__
+
+  for (; i + 8 <= n; i += 8)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast < const __m128i * >(x + i));
+    _mm256_storeu_ps(out + i, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(v), 16)));
+  }
+
+#endif
+
+  for (; i < n; ++i)
+    out[i] = from_bf16(x[i]);
+}
+
+void float_to_fp16 (const float * x, uint16_t * out, const int32_t & n)
+{
+  int32_t i = 0;
+
+#if defined __AVX512F__
+
+  for (; i + 16 <= n; i += 16)
+    _mm256_storeu_si256(reinterpret_cast < __m256i * >(out + i),
+                        _mm512_cvtps_ph(_mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+
+#elif defined __F16C__
+
+  for (; i + 8 <= n; i += 8)
+    _mm_storeu_si128(reinterpret_cast < __m128i * >(out + i),
+                     _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+
+#endif
+
+  for (; i < n; ++i)
+    out[i] = to_fp16(x[i]);
+}
+
+void fp16_to_float (const uint16_t * x, float * out, const int32_t & n)
+{
+  int32_t i = 0;
+
+#if defined __AVX512F__
+
+  for (; i + 16 <= n; i += 16)
+    _mm512_storeu_ps(out + i, _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast < const __m256i * >(x + i))));
+
+#elif defined __F16C__
+
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast < const __m128i * >(x + i))));
+
+#endif
+
+  for (; i < n; ++i)
+    out[i] = from_fp16(x[i]);
+}
+
+} // end namespace precision
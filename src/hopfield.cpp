@@ -28,102 +28,421 @@
 
 #include <hopfield.h>
 
-Hopfield :: Hopfield (const int32_t & outputs, const int32_t & batch_size,
+template < class Scalar >
+Hopfield_ < Scalar > :: Hopfield_ (const int32_t & outputs, const int32_t & batch_size,
   update_args optimizer,
   weights_initialization weights_init,
   int32_t epochs_for_convergency, float convergency_atol,
   float decay,
   float delta, float p, int32_t k
-  ) : BasePlasticity (outputs, batch_size, transfer_t :: linear,
+  ) : BasePlasticity_ < Scalar > (outputs, batch_size, transfer_t :: linear,
                       optimizer, weights_init, epochs_for_convergency,
                       convergency_atol, decay),
-      k (k), delta (delta), p (p)
+      k (k), delta (delta), p (p), wnorm (), wnorm_version (-1)
 {
   this->check_params();
 }
 
 
-Hopfield :: Hopfield (const Hopfield & b) : BasePlasticity (b), k (b.k), delta (b.delta), p (b.p)
+template < class Scalar >
+Hopfield_ < Scalar > :: Hopfield_ (const Hopfield_ & b) : BasePlasticity_ < Scalar > (b), k (b.k), delta (b.delta), p (b.p),
+  wnorm (), wnorm_version (-1)
 {
 }
 
-Hopfield & Hopfield :: operator = (const Hopfield & b)
+template < class Scalar >
+Hopfield_ < Scalar > & Hopfield_ < Scalar > :: operator = (const Hopfield_ & b)
 {
-  BasePlasticity :: operator = (b);
+  BasePlasticity_ < Scalar > :: operator = (b);
 
   this->k = b.k;
   this->delta = b.delta;
   this->p = b.p;
 
+  this->wnorm_version = -1;
+
   return *this;
 }
 
 
-void Hopfield :: check_params ()
+template < class Scalar >
+void Hopfield_ < Scalar > :: check_params ()
 {
   // The value of the K variable must be positive and greater than 2
   if ( this->k < 2 )
     throw std :: runtime_error("k must be an integer bigger or equal than 2");
+
+  // The k-th ranked unit must exist
+  if ( this->k > this->outputs )
+    throw std :: runtime_error("k must be an integer lower or equal than the number of outputs (" +
+                               std :: to_string(this->outputs) + ")");
+}
+
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: init_workspace (const int32_t & n_features)
+{
+  BasePlasticity_ < Scalar > :: init_workspace(n_features);
+
+  // the training evaluates the output by tiles, so the full matrix is not required
+  this->batch_output.resize(0, 0);
+
+  this->yl_first.resize(this->batch);
+  this->yl_kth.resize(this->batch);
+  this->y_first.resize(this->batch);
+  this->y_kth.resize(this->batch);
+
+  this->rank_values.resize(this->k, this->batch);
+  this->rank_index.resize(this->k, this->batch);
+  this->tiles.resize(Hopfield_ :: tile_rows, Hopfield_ :: tile_cols * this->num_threads);
+  this->scatter_update.resize(n_features, this->outputs);
+
+  if (this->p != 2.f)
+    this->wnorm.resize(this->outputs, n_features);
+}
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: reset_rank (const int32_t & i)
+{
+  this->rank_values.col(i).setConstant(-std :: numeric_limits < Scalar > :: infinity());
+  this->rank_index.col(i).setConstant(-1);
+}
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: merge_rank (const Scalar * col, const int32_t & n, const int32_t & offset, const int32_t & i)
+{
+  Scalar * values = this->rank_values.col(i).data();
+  int32_t * index = this->rank_index.col(i).data();
+
+  if (this->k == 2)
+  {
+    // single pass tracking the two largest values (in descending order)
+    for (int32_t j = 0; j < n; ++j)
+    {
+      const Scalar val = col[j];
+
+      if (val > values[0])
+      {
+        values[1] = values[0];
+        index[1] = index[0];
+        values[0] = val;
+        index[0] = offset + j;
+      }
+      else if (val > values[1])
+      {
+        values[1] = val;
+        index[1] = offset + j;
+      }
+    }
+
+    return;
+  }
+
+  // bounded min-heap of the k largest values
+  // NOTE: the heap is initialized with -inf values, so it is always full
+  for (int32_t j = 0; j < n; ++j)
+  {
+    const Scalar val = col[j];
+
+    // the top of the heap is the smallest of the k largest values
+    if (val <= values[0])
+      continue;
+
+    // replace the top and restore the heap property (sift-down)
+    int32_t pos = 0;
+
+    while (true)
+    {
+      const int32_t left = 2 * pos + 1;
+      const int32_t right = left + 1;
+
+      if (left >= this->k)
+        break;
+
+      const int32_t child = (right < this->k && values[right] < values[left]) ? right : left;
+
+      if (values[child] >= val)
+        break;
+
+      values[pos] = values[child];
+      index[pos] = index[child];
+      pos = child;
+    }
+
+    values[pos] = val;
+    index[pos] = offset + j;
+  }
+}
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: select_rank (const int32_t & i)
+{
+  const auto values = this->rank_values.col(i);
+  const auto index = this->rank_index.col(i);
+
+  // the k-th ranked unit is the second value for k = 2 or the top of the heap
+  const int32_t kth = this->k == 2 ? 1 : 0;
+  int32_t first = 0;
+
+  if (this->k != 2)
+    values.maxCoeff(&first);
+
+  this->yl_first(i) = index(first);
+  this->y_first(i) = values(first);
+  this->yl_kth(i) = index(kth);
+  this->y_kth(i) = values(kth);
+}
+
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: weights_update_into (const matrix_t & X, const matrix_t & output,
+  matrix_t & weights_update)
+{
+  // rank the output columns
+  // NOTE: each column is independent, so the selection can be performed in parallel
+  const int32_t n_cols = static_cast < int32_t >(output.cols());
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads (this->num_threads)
+#endif
+  for (int32_t i = 0; i < n_cols; ++i)
+  {
+    this->reset_rank(i);
+    this->merge_rank(output.col(i).data(), this->outputs, 0, i);
+    this->select_rank(i);
+  }
+
+  this->ranking_update_into(X, weights_update);
 }
 
 
-Eigen :: MatrixXf Hopfield :: weights_update (const Eigen :: MatrixXf & X, const Eigen :: MatrixXf & output)
+template < class Scalar >
+void Hopfield_ < Scalar > :: forward_update_into (const matrix_t & X, matrix_t & weights_update)
 {
-  // compute the columns re-order for the Krotov approximation
+  // NOTE: the (cached) forward matrix is evaluated before the parallel section
+  const Eigen :: Map < const matrix_t > w = this->forward_weights();
 
-  // init the interaction matrix with a zero matrix
-  Eigen :: MatrixXf yl = Eigen :: MatrixXf :: Zero(this->outputs, this->batch);
-  int32_t col_index = 0;
+  const int32_t n_cols = static_cast < int32_t >(X.cols());
+  const int32_t n_col_tiles = (n_cols + Hopfield_ :: tile_cols - 1) / Hopfield_ :: tile_cols;
 
-  // sort the output columns
-  // NOTE: the following for loop can be rewritten as for (auto && col : output.colwise())
-  //       using directly the col vector but it is available only with Eigen version > 3.3.90.
-  //       In the same way we can rewrite the sorting algorithm with the simplified .begin(), .end()
-  //       member functions.
-  //       We use the older version of the Eigen syntax just to improve the retro-compatibility of the
-  //       library
-  for (int32_t i = 0; i < output.cols(); ++i)
+  // the number of threads can be changed after the workspace allocation
+  if (this->tiles.cols() < Hopfield_ :: tile_cols * this->num_threads)
+    this->tiles.resize(Hopfield_ :: tile_rows, Hopfield_ :: tile_cols * this->num_threads);
+
+  for (int32_t i = 0; i < n_cols; ++i)
+    this->reset_rank(i);
+
+  // the blocks of units are the outer loop, so each block of the forward matrix
+  // is loaded only once, while the tiles of samples are distributed among the threads
+  for (int32_t r = 0; r < this->outputs; r += Hopfield_ :: tile_rows)
   {
-    auto col = output.col(i);
-    Eigen :: VectorXi order = Eigen :: VectorXi :: LinSpaced(this->outputs, 0, this->outputs);
-    std :: sort(order.data(), order.data() + this->outputs,
-                [&](const int32_t & xi, const int32_t & xj)
-                {
-                  return col[xi] < col[xj];
-                });
-    const int32_t row_index = order[this->outputs - 1];
-    yl(row_index, col_index) = 1.f;
-
-    const int32_t decrease_index = order[this->outputs - this->k];
-    yl(decrease_index, col_index) = -this->delta;
-
-    ++ col_index;
+    const int32_t n_rows = std :: min(Hopfield_ :: tile_rows, this->outputs - r);
+    const auto w_block = w.middleRows(r, n_rows);
+
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads (this->num_threads) if (this->num_threads > 1 && n_col_tiles > 1)
+#endif
+    for (int32_t t = 0; t < n_col_tiles; ++t)
+    {
+#ifdef _OPENMP
+      const int32_t thread = omp_get_thread_num();
+#else
+      const int32_t thread = 0;
+#endif
+
+      const int32_t first = t * Hopfield_ :: tile_cols;
+      const int32_t len = std :: min(Hopfield_ :: tile_cols, n_cols - first);
+
+      auto tile = this->tiles.block(0, thread * Hopfield_ :: tile_cols, n_rows, len);
+      tile.noalias() = w_block * X.middleCols(first, len);
+
+      // merge the tile into the running ranking of its samples
+      for (int32_t i = 0; i < len; ++i)
+        this->merge_rank(tile.col(i).data(), n_rows, r, first + i);
+    }
   }
 
-  this->theta = yl.cwiseProduct(output).rowwise().sum();
+  for (int32_t i = 0; i < n_cols; ++i)
+    this->select_rank(i);
+
+  this->ranking_update_into(X, weights_update);
+}
+
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: ranking_update_into (const matrix_t & X, matrix_t & weights_update)
+{
+  // NOTE: the ranking matrix has only two non-zero entries for each column,
+  // so it is stored as the pair of row indices (first -> 1, k-th -> -delta)
+  const int32_t n_cols = static_cast < int32_t >(X.cols());
+  const int32_t n_features = static_cast < int32_t >(X.rows());
+
+  // theta = (yl * output).rowwise().sum() computed on the sparse entries
+  this->theta.setZero(this->outputs);
+
+  for (int32_t i = 0; i < n_cols; ++i)
+  {
+    this->theta(this->yl_first(i)) += this->y_first(i);
+    this->theta(this->yl_kth(i)) -= this->delta * this->y_kth(i);
+  }
 
   // compute the weights updates using the Hopfield formulation
-  Eigen :: MatrixXf weights_update = (yl * X).array() - this->weights.array().colwise() * this->theta.array();
+  // as scatter-add of the input samples (sparse yl * X.T)
+  // NOTE: the update is accumulated in the transposed layout, so each sample adds
+  // a contiguous segment of its column to the contiguous column of the ranked unit.
+  // The blocks of features are independent, so they can be accumulated in parallel
+  this->scatter_update.setZero();
+
+  const int32_t block_size = 64;
+  const int32_t n_blocks = (n_features + block_size - 1) / block_size;
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads (this->num_threads)
+#endif
+  for (int32_t b = 0; b < n_blocks; ++b)
+  {
+    const int32_t first = b * block_size;
+    const int32_t len = std :: min(block_size, n_features - first);
+
+    for (int32_t i = 0; i < n_cols; ++i)
+    {
+      const auto x = X.col(i).segment(first, len);
+
+      this->scatter_update.col(this->yl_first(i)).segment(first, len) += x;
+      this->scatter_update.col(this->yl_kth(i)).segment(first, len) -= this->delta * x;
+    }
+  }
+
+  // a single (blocked) transposition gives the update in the layout of the weights
+  weights_update.noalias() = this->scatter_update.transpose();
+  weights_update.array() -= this->weights.array().colwise() * this->theta.array();
 
   // normalize the weights update by the maximum value
   // to avoid numerical instabilities
-  const float max_abs_val = 1.f / weights_update.cwiseAbs().maxCoeff();
+  const Scalar max_abs_val = Scalar(1) / weights_update.cwiseAbs().maxCoeff();
   // Add the minus for compatibility with optimization algorithms
-  weights_update = weights_update.array() * (-max_abs_val);
+  weights_update *= -max_abs_val;
+}
+
 
-  return weights_update;
+template < class Scalar >
+void Hopfield_ < Scalar > :: normalize_weights ()
+{
+  const float exponent = this->p - 1.f;
+  const float twice = 2.f * exponent;
+
+  const auto weights = this->weights_view();
+  const auto abs_w = weights.array().abs();
+
+  // integer and half-integer exponents (p = 3, 4, 4.5, ...)
+  // are evaluated by repeated products without any pow call
+  if (exponent >= 1.f && twice == std :: floor(twice) && twice <= 16.f)
+  {
+    const int32_t n = static_cast < int32_t >(twice) / 2;
+
+    this->wnorm.array() = abs_w;
+
+    for (int32_t i = 1; i < n; ++i)
+      this->wnorm.array() *= abs_w;
+
+    if (static_cast < int32_t >(twice) % 2)
+      this->wnorm.array() *= abs_w.sqrt();
+  }
+
+  else
+  {
+#ifdef __fast_math__
+    // NOTE: the fast math pow is available only in single precision
+    if constexpr ( std :: is_same < Scalar, float > :: value )
+    {
+      this->wnorm.array() = abs_w;
+      math :: pow(this->wnorm.data(), exponent, this->wnorm.data(), static_cast < int32_t >(this->wnorm.size()));
+    }
+    else
+      this->wnorm.array() = abs_w.pow(static_cast < Scalar >(exponent));
+#else
+    this->wnorm.array() = abs_w.pow(static_cast < Scalar >(exponent));
+#endif
+  }
+
+  // restore the sign of the weights
+  this->wnorm.array() = (weights.array() < 0.f).select(-this->wnorm.array(), this->wnorm.array());
 }
 
 
-Eigen :: MatrixXf Hopfield :: _predict (const Eigen :: MatrixXf & data)
+template < class Scalar >
+Eigen :: Map < const typename Hopfield_ < Scalar > :: matrix_t > Hopfield_ < Scalar > :: forward_weights ()
 {
-  // apply Lebesgue norm
-  Eigen :: MatrixXf wnorm = (this->p != 2.f) ? this->weights.unaryExpr(
-    [&](const float & w) -> float {
-      return std :: copysign(std :: pow(std :: fabs(w), this->p - 1.f), w);
-    }) : this->weights;
-  // Compute the output as W @ X
-  Eigen :: MatrixXf output = wnorm * data.transpose();
+  if (this->p == 2.f)
+    return this->weights_view();
+
+  // re-compute the normalized weights only if the weights are changed
+  if (this->wnorm_version != this->weights_version)
+  {
+    const auto weights = this->weights_view();
+
+    this->wnorm.resize(weights.rows(), weights.cols());
+    this->normalize_weights();
+    this->wnorm_version = this->weights_version;
+  }
+
+  return Eigen :: Map < const matrix_t >(this->wnorm.data(), this->wnorm.rows(), this->wnorm.cols());
+}
+
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: save_state (model_file :: writer & file) const
+{
+  BasePlasticity_ < Scalar > :: save_state(file);
+
+  file.set("model", "Hopfield");
+  file.set("k", this->k);
+  file.set("delta", this->delta);
+  file.set("p", this->p);
+}
+
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: load_state (const model_file :: reader & file)
+{
+  if ( file.get < std :: string >("model") != "Hopfield" )
+    throw std :: runtime_error("Invalid model file. The file stores a " + file.get < std :: string >("model") + " model");
+
+  BasePlasticity_ < Scalar > :: load_state(file);
 
-  return output;
+  this->k = file.get < int32_t >("k");
+  this->delta = file.get < float >("delta");
+  this->p = file.get < float >("p");
+
+  this->check_params();
+  this->wnorm_version = -1;
+}
+
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: stage_costs (const int32_t & n_features,
+  std :: array < double, num_stages > & flops, std :: array < double, num_stages > & bytes) const
+{
+  BasePlasticity_ < Scalar > :: stage_costs(n_features, flops, bytes);
+
+  const double num_weights = static_cast < double >(this->outputs) * n_features;
+  const double num_inputs = static_cast < double >(n_features) * this->batch;
+
+  // two sparse rank-1 updates for each sample, then dW -= W * theta and dW /= max(|dW|)
+  flops[stage_t :: weights_update_stage] = 4. * num_inputs + 4. * num_weights;
+  bytes[stage_t :: weights_update_stage] = (2. * num_inputs + 4. * num_weights) * sizeof(Scalar);
+
+  flops[stage_t :: forward_update_stage] = flops[stage_t :: predict_stage] + flops[stage_t :: weights_update_stage];
+  bytes[stage_t :: forward_update_stage] = bytes[stage_t :: predict_stage] + bytes[stage_t :: weights_update_stage];
 }
+
+template < class Scalar >
+void Hopfield_ < Scalar > :: _predict_into (const Eigen :: Ref < const matrix_t > & data, Eigen :: Ref < matrix_t > output)
+{
+  // Compute the output as W @ X
+  // NOTE: for p != 2 the Lebesgue norm of the weights is applied
+  output.noalias() = this->forward_weights() * data;
+}
+
+template class Hopfield_ < float >;
+template class Hopfield_ < double >;
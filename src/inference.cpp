@@ -0,0 +1,247 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+#include <inference.h>
+
+request_queue :: request_queue (const int64_t & capacity) : buffer (), mask (0), enqueue_pos (0), dequeue_pos (0)
+{
+  // round the capacity to the next power of 2, so the position in the ring is a bit mask
+  int64_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+
+  this->buffer.reset(new slot[size]);
+  this->mask = size - 1;
+
+  // each slot is ready to be written by the push at the same position
+  for (int64_t i = 0; i < size; ++i)
+    this->buffer[i].sequence.store(i, std :: memory_order_relaxed);
+}
+
+bool request_queue :: push (request & req)
+{
+  slot * cell = nullptr;
+  int64_t pos = this->enqueue_pos.load(std :: memory_order_relaxed);
+
+  while (true)
+  {
+    cell = &this->buffer[pos & this->mask];
+    const int64_t diff = cell->sequence.load(std :: memory_order_acquire) - pos;
+
+    // the slot is free: try to reserve it
+    if (diff == 0)
+    {
+      if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std :: memory_order_relaxed))
+        break;
+    }
+    // the slot is still occupied by the previous round: the queue is full
+    else if (diff < 0)
+      return false;
+    // another producer has reserved the slot
+    else
+      pos = this->enqueue_pos.load(std :: memory_order_relaxed);
+  }
+
+  cell->data = std :: move(req);
+  // publish the request to the consumers
+  cell->sequence.store(pos + 1, std :: memory_order_release);
+
+  return true;
+}
+
+bool request_queue :: pop (request & req)
+{
+  slot * cell = nullptr;
+  int64_t pos = this->dequeue_pos.load(std :: memory_order_relaxed);
+
+  while (true)
+  {
+    cell = &this->buffer[pos & this->mask];
+    const int64_t diff = cell->sequence.load(std :: memory_order_acquire) - (pos + 1);
+
+    // the slot has been published: try to reserve it
+    if (diff == 0)
+    {
+      if (this->dequeue_pos.compare_exchange_weak(pos, pos + 1, std :: memory_order_relaxed))
+        break;
+    }
+    // the slot is not yet written: the queue is empty
+    else if (diff < 0)
+      return false;
+    // another consumer has reserved the slot
+    else
+      pos = this->dequeue_pos.load(std :: memory_order_relaxed);
+  }
+
+  req = std :: move(cell->data);
+  // release the slot for the push of the next round
+  cell->sequence.store(pos + this->mask + 1, std :: memory_order_release);
+
+  return true;
+}
+
+
+inference_engine :: inference_engine (BasePlasticity & model, const int32_t & max_batch,
+  const std :: chrono :: microseconds & max_latency) : model (model),
+  n_features (static_cast < int32_t >(model.weights_view().cols())), outputs (static_cast < int32_t >(model.weights_view().rows())),
+  max_batch (max_batch), max_latency (max_latency),
+  queue (16 * static_cast < int64_t >(std :: max(max_batch, 1))),
+  pending (), batch_data (), batch_output (),
+  running (true), num_requests (0), num_batches (0), worker ()
+{
+  if ( max_batch < 1 )
+    throw std :: runtime_error("max_batch must be an integer bigger or equal than 1");
+
+  // the weights can be owned by the model or mapped from a model file (load_mmap)
+  model.check_is_fitted();
+
+  // allocate the buffers of the micro-batch only once
+  this->pending.reserve(max_batch);
+  this->batch_data.resize(this->n_features, max_batch);
+  this->batch_output.resize(this->outputs, max_batch);
+
+  this->worker = std :: thread(&inference_engine :: serve, this);
+}
+
+inference_engine :: ~inference_engine ()
+{
+  // the worker serves the pending requests before leaving the loop
+  this->running.store(false, std :: memory_order_release);
+
+  if (this->worker.joinable())
+    this->worker.join();
+}
+
+std :: future < void > inference_engine :: submit (const float * sample, float * output)
+{
+  request_queue :: request req {sample, output, std :: promise < void >()};
+  std :: future < void > result = req.done.get_future();
+
+  // wait for a free slot if the queue is full
+  while ( !this->queue.push(req) )
+    std :: this_thread :: yield();
+
+  return result;
+}
+
+void inference_engine :: predict (const float * sample, float * output)
+{
+  this->submit(sample, output).get();
+}
+
+int64_t inference_engine :: get_num_requests () const
+{
+  return this->num_requests.load(std :: memory_order_relaxed);
+}
+
+int64_t inference_engine :: get_num_batches () const
+{
+  return this->num_batches.load(std :: memory_order_relaxed);
+}
+
+void inference_engine :: serve ()
+{
+  using clock = std :: chrono :: steady_clock;
+
+  request_queue :: request req;
+  int32_t idle = 0;
+
+  while (true)
+  {
+    // wait for the first request of the micro-batch
+    if ( !this->queue.pop(req) )
+    {
+      if ( !this->running.load(std :: memory_order_acquire) )
+        break;
+
+      // spin for a while and then sleep to release the core
+      if (++idle < 64)
+        std :: this_thread :: yield();
+      else
+        std :: this_thread :: sleep_for(std :: chrono :: microseconds(50));
+
+      continue;
+    }
+
+    idle = 0;
+    this->pending.push_back(std :: move(req));
+
+    // collect the other requests until the batch is full or the latency budget is over
+    const auto deadline = clock :: now() + this->max_latency;
+
+    while (static_cast < int32_t >(this->pending.size()) < this->max_batch)
+    {
+      if (this->queue.pop(req))
+        this->pending.push_back(std :: move(req));
+
+      else if (clock :: now() >= deadline || !this->running.load(std :: memory_order_acquire))
+        break;
+
+      else
+        std :: this_thread :: yield();
+    }
+
+    this->process_batch();
+  }
+}
+
+void inference_engine :: process_batch ()
+{
+  const int32_t n_samples = static_cast < int32_t >(this->pending.size());
+
+  // gather the samples as columns of the batch buffer
+  for (int32_t i = 0; i < n_samples; ++i)
+    this->batch_data.col(i) = Eigen :: Map < const Eigen :: VectorXf >(this->pending[i].sample, this->n_features);
+
+  try
+  {
+    // evaluate the whole micro-batch with a single GEMM
+    // NOTE: the columns of the batch buffer are the samples in ravel format
+    this->model.predict_into(this->batch_data.data(), n_samples, this->n_features, this->batch_output.data());
+  }
+  catch (...)
+  {
+    // forward the error to all the requests of the batch
+    for (auto & r : this->pending)
+      r.done.set_exception(std :: current_exception());
+
+    this->pending.clear();
+    return;
+  }
+
+  // scatter the outputs and signal the completion of the requests
+  for (int32_t i = 0; i < n_samples; ++i)
+  {
+    Eigen :: Map < Eigen :: VectorXf >(this->pending[i].output, this->outputs) = this->batch_output.col(i);
+    this->pending[i].done.set_value();
+  }
+
+  this->num_requests.fetch_add(n_samples, std :: memory_order_relaxed);
+  this->num_batches.fetch_add(1, std :: memory_order_relaxed);
+
+  this->pending.clear();
+}
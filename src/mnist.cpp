@@ -31,7 +31,7 @@
 namespace data_loader
 {
 
-MNIST :: MNIST () : BaseData ()
+MNIST :: MNIST (const bool & memory_map) : BaseData (memory_map)
 {
 }
 
@@ -96,50 +96,49 @@ void MNIST :: load_testing_labels (const std :: string & testing_labels)
 // Private members
 
 
-void MNIST :: load_file (const std :: string & filename, std :: unique_ptr < uint8_t [] > & data,
+void MNIST :: load_file (const std :: string & filename, buffer_view & data,
   const uint32_t & magic_key, int32_t & nsample)
 {
-  // open the file
-  std :: ifstream is(filename, std :: ios :: in | std :: ios :: binary | std :: ios :: ate);
+  // open (map or read) the file
+  // NOTE: the data buffer is a view of the file content, so no further copy is performed
+  int64_t size = 0;
+  std :: shared_ptr < uint8_t > buffer = this->open_file(filename, size);
 
-  // determine the file size
-  std :: streamsize size = is.tellg();
-  // reset the stream position
-  is.seekg(0, std :: ios :: beg);
-  // allocate the global buffer
-  std :: unique_ptr < char [] > buffer(new char[size]);
-  // read the file content
-  is.read(buffer.get(), size);
+  if (size < 8)
+    throw std :: runtime_error ("The file is not large enough to hold the header, probably corrupted");
 
-  // close the file
-  is.close();
+  char * header = reinterpret_cast < char * >(buffer.get());
 
   // start the processing
-  uint32_t key = this->read_header(buffer.get(), 0);
+  uint32_t key = this->read_header(header, 0);
 
   if (key != magic_key)
     throw std :: runtime_error ("Invalid magic number, probably not a MNIST file");
 
   // read the number of files
-  nsample = this->read_header(buffer.get(), 1);
+  nsample = this->read_header(header, 1);
 
   // check the file validity
   switch (key)
   {
     case MNIST_IMAGE_MAGIC_CODE:
     {
+      if (size < 16)
+        throw std :: runtime_error ("The file is not large enough to hold the header, probably corrupted");
+
       // read the image dimensions
-      this->rows = this->read_header(buffer.get(), 2);
-      this->cols = this->read_header(buffer.get(), 3);
+      this->rows = this->read_header(header, 2);
+      this->cols = this->read_header(header, 3);
       this->channels = 1; // single channel images (aka gray-scale)
 
+      const int64_t image_size = static_cast < int64_t >(this->rows) * this->cols;
+
       // consistency check
-      if (size < nsample * this->rows * this->cols + 16)
+      if (size < nsample * image_size + 16)
         throw std :: runtime_error ("The file is not large enough to hold all the data, probably corrupted");
 
-      // read the buffer of data
-      data.reset(new uint8_t[size - 16]); // 16 is the size of the already read bytes
-      std :: move(buffer.get() + 16, buffer.get() + size - 16, data.get());
+      // view of the data after the header
+      data = buffer_view(buffer, 16, image_size, image_size); // 16 is the size of the already read bytes
 
     } break;
 
@@ -149,9 +148,8 @@ void MNIST :: load_file (const std :: string & filename, std :: unique_ptr < uin
       if (size < nsample + 8)
         throw std :: runtime_error ("The file is not large enough to hold all the data, probably corrupted");
 
-      // read the buffer of data
-      data.reset(new uint8_t[size - 8]); // 8 is the size of the already read bytes
-      std :: move(buffer.get() + 8, buffer.get() + size - 8, data.get());
+      // view of the data after the header
+      data = buffer_view(buffer, 8, 1, 1); // 8 is the size of the already read bytes
 
     } break;
   }
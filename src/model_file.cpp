@@ -0,0 +1,417 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#include <model_file.h>
+
+#include <cstring> // std :: memcpy
+#include <fstream> // std :: ofstream
+#include <type_traits> // std :: is_same
+
+#ifdef __SSE4_2__
+
+  #include <nmmintrin.h> // _mm_crc32
+
+#endif
+
+#ifndef _WIN32
+
+  #include <fcntl.h>    // open
+  #include <unistd.h>   // close
+  #include <sys/mman.h> // mmap, munmap
+  #include <sys/stat.h> // fstat
+
+#endif
+
+namespace model_file
+{
+
+uint32_t crc32c (const void * data, const int64_t & size, uint32_t crc)
+{
+  const uint8_t * buffer = static_cast < const uint8_t * >(data);
+  int64_t i = 0;
+
+  crc = ~crc;
+
+#ifdef __SSE4_2__
+
+  for (; i + 8 <= size; i += 8)
+  {
+    uint64_t word;
+    std :: memcpy(&word, buffer + i, sizeof(uint64_t));
+    crc = static_cast < uint32_t >(_mm_crc32_u64(crc, word));
+  }
+
+  for (; i < size; ++i)
+    crc = _mm_crc32_u8(crc, buffer[i]);
+
+#else
+
+  // bitwise evaluation with the reflected Castagnoli polynomial
+  for (; i < size; ++i)
+  {
+    crc ^= buffer[i];
+
+    for (int32_t j = 0; j < 8; ++j)
+      crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+  }
+
+#endif
+
+  return ~crc;
+}
+
+
+// writer
+
+writer :: writer (const bool & owning) : params (), entries (), buffers (), storage (), owning (owning)
+{
+}
+
+void writer :: add (const int32_t & id, const Eigen :: Ref < const Eigen :: MatrixXf > & matrix)
+{
+  if ( matrix.outerStride() != matrix.rows() )
+    throw std :: runtime_error("Invalid matrix found. The sections must be contiguous");
+
+  section_entry entry {};
+  entry.id = static_cast < uint32_t >(id);
+  entry.dtype = dtype_t :: float_data;
+  entry.size = static_cast < uint64_t >(matrix.size()) * sizeof(float);
+  entry.rows = matrix.rows();
+  entry.cols = matrix.cols();
+
+  this->push(entry, matrix.data());
+}
+
+void writer :: add (const int32_t & id, const Eigen :: Ref < const Eigen :: MatrixXd > & matrix)
+{
+  if ( matrix.outerStride() != matrix.rows() )
+    throw std :: runtime_error("Invalid matrix found. The sections must be contiguous");
+
+  section_entry entry {};
+  entry.id = static_cast < uint32_t >(id);
+  entry.dtype = dtype_t :: double_data;
+  entry.size = static_cast < uint64_t >(matrix.size()) * sizeof(double);
+  entry.rows = matrix.rows();
+  entry.cols = matrix.cols();
+
+  this->push(entry, matrix.data());
+}
+
+void writer :: add (const int32_t & id, const int32_t * data, const int64_t & size)
+{
+  section_entry entry {};
+  entry.id = static_cast < uint32_t >(id);
+  entry.dtype = dtype_t :: int32_data;
+  entry.size = static_cast < uint64_t >(size) * sizeof(int32_t);
+  entry.rows = size;
+  entry.cols = 1;
+
+  this->push(entry, data);
+}
+
+void writer :: push (const section_entry & entry, const void * data)
+{
+  this->entries.push_back(entry);
+  this->buffers.push_back(data);
+
+  if ( this->owning )
+  {
+    const uint8_t * first = static_cast < const uint8_t * >(data);
+    // NOTE: the buffer of the inner vector is not moved by the reallocation of the outer one
+    this->storage.emplace_back(first, first + entry.size);
+    this->buffers.back() = this->storage.back().data();
+  }
+}
+
+bool writer :: is_owning () const
+{
+  return this->owning;
+}
+
+void writer :: save (const std :: string & filename) const
+{
+  // serialize the hyperparameters as "key=value" lines
+  std :: string text;
+
+  for (const auto & param : this->params)
+    text += param.first + "=" + param.second + "\n";
+
+  const auto align = [] (const uint64_t & x) -> uint64_t
+                     {
+                       return (x + alignment - 1) / alignment * alignment;
+                     };
+
+  // build the table of the sections (the hyperparameters are the first one)
+  std :: vector < section_entry > table (1 + this->entries.size());
+  std :: vector < const void * > data (table.size());
+
+  table[0] = section_entry {};
+  table[0].id = section_t :: params_section;
+  table[0].dtype = dtype_t :: text_data;
+  table[0].size = text.size();
+  table[0].rows = static_cast < int64_t >(text.size());
+  table[0].cols = 1;
+  data[0] = text.data();
+
+  for (std :: size_t i = 0; i < this->entries.size(); ++i)
+  {
+    table[i + 1] = this->entries[i];
+    data[i + 1] = this->buffers[i];
+  }
+
+  uint64_t offset = sizeof(header) + table.size() * sizeof(section_entry);
+
+  for (std :: size_t i = 0; i < table.size(); ++i)
+  {
+    table[i].offset = align(offset);
+    table[i].checksum = crc32c(data[i], table[i].size);
+    offset = table[i].offset + table[i].size;
+  }
+
+  header head {};
+  std :: memcpy(head.magic, magic, sizeof(magic));
+  head.version = format_version;
+  head.byte_order = byte_order;
+  head.num_sections = static_cast < uint32_t >(table.size());
+  head.table_checksum = crc32c(table.data(), table.size() * sizeof(section_entry));
+  head.file_size = offset;
+
+  // open the output stream file as binary
+  std :: ofstream os(filename, std :: ios :: out | std :: ios :: binary | std :: ios :: trunc);
+
+  if ( ! os )
+    throw std :: runtime_error("Unable to write the model file. Given: " + filename);
+
+  const char zeros[alignment] = {};
+
+  os.write(reinterpret_cast < const char * >(&head), sizeof(header));
+  os.write(reinterpret_cast < const char * >(table.data()), table.size() * sizeof(section_entry));
+
+  uint64_t position = sizeof(header) + table.size() * sizeof(section_entry);
+
+  for (std :: size_t i = 0; i < table.size(); ++i)
+  {
+    // pad up to the (aligned) beginning of the section
+    os.write(zeros, table[i].offset - position);
+    os.write(static_cast < const char * >(data[i]), table[i].size);
+    position = table[i].offset + table[i].size;
+  }
+
+  if ( ! os )
+    throw std :: runtime_error("Unable to write the model file. Given: " + filename);
+}
+
+
+// reader
+
+reader :: reader (const std :: string & filename, const bool & memory_map, const bool & verify) : storage (nullptr), size (0), entries (), params ()
+{
+  if ( ! utils :: file_exists(filename) )
+    throw std :: runtime_error("File not found. Given : " + filename);
+
+#ifndef _WIN32
+
+  if ( memory_map )
+  {
+    const int fd = :: open(filename.c_str(), O_RDONLY);
+
+    if ( fd < 0 )
+      throw std :: runtime_error("File not found. Given: " + filename);
+
+    struct stat info;
+
+    if ( :: fstat(fd, &info) < 0 || info.st_size < static_cast < off_t >(sizeof(header)) )
+    {
+      :: close(fd);
+      throw std :: runtime_error("Invalid model file. Given: " + filename);
+    }
+
+    const int64_t length = static_cast < int64_t >(info.st_size);
+
+    // read-only shared mapping: the pages are shared with all the processes which map the file
+    void * region = :: mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+
+    // the mapping is still valid after the file closing
+    :: close(fd);
+
+    if ( region == MAP_FAILED )
+      throw std :: runtime_error("Memory mapping failed. Given: " + filename);
+
+    this->size = length;
+    this->storage = std :: shared_ptr < uint8_t >(static_cast < uint8_t * >(region),
+                                                  [length] (uint8_t * ptr)
+                                                  {
+                                                    :: munmap(ptr, length);
+                                                  });
+  }
+
+#else
+
+  (void)memory_map;
+
+#endif // _WIN32
+
+  if ( ! this->storage )
+  {
+    std :: ifstream is(filename, std :: ios :: in | std :: ios :: binary | std :: ios :: ate);
+
+    this->size = static_cast < int64_t >(is.tellg());
+    is.seekg(0, std :: ios :: beg);
+
+    if ( this->size < static_cast < int64_t >(sizeof(header)) )
+      throw std :: runtime_error("Invalid model file. Given: " + filename);
+
+    // the heap buffer is aligned as the sections
+    uint8_t * buffer = static_cast < uint8_t * >(Eigen :: internal :: aligned_malloc(this->size));
+    this->storage = std :: shared_ptr < uint8_t >(buffer, [] (uint8_t * ptr) { Eigen :: internal :: aligned_free(ptr); });
+
+    is.read(reinterpret_cast < char * >(buffer), this->size);
+  }
+
+  // validate the header
+  header head;
+  std :: memcpy(&head, this->storage.get(), sizeof(header));
+
+  if ( std :: memcmp(head.magic, magic, sizeof(magic)) != 0 )
+    throw std :: runtime_error("Invalid model file. Wrong signature found. Given: " + filename);
+
+  if ( head.byte_order != byte_order )
+    throw std :: runtime_error("Invalid model file. The file was written with a different byte order. Given: " + filename);
+
+  if ( head.version > format_version )
+    throw std :: runtime_error("Invalid model file. Unsupported version " + std :: to_string(head.version) + ". Given: " + filename);
+
+  const int64_t table_size = static_cast < int64_t >(head.num_sections) * sizeof(section_entry);
+
+  if ( static_cast < int64_t >(head.file_size) != this->size || static_cast < int64_t >(sizeof(header)) + table_size > this->size )
+    throw std :: runtime_error("Invalid model file. Truncated file found. Given: " + filename);
+
+  const uint8_t * table = this->storage.get() + sizeof(header);
+
+  if ( crc32c(table, table_size) != head.table_checksum )
+    throw std :: runtime_error("Invalid model file. Corrupted section table. Given: " + filename);
+
+  this->entries.resize(head.num_sections);
+  std :: memcpy(this->entries.data(), table, table_size);
+
+  // validate the sections
+  for (const auto & entry : this->entries)
+  {
+    if ( entry.offset % alignment || entry.offset + entry.size > head.file_size )
+      throw std :: runtime_error("Invalid model file. Wrong section found. Given: " + filename);
+
+    // NOTE: the float and int32 elements have the same size, the double ones twice
+    const uint64_t element_size = entry.dtype == dtype_t :: double_data ? sizeof(double) : sizeof(float);
+
+    if ( entry.dtype != dtype_t :: text_data && static_cast < uint64_t >(entry.rows * entry.cols) * element_size != entry.size )
+      throw std :: runtime_error("Invalid model file. Wrong matrix shape found. Given: " + filename);
+
+    // NOTE: the hyperparameters are always verified
+    if ( (verify || entry.id == section_t :: params_section) && crc32c(this->storage.get() + entry.offset, entry.size) != entry.checksum )
+      throw std :: runtime_error("Invalid model file. Checksum mismatch in section " + std :: to_string(entry.id) + ". Given: " + filename);
+  }
+
+  // parse the hyperparameters
+  const section_entry * text = this->find(section_t :: params_section);
+
+  if ( text == nullptr )
+    throw std :: runtime_error("Invalid model file. Missing hyperparameters. Given: " + filename);
+
+  std :: istringstream is(std :: string(reinterpret_cast < const char * >(this->storage.get() + text->offset), text->size));
+  std :: string line;
+
+  while ( std :: getline(is, line) )
+  {
+    const std :: size_t pos = line.find('=');
+
+    if ( pos != std :: string :: npos )
+      this->params[line.substr(0, pos)] = line.substr(pos + 1);
+  }
+}
+
+bool reader :: is_model_file (const std :: string & filename)
+{
+  std :: ifstream is(filename, std :: ios :: in | std :: ios :: binary);
+
+  char signature[sizeof(magic)] = {};
+  is.read(signature, sizeof(magic));
+
+  return is && std :: memcmp(signature, magic, sizeof(magic)) == 0;
+}
+
+const section_entry * reader :: find (const int32_t & id) const
+{
+  for (const auto & entry : this->entries)
+    if ( entry.id == static_cast < uint32_t >(id) )
+      return &entry;
+
+  return nullptr;
+}
+
+bool reader :: has (const int32_t & id) const
+{
+  return this->find(id) != nullptr;
+}
+
+bool reader :: has (const std :: string & key) const
+{
+  return this->params.find(key) != this->params.end();
+}
+
+template < class Scalar >
+Eigen :: Map < const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > > reader :: matrix (const int32_t & id) const
+{
+  const section_entry * entry = this->find(id);
+
+  if ( entry == nullptr )
+    throw std :: runtime_error("Invalid model file. Missing section " + std :: to_string(id));
+
+  const uint32_t dtype = std :: is_same < Scalar, double > :: value ? dtype_t :: double_data : dtype_t :: float_data;
+
+  if ( entry->dtype != dtype )
+    throw std :: runtime_error("Invalid model file. The section " + std :: to_string(id) + " stores a different data type (" +
+                               std :: to_string(entry->dtype) + ") from the requested one (" + std :: to_string(dtype) + ")");
+
+  return Eigen :: Map < const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > >(
+           reinterpret_cast < const Scalar * >(this->storage.get() + entry->offset), entry->rows, entry->cols);
+}
+
+template Eigen :: Map < const Eigen :: MatrixXf > reader :: matrix < float > (const int32_t & id) const;
+template Eigen :: Map < const Eigen :: MatrixXd > reader :: matrix < double > (const int32_t & id) const;
+
+Eigen :: Map < const Eigen :: VectorXi > reader :: index_array (const int32_t & id) const
+{
+  const section_entry * entry = this->find(id);
+
+  if ( entry == nullptr || entry->dtype != dtype_t :: int32_data )
+    throw std :: runtime_error("Invalid model file. Missing section " + std :: to_string(id));
+
+  return Eigen :: Map < const Eigen :: VectorXi >(reinterpret_cast < const int32_t * >(this->storage.get() + entry->offset), entry->rows);
+}
+
+} // end namespace model_file
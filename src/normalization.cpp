@@ -0,0 +1,99 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#include <normalization.h>
+
+input_normalization :: input_normalization (float scale, float offset, bool binarize, int32_t threshold) :
+  scale (scale), offset (offset), binarize (binarize), threshold (threshold)
+{
+}
+
+void input_normalization :: apply (const uint8_t * x, float * out, const int32_t & n) const
+{
+  int32_t i = 0;
+
+  // NOTE: the binarization is equivalent to a (x > threshold) * 1 + 0 conversion
+  const float thr = static_cast < float >(this->threshold);
+
+#if defined __AVX512F__
+
+  const __m512 scale = _mm512_set1_ps(this->scale);
+  const __m512 offset = _mm512_set1_ps(this->offset);
+  const __m512 thr_v = _mm512_set1_ps(thr);
+  const __m512 ones = _mm512_set1_ps(1.f);
+
+  for (; i + 16 <= n; i += 16)
+  {
+    // widen 16 bytes to 16 floats
+    const __m512 v = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast < const __m128i * >(x + i))));
+
+    if (this->binarize)
+      _mm512_storeu_ps(out + i, _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(v, thr_v, _CMP_GT_OQ), ones));
+    else
+      _mm512_storeu_ps(out + i, _mm512_fmadd_ps(v, scale, offset));
+  }
+
+#elif defined __AVX2__ && defined __FMA__
+
+  const __m256 scale = _mm256_set1_ps(this->scale);
+  const __m256 offset = _mm256_set1_ps(this->offset);
+  const __m256 thr_v = _mm256_set1_ps(thr);
+  const __m256 ones = _mm256_set1_ps(1.f);
+
+  for (; i + 8 <= n; i += 8)
+  {
+    // widen 8 bytes to 8 floats
+    const __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast < const __m128i * >(x + i))));
+
+    if (this->binarize)
+      _mm256_storeu_ps(out + i, _mm256_and_ps(_mm256_cmp_ps(v, thr_v, _CMP_GT_OQ), ones));
+    else
+      _mm256_storeu_ps(out + i, _mm256_fmadd_ps(v, scale, offset));
+  }
+
+#endif
+
+  // remaining values
+  // NOTE: the fused multiply-add gives the same rounding of the SIMD lanes
+  for (; i < n; ++i)
+  {
+    const float v = static_cast < float >(x[i]);
+    out[i] = this->binarize ? static_cast < float >(v > thr) : std :: fma(v, this->scale, this->offset);
+  }
+}
+
+void input_normalization :: apply (const uint8_t * x, double * out, const int32_t & n) const
+{
+  const double thr = static_cast < double >(this->threshold);
+
+  for (int32_t i = 0; i < n; ++i)
+  {
+    const double v = static_cast < double >(x[i]);
+    out[i] = this->binarize ? static_cast < double >(v > thr) : std :: fma(v, static_cast < double >(this->scale), static_cast < double >(this->offset));
+  }
+}
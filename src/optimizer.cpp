@@ -26,33 +26,151 @@
 //
 //M*/
 
-#include <optimizer.h>
+#include <optimizer.hpp>
+#include <half.h>
 
 float update_args :: epsil = 1e-6f;
 
-update_args :: update_args () : m (), v (), type (-1),
+update_args :: update_args () : m (), v (), m_double (), v_double (), m_half (), v_half (), type (-1),
   learning_rate (0.f), momentum (0.f),
-  decay (0.f), B1 (0.f), B2 (0.f), rho (0.f)
+  decay (0.f), B1 (0.f), B2 (0.f), rho (0.f),
+  state_precision (state_precision_t :: float32)
 {
 }
 
 update_args :: update_args (const int32_t & type,
   float learning_rate, float momentum,
-  float decay, float B1, float B2, float rho) : m (), v (), type (type),
-                                                learning_rate (learning_rate), momentum (momentum),
-                                                decay (decay), B1 (B1), B2 (B2), rho (rho)
+  float decay, float B1, float B2, float rho,
+  int32_t state_precision) : m (), v (), m_double (), v_double (), m_half (), v_half (), type (type),
+                             learning_rate (learning_rate), momentum (momentum),
+                             decay (decay), B1 (B1), B2 (B2), rho (rho),
+                             state_precision (state_precision)
 {
 #ifdef DEBUG
 
   assert (type >= optimizer_t :: adam && type <= optimizer_t :: sgd);
 
 #endif
+
+  if ( state_precision < state_precision_t :: float32 || state_precision > state_precision_t :: float64 )
+    throw std :: runtime_error("Invalid state precision. Possible values are float32 (0), float16 (1), bfloat16 (2) and float64 (3)");
 }
 
 void update_args :: init_arrays (const int32_t & rows, const int32_t & cols)
 {
-  this->m = Eigen :: MatrixXf :: Zero(rows, cols);
-  this->v = Eigen :: MatrixXf :: Zero(rows, cols);
+  // release the arrays of the other precisions
+  this->m.resize(0, 0);
+  this->v.resize(0, 0);
+  this->m_double.resize(0, 0);
+  this->v_double.resize(0, 0);
+  this->m_half.clear();
+  this->v_half.clear();
+
+  switch ( this->state_precision )
+  {
+    case state_precision_t :: float32:
+    {
+      this->m = Eigen :: MatrixXf :: Zero(rows, cols);
+      this->v = Eigen :: MatrixXf :: Zero(rows, cols);
+    } break;
+    case state_precision_t :: float64:
+    {
+      this->m_double = Eigen :: MatrixXd :: Zero(rows, cols);
+      this->v_double = Eigen :: MatrixXd :: Zero(rows, cols);
+    } break;
+    default:
+    {
+      // NOTE: the zero bit pattern is +0 in both float16 and bfloat16
+      this->m_half.assign(static_cast < std :: size_t >(rows) * cols, 0);
+      this->v_half.assign(static_cast < std :: size_t >(rows) * cols, 0);
+    } break;
+  }
+}
+
+bool update_args :: has_arrays (const int32_t & rows, const int32_t & cols) const
+{
+  switch ( this->state_precision )
+  {
+    case state_precision_t :: float32: return this->m.rows() == rows && this->m.cols() == cols;
+    case state_precision_t :: float64: return this->m_double.rows() == rows && this->m_double.cols() == cols;
+    default:                           return this->num_states() == static_cast < int64_t >(rows) * cols;
+  }
+}
+
+int64_t update_args :: num_states () const
+{
+  switch ( this->state_precision )
+  {
+    case state_precision_t :: float32: return static_cast < int64_t >(this->m.size());
+    case state_precision_t :: float64: return static_cast < int64_t >(this->m_double.size());
+    default:                           return static_cast < int64_t >(this->m_half.size());
+  }
+}
+
+void update_args :: save_arrays (model_file :: writer & file) const
+{
+  if ( this->state_precision == state_precision_t :: float32 )
+  {
+    file.add(model_file :: section_t :: m_section, this->m);
+    file.add(model_file :: section_t :: v_section, this->v);
+    return;
+  }
+
+  if ( this->state_precision == state_precision_t :: float64 )
+  {
+    file.add(model_file :: section_t :: m_section, this->m_double);
+    file.add(model_file :: section_t :: v_section, this->v_double);
+    return;
+  }
+
+  if ( ! file.is_owning() )
+    throw std :: runtime_error("Invalid model file writer. The reduced precision arrays require an owning writer");
+
+  bool squared_m = false;
+  bool squared_v = false;
+  this->squared_arrays(squared_m, squared_v);
+
+  const int32_t size = static_cast < int32_t >(this->m_half.size());
+  Eigen :: MatrixXf buffer (size, 1);
+
+  update_args :: load_state(this->m_half.data(), buffer.data(), size, this->array_precision(squared_m));
+  file.add(model_file :: section_t :: m_section, buffer);
+
+  update_args :: load_state(this->v_half.data(), buffer.data(), size, this->array_precision(squared_v));
+  file.add(model_file :: section_t :: v_section, buffer);
+}
+
+void update_args :: load_arrays (const model_file :: reader & file)
+{
+  if ( this->state_precision == state_precision_t :: float64 )
+  {
+    this->m_double = file.matrix < double >(model_file :: section_t :: m_section);
+    this->v_double = file.matrix < double >(model_file :: section_t :: v_section);
+    return;
+  }
+
+  const auto m = file.matrix(model_file :: section_t :: m_section);
+  const auto v = file.matrix(model_file :: section_t :: v_section);
+
+  if ( this->state_precision == state_precision_t :: float32 )
+  {
+    this->m = m;
+    this->v = v;
+    return;
+  }
+
+  // NOTE: the shape of the reduced precision arrays is given by the weights
+  const int32_t size = static_cast < int32_t >(m.size());
+
+  this->m_half.resize(size);
+  this->v_half.resize(size);
+
+  bool squared_m = false;
+  bool squared_v = false;
+  this->squared_arrays(squared_m, squared_v);
+
+  update_args :: store_state(m.data(), this->m_half.data(), size, this->array_precision(squared_m));
+  update_args :: store_state(v.data(), this->v_half.data(), size, this->array_precision(squared_v));
 }
 
 update_args & update_args :: operator = (const update_args & args)
@@ -65,104 +183,156 @@ update_args & update_args :: operator = (const update_args & args)
   this->B1 = args.B1;
   this->B2 = args.B2;
   this->rho = args.rho;
+  this->state_precision = args.state_precision;
 
   this->m = args.m;
+  this->v = args.v;
+  this->m_double = args.m_double;
+  this->v_double = args.v_double;
+  this->m_half = args.m_half;
+  this->v_half = args.v_half;
 
   return *this;
 }
 
 update_args :: update_args (const update_args & args) : type (args.type), learning_rate (args.learning_rate),
                                                         momentum (args.momentum), decay (args.decay),
-                                                        B1 (args.B1), B2 (args.B2), rho (args.rho)
+                                                        B1 (args.B1), B2 (args.B2), rho (args.rho),
+                                                        state_precision (args.state_precision)
 {
   this->m = args.m;
   this->v = args.v;
+  this->m_double = args.m_double;
+  this->v_double = args.v_double;
+  this->m_half = args.m_half;
+  this->v_half = args.v_half;
 }
 
-void update_args :: update ( const int32_t & iteration, Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update )
+template < class Scalar >
+void update_args :: update ( const int32_t & iteration, Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights,
+  const Eigen :: Matrix < Scalar, Eigen :: Dynamic, Eigen :: Dynamic > & weights_update, const int32_t & n_threads )
 {
-
-  if ( this->m.size() != weights.size() )
-    throw std :: runtime_error("Invalid number of weights found. Given " + std :: to_string(weights.size()) + ". Aspected " + std :: to_string(this->m.size()));
-
+  // dispatch the runtime type to the (pre-instantiated) policy kernels
   switch ( this->type )
   {
-    case optimizer_t :: adam:              adam_update(iteration, weights, weights_update);
+    case optimizer_t :: adam:              this->update < optimizer :: Adam, Scalar >(iteration, weights, weights_update, n_threads);
     break;
-    case optimizer_t :: momentum:          momentum_update(weights, weights_update);
+    case optimizer_t :: momentum:          this->update < optimizer :: Momentum, Scalar >(iteration, weights, weights_update, n_threads);
     break;
-    case optimizer_t :: nesterov_momentum: nesterov_momentum_update(weights, weights_update);
+    case optimizer_t :: nesterov_momentum: this->update < optimizer :: NesterovMomentum, Scalar >(iteration, weights, weights_update, n_threads);
     break;
-    case optimizer_t :: adagrad:           adagrad_update(weights, weights_update);
+    case optimizer_t :: adagrad:           this->update < optimizer :: AdaGrad, Scalar >(iteration, weights, weights_update, n_threads);
     break;
-    case optimizer_t :: rmsprop:           rmsprop_update(weights, weights_update);
+    case optimizer_t :: rmsprop:           this->update < optimizer :: RMSProp, Scalar >(iteration, weights, weights_update, n_threads);
     break;
-    case optimizer_t :: adadelta:          adadelta_update(weights, weights_update);
+    case optimizer_t :: adadelta:          this->update < optimizer :: AdaDelta, Scalar >(iteration, weights, weights_update, n_threads);
     break;
-    case optimizer_t :: adamax:            adamax_update(iteration, weights, weights_update);
+    case optimizer_t :: adamax:            this->update < optimizer :: AdaMax, Scalar >(iteration, weights, weights_update, n_threads);
     break;
-    case optimizer_t :: sgd:               sgd_update(weights, weights_update);
+    case optimizer_t :: sgd:               this->update < optimizer :: SGD, Scalar >(iteration, weights, weights_update, n_threads);
+    break;
+    default:                               this->decay_learning_rate(iteration);
     break;
-
   }
-
-  this->learning_rate *= 1.f / (this->decay * iteration + 1.f);
-  this->learning_rate  = this->learning_rate < 0.f ? 0.f : this->learning_rate;
 }
 
-void update_args :: adam_update (const int32_t & iteration, Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
+// NOTE: the template arguments are deduced, since the explicit ones would also match the policy kernel
+template void update_args :: update ( const int32_t & iteration, Eigen :: MatrixXf & weights,
+  const Eigen :: MatrixXf & weights_update, const int32_t & n_threads );
+template void update_args :: update ( const int32_t & iteration, Eigen :: MatrixXd & weights,
+  const Eigen :: MatrixXd & weights_update, const int32_t & n_threads );
+
+int32_t update_args :: nbytes_per_weight (const int32_t & scalar_size) const
 {
-  const float a_t = this->learning_rate * math :: sqrt(1.f - math :: pow(this->B2, iteration)) / (1.f - math :: pow(this->B1, iteration));
+  int32_t num_arrays = 0;
 
-  this->m = this->m * this->B1 + (1.f - this->B1) * weights_update;
-  this->v = this->v * this->B2 + (1.f - this->B2) * weights_update.cwiseProduct(weights_update);
+  switch ( this->type )
+  {
+    case optimizer_t :: adam:              num_arrays = optimizer :: Adam :: use_m + optimizer :: Adam :: use_v;
+    break;
+    case optimizer_t :: momentum:          num_arrays = optimizer :: Momentum :: use_m + optimizer :: Momentum :: use_v;
+    break;
+    case optimizer_t :: nesterov_momentum: num_arrays = optimizer :: NesterovMomentum :: use_m + optimizer :: NesterovMomentum :: use_v;
+    break;
+    case optimizer_t :: adagrad:           num_arrays = optimizer :: AdaGrad :: use_m + optimizer :: AdaGrad :: use_v;
+    break;
+    case optimizer_t :: rmsprop:           num_arrays = optimizer :: RMSProp :: use_m + optimizer :: RMSProp :: use_v;
+    break;
+    case optimizer_t :: adadelta:          num_arrays = optimizer :: AdaDelta :: use_m + optimizer :: AdaDelta :: use_v;
+    break;
+    case optimizer_t :: adamax:            num_arrays = optimizer :: AdaMax :: use_m + optimizer :: AdaMax :: use_v;
+    break;
+    default:                               num_arrays = optimizer :: SGD :: use_m + optimizer :: SGD :: use_v;
+    break;
+  }
 
-  weights = weights.array() - a_t * this->m.array() / (this->v.cwiseSqrt().array() + update_args :: epsil);
-}
+  int32_t state_size = sizeof(uint16_t);
 
+  switch ( this->state_precision )
+  {
+    case state_precision_t :: float32: state_size = sizeof(float);
+    break;
+    case state_precision_t :: float64: state_size = sizeof(double);
+    break;
+    default:                           state_size = sizeof(uint16_t);
+    break;
+  }
 
-void update_args :: sgd_update (Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
-{
-  weights = weights - this->learning_rate * weights_update;
+  // weights (read/write) + weights update (read) + supporting arrays (read/write)
+  return 3 * scalar_size + 2 * num_arrays * state_size;
 }
 
-void update_args :: momentum_update (Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
+void update_args :: decay_learning_rate ( const int32_t & iteration )
 {
-  this->v = this->momentum * this->v - this->learning_rate * weights_update;
-  weights = weights + this->v;
+  this->learning_rate *= 1.f / (this->decay * iteration + 1.f);
+  this->learning_rate  = this->learning_rate < 0.f ? 0.f : this->learning_rate;
 }
 
-void update_args :: nesterov_momentum_update (Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
+int32_t update_args :: array_precision ( const bool & squared ) const
 {
-  this->v = this->momentum * this->v - this->learning_rate * weights_update;
-  weights = weights + this->momentum * this->v - this->learning_rate * weights_update;
-}
+  // NOTE: the float16 format flushes to zero the values lower than ~6e-8,
+  // while the bfloat16 one has the same (exponent) range of the float
+  if ( squared && this->state_precision == state_precision_t :: float16 )
+    return state_precision_t :: bfloat16;
 
-void update_args :: adagrad_update (Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
-{
-  this->v = weights_update.cwiseProduct(weights_update);
-  weights = weights.array() - this->learning_rate * weights_update.array() / (this->v.cwiseSqrt().array() + update_args :: epsil);
+  return this->state_precision;
 }
 
-void update_args :: rmsprop_update (Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
+void update_args :: squared_arrays ( bool & squared_m, bool & squared_v ) const
 {
-  this->v = this->rho * this->v + (1.f - this->rho) * weights_update.cwiseProduct(weights_update);
-  weights = weights.array() - this->learning_rate * weights_update.array() / (this->v.cwiseSqrt().array() + update_args :: epsil);
+  switch ( this->type )
+  {
+    case optimizer_t :: adam:              squared_m = optimizer :: Adam :: squared_m;             squared_v = optimizer :: Adam :: squared_v;
+    break;
+    case optimizer_t :: momentum:          squared_m = optimizer :: Momentum :: squared_m;         squared_v = optimizer :: Momentum :: squared_v;
+    break;
+    case optimizer_t :: nesterov_momentum: squared_m = optimizer :: NesterovMomentum :: squared_m; squared_v = optimizer :: NesterovMomentum :: squared_v;
+    break;
+    case optimizer_t :: adagrad:           squared_m = optimizer :: AdaGrad :: squared_m;          squared_v = optimizer :: AdaGrad :: squared_v;
+    break;
+    case optimizer_t :: rmsprop:           squared_m = optimizer :: RMSProp :: squared_m;          squared_v = optimizer :: RMSProp :: squared_v;
+    break;
+    case optimizer_t :: adadelta:          squared_m = optimizer :: AdaDelta :: squared_m;         squared_v = optimizer :: AdaDelta :: squared_v;
+    break;
+    case optimizer_t :: adamax:            squared_m = optimizer :: AdaMax :: squared_m;           squared_v = optimizer :: AdaMax :: squared_v;
+    break;
+    default:                               squared_m = optimizer :: SGD :: squared_m;              squared_v = optimizer :: SGD :: squared_v;
+    break;
+  }
 }
 
-void update_args :: adadelta_update (Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
+void update_args :: load_state (const uint16_t * x, float * out, const int32_t & n, const int32_t & format)
 {
-  this->v = this->rho * this->v + (1.f - this->rho) * weights_update.cwiseProduct(weights_update);
-  Eigen :: MatrixXf update = weights_update.array() * ( this->m.cwiseSqrt().array() + update_args :: epsil) / (this->v.cwiseSqrt().array() + update_args :: epsil);
-  weights = weights - this->learning_rate * update;
-  this->m = this->rho * this->m + (1.f - this->rho) * update.cwiseProduct(update);
+  if ( format == state_precision_t :: float16 )
+    precision :: fp16_to_float(x, out, n);
+  else
+    precision :: bf16_to_float(x, out, n);
 }
 
-void update_args :: adamax_update (const int32_t & iteration, Eigen :: MatrixXf & weights, const Eigen :: MatrixXf & weights_update)
+void update_args :: store_state (const float * x, uint16_t * out, const int32_t & n, const int32_t & format)
 {
-  const float a_t = this->learning_rate / (1.f - math :: pow(this->B1, iteration));
-
-  this->m = this->m * this->B1 + (1.f - this->B1) * weights_update;
-  this->v = weights_update.cwiseAbs().cwiseMax(this->B2 * this->v);
-  weights = weights.array() - a_t * this->m.array() / (this->v.array() + update_args :: epsil);
+  if ( format == state_precision_t :: float16 )
+    precision :: float_to_fp16(x, out, n);
+  else
+    precision :: float_to_bf16(x, out, n);
 }
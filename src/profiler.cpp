@@ -0,0 +1,173 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#include <profiler.h>
+
+#include <fstream>   // std :: ofstream
+#include <stdexcept> // std :: runtime_error
+
+training_profiler :: training_profiler () : records (), flops (), bytes ()
+{
+  this->flops.fill(0.);
+  this->bytes.fill(0.);
+}
+
+void training_profiler :: start (const std :: array < double, num_stages > & flops, const std :: array < double, num_stages > & bytes)
+{
+  this->set_costs(flops, bytes);
+  this->records.clear();
+}
+
+void training_profiler :: set_costs (const std :: array < double, num_stages > & flops, const std :: array < double, num_stages > & bytes)
+{
+  this->flops = flops;
+  this->bytes = bytes;
+}
+
+void training_profiler :: begin_batch (const int32_t & epoch, const int32_t & batch)
+{
+  record rec;
+  rec.epoch = epoch;
+  rec.batch = batch;
+  rec.seconds.fill(0.);
+
+  this->records.push_back(rec);
+}
+
+void training_profiler :: add (const int32_t & stage, const double & seconds)
+{
+  // NOTE: the stages outside a batch (e.g. a direct call) are ignored
+  if ( ! this->records.empty() )
+    this->records.back().seconds[stage] += seconds;
+}
+
+void training_profiler :: clear ()
+{
+  this->records.clear();
+}
+
+const std :: vector < training_profiler :: record > & training_profiler :: get_records () const
+{
+  return this->records;
+}
+
+double training_profiler :: total (const int32_t & stage) const
+{
+  double seconds = 0.;
+
+  for (const auto & rec : this->records)
+    seconds += rec.seconds[stage];
+
+  return seconds;
+}
+
+double training_profiler :: gflops (const int32_t & stage) const
+{
+  const double seconds = this->total(stage);
+  return seconds > 0. ? this->flops[stage] * this->records.size() / seconds * 1e-9 : 0.;
+}
+
+double training_profiler :: bandwidth (const int32_t & stage) const
+{
+  const double seconds = this->total(stage);
+  return seconds > 0. ? this->bytes[stage] * this->records.size() / seconds * 1e-9 : 0.;
+}
+
+std :: string training_profiler :: stage_name (const int32_t & stage)
+{
+  switch ( stage )
+  {
+    case stage_t :: gather_stage:         return "gather";
+    case stage_t :: forward_update_stage: return "forward_update";
+    case stage_t :: predict_stage:        return "predict";
+    case stage_t :: weights_update_stage: return "weights_update";
+    case stage_t :: decay_stage:          return "decay";
+    case stage_t :: optimizer_stage:      return "optimizer";
+    case stage_t :: callback_stage:       return "callback";
+    default:                              return "unknown";
+  }
+}
+
+void training_profiler :: save_json (const std :: string & filename) const
+{
+  std :: ofstream os (filename);
+
+  if ( ! os )
+    throw std :: runtime_error("Profiler error. Cannot write the file " + filename);
+
+  os.precision(9);
+
+  os << "{\n  \"stages\": {\n";
+
+  for (int32_t s = 0; s < num_stages; ++s)
+    os << "    \"" << stage_name(s) << "\": {"
+       << "\"flops_per_batch\": " << this->flops[s] << ", "
+       << "\"bytes_per_batch\": " << this->bytes[s] << ", "
+       << "\"seconds\": " << this->total(s) << ", "
+       << "\"gflops\": " << this->gflops(s) << ", "
+       << "\"gbytes_per_second\": " << this->bandwidth(s) << "}"
+       << (s + 1 < num_stages ? ",\n" : "\n");
+
+  os << "  },\n  \"batches\": [\n";
+
+  for (std :: size_t i = 0; i < this->records.size(); ++i)
+  {
+    const record & rec = this->records[i];
+
+    os << "    {\"epoch\": " << rec.epoch << ", \"batch\": " << rec.batch << ", \"seconds\": [";
+
+    for (int32_t s = 0; s < num_stages; ++s)
+      os << rec.seconds[s] << (s + 1 < num_stages ? ", " : "");
+
+    os << "]}" << (i + 1 < this->records.size() ? ",\n" : "\n");
+  }
+
+  os << "  ]\n}\n";
+}
+
+void training_profiler :: save_csv (const std :: string & filename) const
+{
+  std :: ofstream os (filename);
+
+  if ( ! os )
+    throw std :: runtime_error("Profiler error. Cannot write the file " + filename);
+
+  os.precision(9);
+
+  os << "epoch,batch,stage,seconds,gflops,gbytes_per_second\n";
+
+  for (const auto & rec : this->records)
+    for (int32_t s = 0; s < num_stages; ++s)
+    {
+      const double seconds = rec.seconds[s];
+
+      os << rec.epoch << ',' << rec.batch << ',' << stage_name(s) << ',' << seconds << ','
+         << (seconds > 0. ? this->flops[s] / seconds * 1e-9 : 0.) << ','
+         << (seconds > 0. ? this->bytes[s] / seconds * 1e-9 : 0.) << '\n';
+    }
+}
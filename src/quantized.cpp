@@ -0,0 +1,440 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+#include <quantized.h>
+#include <half.h>
+
+#include <cmath>     // std :: nearbyint
+#include <stdexcept> // std :: runtime_error
+#include <algorithm> // std :: min, std :: max
+
+#ifdef _OPENMP
+
+  #include <omp.h>
+
+#endif
+
+namespace
+{
+
+/**
+* @brief Dot product between a uint8 sample and a int8 row of weights.
+*
+*/
+inline int32_t dot_u8s8 (const uint8_t * u, const int8_t * w, const int32_t & n)
+{
+  int32_t j = 0;
+  int32_t res = 0;
+
+#if defined __AVX2__
+
+  __m256i acc = _mm256_setzero_si256();
+
+  // widen 16 values to int16 (no saturation) and accumulate the pairwise products in int32
+  for (; j + 16 <= n; j += 16)
+  {
+    const __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast < const __m128i * >(u + j)));
+    const __m256i y = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast < const __m128i * >(w + j)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, y));
+  }
+
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  sum = _mm_hadd_epi32(sum, sum);
+  sum = _mm_hadd_epi32(sum, sum);
+  res = _mm_cvtsi128_si32(sum);
+
+#endif
+
+  for (; j < n; ++j)
+    res += static_cast < int32_t >(u[j]) * static_cast < int32_t >(w[j]);
+
+  return res;
+}
+
+/// number of samples processed together by the kernels
+static constexpr int32_t tile_size = 4;
+
+} // end namespace
+
+
+quantized_model :: quantized_model () : type (quantization_t :: int8), outputs (0), n_features (0), ld (0),
+  qweights (), row_sums (), scales (), bweights (), batch_activation (nullptr), num_threads (1),
+  ubuf (), dots (), xbuf (), ybuf ()
+{
+}
+
+quantized_model :: quantized_model (const Eigen :: Ref < const Eigen :: MatrixXf > & weights,
+  std :: function < void(float *, const int32_t &) > batch_activation,
+  const int32_t & type, const int32_t & num_threads) : type (type),
+  outputs (static_cast < int32_t >(weights.rows())), n_features (static_cast < int32_t >(weights.cols())), ld (0),
+  qweights (), row_sums (), scales (), bweights (), batch_activation (batch_activation), num_threads (1),
+  ubuf (), dots (), xbuf (), ybuf ()
+{
+  this->set_num_threads(num_threads);
+
+  switch (type)
+  {
+    case quantization_t :: int8:
+    {
+      // pad the rows to a multiple of the (largest) SIMD register size
+      this->ld = (this->n_features + 63) / 64 * 64;
+
+      this->qweights.assign(static_cast < std :: size_t >(this->outputs) * this->ld, 0);
+      this->row_sums.assign(this->outputs, 0);
+      this->scales.assign(this->outputs, 1.f);
+
+      for (int32_t i = 0; i < this->outputs; ++i)
+      {
+        // symmetric quantization of the row in [-127, 127]
+        const float max_abs = weights.row(i).cwiseAbs().maxCoeff();
+        const float scale = max_abs > 0.f ? max_abs / 127.f : 1.f;
+        const float inv_scale = 1.f / scale;
+
+        int8_t * q = this->qweights.data() + static_cast < int64_t >(i) * this->ld;
+
+        for (int32_t j = 0; j < this->n_features; ++j)
+        {
+          const float v = std :: nearbyint(weights(i, j) * inv_scale);
+          q[j] = static_cast < int8_t >(std :: min(std :: max(v, -127.f), 127.f));
+          this->row_sums[i] += q[j];
+        }
+
+        this->scales[i] = scale;
+      }
+    } break;
+
+    case quantization_t :: bf16:
+    {
+      this->ld = (this->n_features + 15) / 16 * 16;
+
+      this->bweights.assign(static_cast < std :: size_t >(this->outputs) * this->ld, 0);
+
+      for (int32_t i = 0; i < this->outputs; ++i)
+        for (int32_t j = 0; j < this->n_features; ++j)
+          this->bweights[static_cast < int64_t >(i) * this->ld + j] = precision :: to_bf16(weights(i, j));
+    } break;
+
+    default:
+      throw std :: runtime_error("Invalid quantization type. Possible values are int8 (0) and bf16 (1)");
+  }
+
+  this->init_workspace();
+}
+
+std :: unique_ptr < float [] > quantized_model :: predict (const uint8_t * X, const int32_t & n_samples,
+  const int32_t & n_features, const int64_t & stride, const input_normalization & norm)
+{
+  std :: unique_ptr < float [] > output(new float[static_cast < int64_t >(this->outputs) * n_samples]);
+
+  this->predict_into(X, n_samples, n_features, stride, norm, output.get());
+
+  return output;
+}
+
+void quantized_model :: predict_into (const uint8_t * X, const int32_t & n_samples, const int32_t & n_features,
+  const int64_t & stride, const input_normalization & norm, float * output)
+{
+  if ( this->outputs == 0 )
+    throw std :: runtime_error("Fitted error. The quantized model is empty.\n"
+                               "Please build it from a fitted model using the quantize member.");
+
+  if ( n_features != this->n_features )
+    throw std :: runtime_error("Invalid dimensions found. The input (n_samples, n_features)"
+                               "shape is inconsistent with the number of weights (" +
+                                std :: to_string(this->outputs * this->n_features) + ")");
+
+  if ( stride < n_features )
+    throw std :: runtime_error("Invalid stride found. The distance between consecutive samples (" +
+                               std :: to_string(stride) + ") must be greater or equal than the number of features (" +
+                               std :: to_string(n_features) + ")");
+
+  // NOTE: the binarization is equivalent to a (x > threshold) * 1 + 0 conversion
+  const float scale = norm.binarize ? 1.f : norm.scale;
+  const float offset = norm.binarize ? 0.f : norm.offset;
+
+  const bool is_int8 = this->type == quantization_t :: int8;
+
+  // the samples are processed in tiles, so each row of weights is loaded once for the whole tile
+  const int32_t n_tiles = (n_samples + tile_size - 1) / tile_size;
+
+#ifdef _OPENMP
+  #pragma omp parallel num_threads (this->num_threads) if (this->num_threads > 1)
+#endif
+  {
+#ifdef _OPENMP
+    const int32_t thread = omp_get_thread_num();
+#else
+    const int32_t thread = 0;
+#endif
+
+    // per-thread buffers of the current tile (pre-allocated by init_workspace)
+    uint8_t * ubuf = is_int8 ? this->ubuf.data() + static_cast < int64_t >(thread) * tile_size * this->n_features : nullptr;
+    int32_t * dot = is_int8 ? this->dots.data() + static_cast < int64_t >(thread) * tile_size * this->outputs : nullptr;
+    float * xbuf = is_int8 ? nullptr : this->xbuf.data() + static_cast < int64_t >(thread) * tile_size * this->ld;
+    float * ybuf = is_int8 ? nullptr : this->ybuf.data() + static_cast < int64_t >(thread) * tile_size * this->outputs;
+
+    const uint8_t * u[tile_size];
+    const float * x[tile_size];
+
+#ifdef _OPENMP
+    #pragma omp for
+#endif
+    for (int32_t t = 0; t < n_tiles; ++t)
+    {
+      const int32_t first = t * tile_size;
+      const int32_t size = std :: min(tile_size, n_samples - first);
+
+      for (int32_t s = 0; s < size; ++s)
+        u[s] = X + (first + s) * stride;
+
+      if (is_int8)
+      {
+        if (norm.binarize)
+        {
+          for (int32_t s = 0; s < size; ++s)
+          {
+            uint8_t * b = ubuf + s * this->n_features;
+
+            for (int32_t j = 0; j < this->n_features; ++j)
+              b[j] = u[s][j] > norm.threshold ? 1 : 0;
+
+            u[s] = b;
+          }
+        }
+
+        // NOTE: the last sample is repeated in an incomplete tile
+        const uint8_t * last = u[size - 1];
+
+        for (int32_t s = size; s < tile_size; ++s)
+          u[s] = last;
+
+        this->dot_int8(u, dot);
+
+        // de-quantize the result folding the input normalization
+        for (int32_t s = 0; s < size; ++s)
+        {
+          float * y = output + static_cast < int64_t >(first + s) * this->outputs;
+          const int32_t * d = dot + s * this->outputs;
+
+          for (int32_t i = 0; i < this->outputs; ++i)
+            y[i] = this->scales[i] * (scale * static_cast < float >(d[i]) + offset * static_cast < float >(this->row_sums[i]));
+        }
+      }
+      else
+      {
+        // the padding of the buffer stays zero
+        for (int32_t s = 0; s < size; ++s)
+        {
+          float * b = xbuf + s * this->ld;
+          norm.apply(u[s], b, this->n_features);
+          x[s] = b;
+        }
+
+        // NOTE: the last sample is repeated in an incomplete tile
+        const float * last = x[size - 1];
+
+        for (int32_t s = size; s < tile_size; ++s)
+          x[s] = last;
+
+        this->dot_bf16(x, ybuf);
+
+        std :: copy_n(ybuf, size * this->outputs, output + static_cast < int64_t >(first) * this->outputs);
+      }
+    }
+  }
+
+  if (this->batch_activation)
+    this->batch_activation(output, this->outputs * n_samples);
+}
+
+void quantized_model :: dot_int8 (const uint8_t * const * u, int32_t * dot) const
+{
+  int32_t i = 0;
+
+#if defined __AVX512VNNI__ && defined __AVX512BW__
+
+  // mask of the last (partial) block of the samples: the padding of the weights is zero
+  // but the samples are not padded, so their loads must be masked
+  const int32_t rem = this->n_features % 64;
+  const __mmask64 tail = rem ? (~0ULL >> (64 - rem)) : ~0ULL;
+
+  // tiles of 4 rows x 4 samples share the loads of the weights and of the samples
+  for (; i + 4 <= this->outputs; i += 4)
+  {
+    const int8_t * w = this->qweights.data() + static_cast < int64_t >(i) * this->ld;
+
+    __m512i acc[4][tile_size];
+
+    for (int32_t r = 0; r < 4; ++r)
+      for (int32_t s = 0; s < tile_size; ++s)
+        acc[r][s] = _mm512_setzero_si512();
+
+    for (int32_t j = 0; j < this->n_features; j += 64)
+    {
+      const __mmask64 mask = j + 64 <= this->n_features ? ~0ULL : tail;
+
+      __m512i x[tile_size];
+
+      for (int32_t s = 0; s < tile_size; ++s)
+        x[s] = _mm512_maskz_loadu_epi8(mask, u[s] + j);
+
+      for (int32_t r = 0; r < 4; ++r)
+      {
+        const __m512i wr = _mm512_loadu_si512(w + r * this->ld + j);
+
+        // uint8 x int8 products accumulated in int32
+        for (int32_t s = 0; s < tile_size; ++s)
+          acc[r][s] = _mm512_dpbusd_epi32(acc[r][s], x[s], wr);
+      }
+    }
+
+    for (int32_t r = 0; r < 4; ++r)
+      for (int32_t s = 0; s < tile_size; ++s)
+        dot[s * this->outputs + i + r] = _mm512_reduce_add_epi32(acc[r][s]);
+  }
+
+#endif
+
+  // remaining rows
+  for (; i < this->outputs; ++i)
+    for (int32_t s = 0; s < tile_size; ++s)
+      dot[s * this->outputs + i] = dot_u8s8(u[s], this->qweights.data() + static_cast < int64_t >(i) * this->ld, this->n_features);
+}
+
+void quantized_model :: dot_bf16 (const float * const * x, float * y) const
+{
+  int32_t i = 0;
+
+#if defined __AVX512F__
+
+  // tiles of 4 rows x 4 samples: each widened row is used for the whole tile
+  for (; i + 4 <= this->outputs; i += 4)
+  {
+    const uint16_t * w = this->bweights.data() + static_cast < int64_t >(i) * this->ld;
+
+    __m512 acc[4][tile_size];
+
+    for (int32_t r = 0; r < 4; ++r)
+      for (int32_t s = 0; s < tile_size; ++s)
+        acc[r][s] = _mm512_setzero_ps();
+
+    for (int32_t j = 0; j < this->ld; j += 16)
+    {
+      __m512 v[tile_size];
+
+      for (int32_t s = 0; s < tile_size; ++s)
+        v[s] = _mm512_loadu_ps(x[s] + j);
+
+      for (int32_t r = 0; r < 4; ++r)
+      {
+        // widen the bf16 values to float (shift in the upper half)
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast < const __m256i * >(w + r * this->ld + j));
+        const __m512 wf = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(b), 16));
+
+        for (int32_t s = 0; s < tile_size; ++s)
+          acc[r][s] = _mm512_fmadd_ps(v[s], wf, acc[r][s]);
+      }
+    }
+
+    for (int32_t r = 0; r < 4; ++r)
+      for (int32_t s = 0; s < tile_size; ++s)
+        y[s * this->outputs + i + r] = _mm512_reduce_add_ps(acc[r][s]);
+  }
+
+#endif
+
+  // remaining rows
+  for (; i < this->outputs; ++i)
+  {
+    const uint16_t * w = this->bweights.data() + static_cast < int64_t >(i) * this->ld;
+
+    for (int32_t s = 0; s < tile_size; ++s)
+    {
+      float res = 0.f;
+      for (int32_t j = 0; j < this->n_features; ++j)
+        res += x[s][j] * precision :: from_bf16(w[j]);
+
+      y[s * this->outputs + i] = res;
+    }
+  }
+}
+
+Eigen :: MatrixXf quantized_model :: get_weights () const
+{
+  Eigen :: MatrixXf weights (this->outputs, this->n_features);
+
+  for (int32_t i = 0; i < this->outputs; ++i)
+    for (int32_t j = 0; j < this->n_features; ++j)
+    {
+      const int64_t idx = static_cast < int64_t >(i) * this->ld + j;
+      weights(i, j) = this->type == quantization_t :: int8 ? this->scales[i] * this->qweights[idx] : precision :: from_bf16(this->bweights[idx]);
+    }
+
+  return weights;
+}
+
+int32_t quantized_model :: get_type () const
+{
+  return this->type;
+}
+
+int64_t quantized_model :: nbytes () const
+{
+  return static_cast < int64_t >(this->qweights.size() * sizeof(int8_t) +
+                                 this->row_sums.size() * sizeof(int32_t) +
+                                 this->scales.size() * sizeof(float) +
+                                 this->bweights.size() * sizeof(uint16_t));
+}
+
+void quantized_model :: set_num_threads (const int32_t & n_threads)
+{
+  if ( n_threads < 1 )
+    throw std :: runtime_error("num_threads must be an integer bigger or equal than 1");
+
+#ifdef _OPENMP
+  this->num_threads = n_threads;
+#endif
+
+  this->init_workspace();
+}
+
+void quantized_model :: init_workspace ()
+{
+  const int64_t n_tiles = static_cast < int64_t >(this->num_threads) * tile_size;
+
+  if (this->type == quantization_t :: int8)
+  {
+    this->ubuf.resize(n_tiles * this->n_features);
+    this->dots.resize(n_tiles * this->outputs);
+  }
+  else
+  {
+    // the padding of each sample must be zero
+    this->xbuf.assign(n_tiles * this->ld, 0.f);
+    this->ybuf.resize(n_tiles * this->outputs);
+  }
+}
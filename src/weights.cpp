@@ -28,6 +28,8 @@
 
 #include <weights.h>
 
+#include <vector> // std :: vector
+
 weights_initialization :: weights_initialization () : type (-1), mu (0.f), sigma (0.f), scale (0.f)
 {
 }
@@ -79,6 +81,15 @@ void weights_initialization :: init (float * weights, const int32_t & inputs, co
   }
 }
 
+void weights_initialization :: init (double * weights, const int32_t & inputs, const int32_t & outputs)
+{
+  std :: vector < float > buffer (static_cast < std :: size_t >(inputs) * outputs);
+
+  this->init(buffer.data(), inputs, outputs);
+
+  std :: copy(buffer.begin(), buffer.end(), weights);
+}
+
 // Private members
 
 void weights_initialization :: zeros (float * weights, const int32_t & inputs, const int32_t & outputs)
@@ -1,7 +1,12 @@
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
 
-#include <bcm.h>
+#include <bcm.hpp>
+#include <inference.h>
+#include <mnist.h>
+#include <cifar10.h>
+
+#include <filesystem>
 
 
 #define PRECISION 1e-4f
@@ -23,8 +28,8 @@ TEST_CASE ( "Constructor" )
 
   BCM model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
 
-  REQUIRE (model.weights.rows() == 0);
-  REQUIRE (model.weights.cols() == 0);
+  REQUIRE (model.weights_view().rows() == 0);
+  REQUIRE (model.weights_view().cols() == 0);
 }
 
 
@@ -61,23 +66,393 @@ TEST_CASE ( "Save/Load weights" )
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
 
-  REQUIRE (model.weights.rows() == outputs);
-  REQUIRE (model.weights.cols() == num_features);
+  REQUIRE (model.weights_view().rows() == outputs);
+  REQUIRE (model.weights_view().cols() == num_features);
 
   REQUIRE_THROWS_AS (model.load_weights("dummy"), std :: runtime_error);
   REQUIRE_THROWS_WITH (model.load_weights("dummy"), "File not found. Given : dummy");
 
-  Eigen :: MatrixXf Winit = model.weights;
+  Eigen :: MatrixXf Winit = model.weights_view();
 
   model.save_weights("dummy.bin");
   model.load_weights("dummy.bin");
 
-  Eigen :: MatrixXf Wafter = model.weights;
+  Eigen :: MatrixXf Wafter = model.weights_view();
 
   REQUIRE (Winit.isApprox(Wafter, PRECISION));
 }
 
 
+TEST_CASE ( "Model file" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const float strenght = 0.1f;
+
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, transfer_t :: relu, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, 0.f, .7f, strenght);
+
+  const int32_t num_epochs = 2;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 7;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  model.fit(data, num_epochs);
+  model.save_weights("model.bin");
+
+  const Eigen :: MatrixXf expected = model.predict(data);
+
+  // the hyperparameters (and the interaction matrix) are restored by the file
+  BCM loaded(3, 1);
+  loaded.load_weights("model.bin");
+
+  REQUIRE (loaded.weights_view().isApprox(model.weights_view()));
+  REQUIRE (loaded.predict(data).isApprox(expected));
+
+  // the mapped weights are used without any copy
+  BCM mapped(3, 1);
+  mapped.load_mmap("model.bin");
+
+  REQUIRE (mapped.is_mapped());
+  REQUIRE (mapped.predict(data).isApprox(expected));
+
+  // a new save replaces the file without touching the mapped one
+  loaded.fit(data, 1);
+  loaded.save_weights("model.bin");
+
+  REQUIRE (mapped.predict(data).isApprox(expected));
+  REQUIRE ( ! utils :: file_exists("model.bin.tmp") );
+
+  model.save_weights("model.bin");
+  REQUIRE (Eigen :: Map < const Eigen :: MatrixXf >(mapped.get_weights(), outputs, num_features).isApprox(model.weights_view()));
+
+  // the sections are validated by their checksum
+  {
+    std :: fstream fs("model.bin", std :: ios :: in | std :: ios :: out | std :: ios :: binary);
+    fs.seekp(-1, std :: ios :: end);
+    fs.put(static_cast < char >(0x5a));
+  }
+
+  REQUIRE_THROWS_AS (loaded.load_weights("model.bin"), std :: runtime_error);
+  REQUIRE_NOTHROW (mapped.load_mmap("model.bin", false));
+}
+
+TEST_CASE ( "Checkpoint and resume" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const float strenght = 0.1f;
+
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, transfer_t :: relu, update_args(optimizer_t :: adam), weights_init, 3, 1e-2f, 0.f, .7f, strenght);
+  BCM checkpointed(outputs, batch_size, transfer_t :: relu, update_args(optimizer_t :: adam), weights_init, 3, 1e-2f, 0.f, .7f, strenght);
+
+  const int32_t num_epochs = 3;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 7;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  REQUIRE_THROWS_AS (checkpointed.set_checkpoint("checkpoint.bin", -1), std :: runtime_error);
+
+  model.fit(data, num_epochs);
+
+  // the last checkpoint is written in the middle of the third epoch (10th of 12 batches)
+  checkpointed.set_checkpoint("checkpoint.bin", 5, checkpoint_t :: per_batch);
+  checkpointed.fit(data, num_epochs);
+
+  REQUIRE (checkpointed.weights_view() == model.weights_view());
+
+  // a plain model file can not be resumed
+  model.save_weights("model.bin");
+
+  BCM resumed(3, 1);
+  REQUIRE_THROWS_AS (resumed.resume("model.bin"), std :: runtime_error);
+
+  // the resumed training continues with the same batches and optimizer moments
+  resumed.resume("checkpoint.bin");
+  resumed.fit(data, num_epochs);
+
+  REQUIRE (resumed.weights_view() == model.weights_view());
+}
+
+TEST_CASE ( "Partial fit" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const float strenght = 0.1f;
+
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, transfer_t :: relu, update_args(optimizer_t :: adam), weights_init, 1, 1e-2f, 0.f, .7f, strenght);
+  BCM chunked(outputs, batch_size, transfer_t :: relu, update_args(optimizer_t :: adam), weights_init, 1, 1e-2f, 0.f, .7f, strenght);
+
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 7;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  int32_t num_batches = 0;
+  model.partial_fit(data, [&](BasePlasticity *) { ++ num_batches; });
+
+  REQUIRE (num_batches == 4);
+
+  // the rows which do not fill a batch are kept for the next call
+  chunked.partial_fit(data.topRows(7));
+  const Eigen :: MatrixXf w0 = chunked.weights_view();
+
+  chunked.partial_fit(data.middleRows(7, 16));
+  REQUIRE (chunked.weights_view() != w0);
+
+  // the copies continue the training from the same state (theta and pending rows)
+  BCM copied (chunked);
+  BCM assigned (3, 1);
+  assigned = chunked;
+
+  chunked.partial_fit(data.bottomRows(num_samples - 23));
+  copied.partial_fit(data.bottomRows(num_samples - 23));
+  assigned.partial_fit(data.bottomRows(num_samples - 23));
+
+  REQUIRE (copied.weights_view() == chunked.weights_view());
+  REQUIRE (assigned.weights_view() == chunked.weights_view());
+
+  // the whole state (e.g. theta and the convergence history) is stored by the model file
+  const auto read_file = [] (const std :: string & filename)
+                         {
+                           std :: ifstream is (filename, std :: ios :: binary);
+                           return std :: string(std :: istreambuf_iterator < char >(is), std :: istreambuf_iterator < char >());
+                         };
+
+  chunked.save_weights("chunked.bin");
+  copied.save_weights("copied.bin");
+  assigned.save_weights("assigned.bin");
+
+  REQUIRE (read_file("copied.bin") == read_file("chunked.bin"));
+  REQUIRE (read_file("assigned.bin") == read_file("chunked.bin"));
+
+  // the same batches give the same model, whatever the split of the stream
+  REQUIRE (chunked.weights_view() == model.weights_view());
+
+  // the training goes on from the current state
+  const Eigen :: MatrixXf w1 = model.weights_view();
+  model.partial_fit(data);
+
+  REQUIRE (model.weights_view() != w1);
+  REQUIRE ((model.weights_view() - w1).cwiseAbs().maxCoeff() < 1.f);
+  REQUIRE_THROWS_AS (model.partial_fit(data.leftCols(3)), std :: runtime_error);
+}
+
+TEST_CASE ( "Convergence window" )
+{
+  const int32_t outputs = 5;
+  const int32_t num_steps = 60;
+  const float atol = 0.5f;
+
+  std :: uniform_real_distribution < float > random_uniform (0.f, 1.f);
+
+  // a slowly varying sequence alternates stable and unstable windows
+  std :: vector < Eigen :: ArrayXf > values (num_steps, Eigen :: ArrayXf(outputs));
+
+  for (int32_t i = 0; i < num_steps; ++i)
+    for (int32_t j = 0; j < outputs; ++j)
+      values[i](j) = (i / 10) % 2 ? random_uniform(engine) : 0.1f * random_uniform(engine);
+
+  for (const int32_t length : {1, 3, 7, 16})
+  {
+    convergence_window window;
+    window.reset(outputs, length);
+
+    int32_t num_converged = 0;
+
+    for (int32_t i = 0; i < num_steps; ++i)
+    {
+      // compare the current vector with the length previous ones
+      bool expected = i >= length;
+
+      for (int32_t k = std :: max(0, i - length); k < i && expected; ++k)
+        expected = ( (values[k] - values[i]).abs() <= atol ).all();
+
+      num_converged += window.update(values[i], atol) == expected;
+    }
+
+    REQUIRE (num_converged == num_steps);
+    REQUIRE (window.size() == length + 1);
+  }
+}
+
+TEST_CASE ( "Early stopping" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  // a large tolerance stops the training as soon as the window is full
+  BCM model(outputs, batch_size, transfer_t :: linear, optimizer, weights_init, 2, 1e3f, 0.f);
+
+  const int32_t num_epochs = 5;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 5;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  int32_t num_batches = 0;
+  model.fit(data, num_epochs, 42, [&](BasePlasticity *) { ++ num_batches; });
+
+  REQUIRE (num_batches == 3 * 4);
+
+  REQUIRE_THROWS_AS (model.set_convergence_check(2), std :: runtime_error);
+
+  num_batches = 0;
+  model.set_convergence_check(convergence_t :: batch_check);
+  model.fit(data, num_epochs, 42, [&](BasePlasticity *) { ++ num_batches; });
+
+  REQUIRE (num_batches == 3);
+
+  // the default window compares each epoch with the previous one,
+  // so a tight tolerance never stops the training
+  BCM default_model(outputs, batch_size, transfer_t :: linear, optimizer, weights_init);
+
+  num_batches = 0;
+  default_model.fit(data, num_epochs, 42, [&](BasePlasticity *) { ++ num_batches; });
+
+  REQUIRE (num_batches == num_epochs * 4);
+}
+
+TEST_CASE ( "Profiler" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+
+  update_args optimizer(optimizer_t :: adam);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, transfer_t :: relu, optimizer, weights_init, 5, 1e-2f, 0.f, .7f, 0.1f);
+
+  const int32_t num_epochs = 2;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 7;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  model.fit(data, num_epochs);
+  REQUIRE (model.get_profiler().get_records().empty());
+
+  model.set_profiling(true);
+  model.fit(data, num_epochs);
+
+  const training_profiler & profiler = model.get_profiler();
+  const auto & records = profiler.get_records();
+
+  REQUIRE (records.size() == num_epochs * 4);
+  REQUIRE (records.back().epoch == num_epochs - 1);
+  REQUIRE (records.back().batch == 3);
+
+  // the BCM model uses the fused kernel, so only the whole forward/update is recorded
+  REQUIRE (profiler.total(stage_t :: forward_update_stage) > 0.);
+  REQUIRE (profiler.total(stage_t :: optimizer_stage) > 0.);
+  REQUIRE (profiler.total(stage_t :: predict_stage) == 0.);
+  REQUIRE (profiler.gflops(stage_t :: forward_update_stage) > 0.);
+  REQUIRE (profiler.bandwidth(stage_t :: optimizer_stage) > 0.);
+
+  // the partial_fit appends its batches to the trace
+  model.partial_fit(data.topRows(2 * batch_size));
+  REQUIRE (records.size() == num_epochs * 4 + 2);
+
+  profiler.save_csv("profile.csv");
+  profiler.save_json("profile.json");
+
+  std :: ifstream csv ("profile.csv");
+  const int64_t num_lines = std :: count(std :: istreambuf_iterator < char >(csv), std :: istreambuf_iterator < char >(), '\n');
+
+  REQUIRE (num_lines == 1 + static_cast < int64_t >(records.size()) * num_stages);
+}
+
+TEST_CASE ( "Set weights" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const float strenght = 0.1f;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, transfer_t :: linear, optimizer, weights_init, 1., 1e-2f, 0.f, .7f, strenght);
+
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 7;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  model.fit(data, 1);
+
+  // the first prediction caches the effective weights (interaction matrix * weights)
+  const Eigen :: MatrixXf output = model.predict(data);
+
+  const Eigen :: MatrixXf flipped = - model.weights_view();
+  model.set_weights(flipped.data(), outputs, num_features);
+
+  REQUIRE (model.weights_view() == flipped);
+  REQUIRE (model.get_weights() == model.weights_view().data());
+
+  // the linear model gives the opposite output
+  REQUIRE ((model.predict(data) + output).cwiseAbs().maxCoeff() < PRECISION);
+
+  REQUIRE_THROWS_AS (model.set_weights(flipped.data(), outputs + 1, num_features), std :: runtime_error);
+}
+
 TEST_CASE ( "Fale prediction" )
 {
   const int32_t outputs = 10;
@@ -109,8 +484,8 @@ TEST_CASE ( "Fale prediction" )
     "Please call the fit function before using the predict member.");
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
-  REQUIRE (model.weights.rows() == outputs);
-  REQUIRE (model.weights.cols() == num_features);
+  REQUIRE (model.weights_view().rows() == outputs);
+  REQUIRE (model.weights_view().cols() == num_features);
 
   REQUIRE_THROWS_WITH (model.predict(data.get(), num_samples, num_samples),
     "Invalid dimensions found. The input (n_samples, n_features)"
@@ -147,13 +522,53 @@ TEST_CASE ( "Fit buffer" )
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
 
-  REQUIRE (model.weights.rows() == outputs);
-  REQUIRE (model.weights.cols() == num_features);
+  REQUIRE (model.weights_view().rows() == outputs);
+  REQUIRE (model.weights_view().cols() == num_features);
 
 }
 
 
-TEST_CASE ( "Predict" )
+TEST_CASE ( "Number of threads" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const int32_t activation = transfer_t :: linear;
+  const float strenght = 0.f;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
+
+  REQUIRE_THROWS_WITH (model.set_num_threads(0), "num_threads must be an integer bigger or equal than 1");
+
+  const int32_t num_epochs = 2;
+  const int32_t num_samples = batch_size * 4;
+  const int32_t num_features = 5;
+
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  BCM parallel_model = model;
+
+  model.set_num_threads(1);
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  parallel_model.set_num_threads(4);
+  parallel_model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  REQUIRE (model.weights_view().isApprox(parallel_model.weights_view(), PRECISION));
+}
+
+
+TEST_CASE ( "Fit stream" )
 {
   const int32_t outputs = 10;
   const int32_t batch_size = 10;
@@ -164,9 +579,10 @@ TEST_CASE ( "Predict" )
   weights_initialization weights_init(weights_init_t :: normal);
 
   BCM model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
+  BCM stream_model = model;
 
   const int32_t num_epochs = 1;
-  const int32_t num_samples = batch_size;
+  const int32_t num_samples = batch_size * 4;
   const int32_t num_features = 5;
 
   std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
@@ -179,13 +595,799 @@ TEST_CASE ( "Predict" )
                        return random_normal(engine);
                      });
 
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  // a single chunk with the whole dataset reproduces the fit function
+  bool end_of_stream = false;
+
+  auto source = [&] (float * chunk, const int32_t & max_rows) -> int32_t
+                {
+                  end_of_stream = ! end_of_stream;
+
+                  if ( ! end_of_stream )
+                    return 0;
+
+                  std :: copy_n(data.get(), std :: min(max_rows, num_samples) * num_features, chunk);
+                  return std :: min(max_rows, num_samples);
+                };
+
+  REQUIRE_THROWS_AS (stream_model.fit_stream(source, num_features, batch_size - 1, num_epochs), std :: runtime_error);
+
+  stream_model.fit_stream(source, num_features, num_samples, num_epochs);
+
+  REQUIRE (model.weights_view().isApprox(stream_model.weights_view(), PRECISION));
+
+  // the iteration counter (used by the optimizer and by the checkpoints) is the same of the fit
+  model.save_weights("model.bin");
+  stream_model.save_weights("stream.bin");
+
+  REQUIRE (model_file :: reader("stream.bin").get < int32_t >("iteration") == num_epochs);
+  REQUIRE (model_file :: reader("model.bin").get < int32_t >("iteration") == num_epochs);
+}
+
+
+TEST_CASE ( "Fit raw buffer" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const int32_t activation = transfer_t :: linear;
+  const float strenght = 0.f;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
+  BCM raw_model = model;
+  BCM strided_model = model;
+
+  const int32_t num_epochs = 2;
+  const int32_t num_samples = batch_size * 4;
+  const int32_t num_features = 37;
+
+  std :: unique_ptr < uint8_t[] > raw(new uint8_t[num_samples * num_features]);
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+
+  std :: uniform_int_distribution < int32_t > random_pixel (0, 255);
+
+  std :: generate_n (raw.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return static_cast < uint8_t >(random_pixel(engine));
+                     });
+
+  std :: transform (raw.get(), raw.get() + num_samples * num_features, data.get(),
+                    [](const uint8_t & x)
+                    {
+                      return static_cast < float >(x) / 255.f - .5f;
+                    });
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
+  raw_model.fit(raw.get(), num_samples, num_features, num_features, input_normalization(1.f / 255.f, -.5f), num_epochs);
 
-  float * output_ptr = model.predict(data.get(), num_samples, num_features);
-  Eigen :: Map < Eigen :: Matrix < float, outputs, num_samples, Eigen :: RowMajor > > output(output_ptr, outputs, num_samples);
+  REQUIRE (model.weights_view().isApprox(raw_model.weights_view(), PRECISION));
 
-  REQUIRE (output.rows() == outputs);
-  REQUIRE (output.cols() == num_samples);
+  // the raw prediction is converted in tiles but it must match the float one
+  auto expected = model.predict(data.get(), num_samples, num_features);
+  auto raw_output = raw_model.predict(raw.get(), num_samples, num_features, num_features, input_normalization(1.f / 255.f, -.5f));
+
+  REQUIRE (Eigen :: Map < Eigen :: MatrixXf >(raw_output.get(), outputs, num_samples).isApprox(
+           Eigen :: Map < Eigen :: MatrixXf >(expected.get(), outputs, num_samples), PRECISION));
+
+  // strided rows (e.g. the CIFAR-10 samples interleaved by the label byte)
+  const int32_t stride = num_features + 3;
+  std :: unique_ptr < uint8_t[] > strided(new uint8_t[num_samples * stride]);
+
+  for (int32_t i = 0; i < num_samples; ++i)
+  {
+    std :: copy_n(raw.get() + i * num_features, num_features, strided.get() + i * stride);
+    std :: fill_n(strided.get() + i * stride + num_features, stride - num_features, 255);
+  }
+
+  strided_model.fit(strided.get(), num_samples, num_features, stride, input_normalization(1.f / 255.f, -.5f), num_epochs);
+
+  REQUIRE (strided_model.weights_view() == raw_model.weights_view());
+
+  auto strided_output = strided_model.predict(strided.get(), num_samples, num_features, stride, input_normalization(1.f / 255.f, -.5f));
+
+  REQUIRE (std :: equal(strided_output.get(), strided_output.get() + outputs * num_samples, raw_output.get()));
+  REQUIRE_THROWS_AS (strided_model.predict(strided.get(), num_samples, num_features, num_features - 1, input_normalization()), std :: runtime_error);
+
+  // binarization of the raw values
+  std :: unique_ptr < float[] > binary(new float[num_samples * num_features]);
+  input_normalization(1.f, 0.f, true, 127).apply(raw.get(), binary.get(), num_samples * num_features);
+
+  REQUIRE (std :: equal(binary.get(), binary.get() + num_samples * num_features, raw.get(),
+                       [](const float & b, const uint8_t & x)
+                       {
+                         return b == static_cast < float >(x > 127);
+                       }));
 }
 
+TEST_CASE ( "Memory mapped datasets" )
+{
+  const std :: string tmp = std :: filesystem :: temp_directory_path().string() + "/plasticity_";
+
+  const auto write_file = [] (const std :: string & filename, const std :: vector < uint8_t > & content)
+                          {
+                            std :: ofstream os(filename, std :: ios :: out | std :: ios :: binary);
+                            os.write(reinterpret_cast < const char * >(content.data()), content.size());
+                          };
+
+  // the IDX headers are stored as big-endian 32-bit integers
+  const auto big_endian = [] (std :: vector < uint8_t > & content, const uint32_t & value)
+                          {
+                            for (int32_t shift = 24; shift >= 0; shift -= 8)
+                              content.push_back(static_cast < uint8_t >(value >> shift));
+                          };
+
+  std :: uniform_int_distribution < int32_t > random_pixel (0, 255);
+
+  // MNIST (IDX) files with 5 images of 3x4 pixels
+
+  const int32_t num_digits = 5;
+  const int32_t rows = 3;
+  const int32_t cols = 4;
+
+  std :: vector < uint8_t > digits;
+  big_endian(digits, MNIST_IMAGE_MAGIC_CODE);
+  big_endian(digits, num_digits);
+  big_endian(digits, rows);
+  big_endian(digits, cols);
+
+  std :: vector < uint8_t > digit_labels;
+  big_endian(digit_labels, MNIST_LABEL_MAGIC_CODE);
+  big_endian(digit_labels, num_digits);
+
+  for (int32_t i = 0; i < num_digits; ++i)
+  {
+    for (int32_t j = 0; j < rows * cols; ++j)
+      digits.push_back(static_cast < uint8_t >(random_pixel(engine)));
+
+    digit_labels.push_back(static_cast < uint8_t >(i % 10));
+  }
+
+  write_file(tmp + "mnist-images.idx", digits);
+  write_file(tmp + "mnist-labels.idx", digit_labels);
+
+  for (const bool memory_map : {false, true})
+  {
+    data_loader :: MNIST mnist(memory_map);
+    mnist.load_training_images(tmp + "mnist-images.idx");
+    mnist.load_training_labels(tmp + "mnist-labels.idx");
+
+    REQUIRE (mnist.num_train_sample == num_digits);
+    REQUIRE (mnist.rows == rows);
+    REQUIRE (mnist.cols == cols);
+    REQUIRE (mnist.channels == 1);
+    REQUIRE (mnist.training_images.get_stride() == rows * cols);
+    REQUIRE (mnist.training_images.is_contiguous());
+
+    for (int32_t i = 0; i < num_digits; ++i)
+    {
+      REQUIRE (std :: equal(digits.begin() + 16 + i * rows * cols, digits.begin() + 16 + (i + 1) * rows * cols,
+                            mnist.training_images.sample(i)));
+      REQUIRE (*mnist.training_labels.sample(i) == digit_labels[8 + i]);
+    }
+  }
+
+  // CIFAR-10 file with 4 records made by the label byte followed by the 32x32x3 image
+
+  const int32_t num_images = 4;
+  const int64_t image_size = 32 * 32 * 3;
+  const int64_t record_size = image_size + 1;
+
+  std :: vector < uint8_t > records(num_images * record_size);
+
+  for (int32_t i = 0; i < num_images; ++i)
+  {
+    records[i * record_size] = static_cast < uint8_t >(9 - i);
+
+    std :: generate_n(records.begin() + i * record_size + 1, image_size,
+                      [&]()
+                      {
+                        return static_cast < uint8_t >(random_pixel(engine));
+                      });
+  }
+
+  write_file(tmp + "cifar10.bin", records);
+
+  data_loader :: CIFAR10 cifar_read(false);
+  cifar_read.load_training_images(tmp + "cifar10.bin");
+  cifar_read.load_training_labels(tmp + "cifar10.bin");
+
+  data_loader :: CIFAR10 cifar_mapped(true);
+  cifar_mapped.load_training_images(tmp + "cifar10.bin");
+  cifar_mapped.load_training_labels(tmp + "cifar10.bin");
+
+  REQUIRE (cifar_read.num_train_sample == num_images);
+  REQUIRE (cifar_mapped.num_train_sample == num_images);
+
+  // the read images are compacted while the mapped ones skip the label byte
+  REQUIRE (cifar_read.training_images.get_stride() == image_size);
+  REQUIRE (cifar_read.training_images.is_contiguous());
+  REQUIRE (cifar_mapped.training_images.get_stride() == record_size);
+  REQUIRE ( ! cifar_mapped.training_images.is_contiguous());
+  REQUIRE (cifar_mapped.training_labels.get_stride() == record_size);
+
+  for (int32_t i = 0; i < num_images; ++i)
+  {
+    REQUIRE (std :: equal(records.begin() + i * record_size + 1, records.begin() + (i + 1) * record_size,
+                          cifar_read.training_images.sample(i)));
+    REQUIRE (std :: equal(cifar_read.training_images.sample(i), cifar_read.training_images.sample(i) + image_size,
+                          cifar_mapped.training_images.sample(i)));
+    REQUIRE (*cifar_read.training_labels.sample(i) == records[i * record_size]);
+    REQUIRE (*cifar_mapped.training_labels.sample(i) == records[i * record_size]);
+  }
+
+  // the model reads the strided rows as the compacted ones
+  const int32_t outputs = 3;
+
+  BCM read_model(outputs, num_images, transfer_t :: linear, update_args(optimizer_t :: sgd), weights_initialization(weights_init_t :: normal));
+  BCM mapped_model = read_model;
+
+  read_model.fit(cifar_read.training_images.get(), num_images, image_size, cifar_read.training_images.get_stride(),
+    input_normalization(1.f / 255.f), 1);
+  mapped_model.fit(cifar_mapped.training_images.get(), num_images, image_size, cifar_mapped.training_images.get_stride(),
+    input_normalization(1.f / 255.f), 1);
+
+  REQUIRE (mapped_model.weights_view() == read_model.weights_view());
+
+  std :: remove((tmp + "mnist-images.idx").c_str());
+  std :: remove((tmp + "mnist-labels.idx").c_str());
+  std :: remove((tmp + "cifar10.bin").c_str());
+}
+
+
+
+TEST_CASE ( "Predict" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const int32_t activation = transfer_t :: linear;
+  const float strenght = 0.f;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
+
+  const int32_t num_epochs = 1;
+  const int32_t num_samples = batch_size;
+  const int32_t num_features = 5;
+
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  auto output_ptr = model.predict(data.get(), num_samples, num_features);
+  Eigen :: Map < Eigen :: Matrix < float, outputs, num_samples, Eigen :: RowMajor > > output(output_ptr.get(), outputs, num_samples);
+
+  REQUIRE (output.rows() == outputs);
+  REQUIRE (output.cols() == num_samples);
+
+  // the caller-provided buffer must be filled with the same values
+  std :: unique_ptr < float[] > buffer(new float[outputs * num_samples]);
+  model.predict_into(data.get(), num_samples, num_features, buffer.get());
+
+  REQUIRE (std :: equal(buffer.get(), buffer.get() + outputs * num_samples, output_ptr.get()));
+}
+
+
+TEST_CASE ( "Blocked forward" )
+{
+  // enough samples to split the output in several tiles (with a remainder)
+  const int32_t outputs = 200;
+  const int32_t batch_size = 10;
+  const float strenght = 0.f;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, transfer_t :: relu, optimizer, weights_init, 1., 1e-2f, strenght);
+
+  const int32_t num_samples = 700;
+  const int32_t num_features = 13;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  model.fit(data, 1);
+
+  const Eigen :: MatrixXf output = model.predict(data);
+  const Eigen :: MatrixXf expected = (model.weights_view() * data.transpose()).cwiseMax(0.f);
+
+  REQUIRE (output.rows() == outputs);
+  REQUIRE (output.cols() == num_samples);
+  REQUIRE ((output - expected).cwiseAbs().maxCoeff() < PRECISION);
+}
+
+TEST_CASE ( "Blocked forward with row blocks" )
+{
+  // enough units and samples to split the output in several blocks of rows and tiles (with a remainder)
+  const int32_t outputs = 300;
+  const int32_t batch_size = 600;
+  const float learning_rate = 0.02f;
+
+  update_args optimizer(optimizer_t :: sgd, learning_rate);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM init_model(outputs, batch_size, transfer_t :: relu, optimizer, weights_init, 1, 1e-2f, 0.f, 0.f, 0.f);
+  BCM model(outputs, batch_size, transfer_t :: relu, optimizer, weights_init, 1, 1e-2f, 0.f, 0.f, 0.f);
+
+  const int32_t num_samples = batch_size;
+  const int32_t num_features = 5;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  // the same initializer state provides the same initial weights
+  init_model.fit(data, 0);
+  model.fit(data, 1);
+
+  // evaluate the expected update of the BCM rule on the full output matrix
+  const Eigen :: MatrixXf w0 = init_model.weights_view();
+  const Eigen :: ArrayXXf output = (w0 * data.transpose()).cwiseMax(0.f).array();
+  const Eigen :: ArrayXf theta = output.square().rowwise().mean();
+
+  Eigen :: ArrayXXf phi = output * (output.colwise() - theta);
+  phi.colwise() /= theta + 1e-30f;
+
+  const Eigen :: MatrixXf expected = w0 + learning_rate * (phi.matrix() * data) / num_samples;
+
+  REQUIRE ((model.weights_view() - expected).cwiseAbs().maxCoeff() < PRECISION);
+}
+
+TEST_CASE ( "Inference engine" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const int32_t activation = transfer_t :: relu;
+  const float strenght = 0.f;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
+
+  REQUIRE_THROWS_AS (inference_engine(model), std :: runtime_error);
+
+  const int32_t num_epochs = 1;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 5;
+
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  auto expected = model.predict(data.get(), num_samples, num_features);
+  std :: unique_ptr < float[] > output(new float[outputs * num_samples]);
+
+  {
+    inference_engine server(model, 8, std :: chrono :: microseconds(100));
+
+    std :: vector < std :: future < void > > requests;
+
+    for (int32_t i = 0; i < num_samples; ++i)
+      requests.push_back(server.submit(data.get() + i * num_features, output.get() + i * outputs));
+
+    for (auto & r : requests)
+      r.get();
+
+    REQUIRE (server.get_num_requests() == num_samples);
+  }
+
+  REQUIRE (std :: equal(output.get(), output.get() + outputs * num_samples, expected.get(),
+                        [] (const float & a, const float & b)
+                        {
+                          return isclose(a, b);
+                        }));
+
+  // the engine serves also a model which uses the weights of a mapped file
+  model.save_weights("engine.bin");
+
+  BCM mapped(3, 1);
+  mapped.load_mmap("engine.bin");
+
+  std :: fill_n(output.get(), outputs * num_samples, 0.f);
+
+  {
+    inference_engine server(mapped, 8, std :: chrono :: microseconds(100));
+
+    std :: vector < std :: future < void > > requests;
+
+    for (int32_t i = 0; i < num_samples; ++i)
+      requests.push_back(server.submit(data.get() + i * num_features, output.get() + i * outputs));
+
+    for (auto & r : requests)
+      r.get();
+  }
+
+  REQUIRE (mapped.is_mapped());
+  REQUIRE (std :: equal(output.get(), output.get() + outputs * num_samples, expected.get(),
+                        [] (const float & a, const float & b)
+                        {
+                          return isclose(a, b);
+                        }));
+}
+
+TEST_CASE ( "Quantized model" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 6;
+  const int32_t activation = transfer_t :: linear;
+  const float strenght = 0.f;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  BCM model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
+
+  REQUIRE_THROWS_AS (model.quantize(), std :: runtime_error);
+
+  const int32_t num_epochs = 1;
+  const int32_t num_samples = 7 * batch_size;
+  const int32_t num_features = 77;
+
+  std :: unique_ptr < uint8_t[] > raw(new uint8_t[num_samples * num_features]);
+
+  std :: uniform_int_distribution < int32_t > random_pixel (0, 255);
+
+  std :: generate_n (raw.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return static_cast < uint8_t >(random_pixel(engine));
+                     });
+
+  model.fit(raw.get(), num_samples, num_features, num_features, input_normalization(1.f / 255.f), num_epochs);
+
+  // the int8 and bf16 outputs must approximate the float ones
+  // with and without the folding of the input normalization
+  for (const auto & norm : {input_normalization(1.f / 255.f, -.5f), input_normalization(1.f, 0.f, true, 127)})
+  {
+    auto expected = model.predict(raw.get(), num_samples, num_features, num_features, norm);
+    Eigen :: Map < Eigen :: MatrixXf > reference(expected.get(), outputs, num_samples);
+
+    for (const auto & type : {quantization_t :: int8, quantization_t :: bf16})
+    {
+      quantized_model qmodel = model.quantize(type);
+      auto output = qmodel.predict(raw.get(), num_samples, num_features, num_features, norm);
+
+      Eigen :: Map < Eigen :: MatrixXf > approx(output.get(), outputs, num_samples);
+
+      REQUIRE ((approx - reference).norm() / reference.norm() < (type == quantization_t :: int8 ? 2e-2f : 5e-3f));
+    }
+  }
+}
+
+TEST_CASE ( "Fused optimizers" )
+{
+  // the size is not a multiple of the block of the fused kernels, so the tail is covered
+  const int32_t rows = 7;
+  const int32_t cols = 311;
+  const int32_t num_iterations = 5;
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  Eigen :: MatrixXf initial(rows, cols);
+  std :: generate_n (initial.data(), rows * cols, [&]() { return random_normal(engine); });
+
+  std :: vector < Eigen :: MatrixXf > gradients (num_iterations, Eigen :: MatrixXf(rows, cols));
+
+  for (auto & g : gradients)
+    std :: generate_n (g.data(), rows * cols, [&]() { return 1e-1f * random_normal(engine); });
+
+  for (int32_t type = optimizer_t :: adam; type <= optimizer_t :: sgd; ++type)
+  {
+    update_args optimizer(type, 2e-2f, .9f, 1e-2f, .9f, .999f, .9f);
+    optimizer.init_arrays(rows, cols);
+
+    Eigen :: MatrixXf weights = initial;
+
+    // reference: the unfused expressions of each algorithm
+    Eigen :: MatrixXf w = initial;
+    Eigen :: MatrixXf m = Eigen :: MatrixXf :: Zero(rows, cols);
+    Eigen :: MatrixXf v = Eigen :: MatrixXf :: Zero(rows, cols);
+    float learning_rate = optimizer.learning_rate;
+
+    const float B1 = optimizer.B1;
+    const float B2 = optimizer.B2;
+    const float rho = optimizer.rho;
+    const float momentum = optimizer.momentum;
+    const float epsil = update_args :: epsil;
+
+    for (int32_t iteration = 1; iteration <= num_iterations; ++iteration)
+    {
+      const Eigen :: MatrixXf & dw = gradients[iteration - 1];
+
+      optimizer.update(iteration, weights, dw, 2);
+
+      switch (type)
+      {
+        case optimizer_t :: adam:
+        {
+          const float a_t = learning_rate * math :: sqrt(1.f - math :: pow(B2, iteration)) / (1.f - math :: pow(B1, iteration));
+          m = m * B1 + (1.f - B1) * dw;
+          v = v * B2 + (1.f - B2) * dw.cwiseProduct(dw);
+          w = w.array() - a_t * m.array() / (v.cwiseSqrt().array() + epsil);
+        } break;
+        case optimizer_t :: momentum:
+        {
+          v = momentum * v - learning_rate * dw;
+          w = w + v;
+        } break;
+        case optimizer_t :: nesterov_momentum:
+        {
+          v = momentum * v - learning_rate * dw;
+          w = w + momentum * v - learning_rate * dw;
+        } break;
+        case optimizer_t :: adagrad:
+        {
+          v = dw.cwiseProduct(dw);
+          w = w.array() - learning_rate * dw.array() / (v.cwiseSqrt().array() + epsil);
+        } break;
+        case optimizer_t :: rmsprop:
+        {
+          v = rho * v + (1.f - rho) * dw.cwiseProduct(dw);
+          w = w.array() - learning_rate * dw.array() / (v.cwiseSqrt().array() + epsil);
+        } break;
+        case optimizer_t :: adadelta:
+        {
+          v = rho * v + (1.f - rho) * dw.cwiseProduct(dw);
+          const Eigen :: MatrixXf update = dw.array() * (m.cwiseSqrt().array() + epsil) / (v.cwiseSqrt().array() + epsil);
+          w = w - learning_rate * update;
+          m = rho * m + (1.f - rho) * update.cwiseProduct(update);
+        } break;
+        case optimizer_t :: adamax:
+        {
+          const float a_t = learning_rate / (1.f - math :: pow(B1, iteration));
+          m = m * B1 + (1.f - B1) * dw;
+          v = dw.cwiseAbs().cwiseMax(B2 * v);
+          w = w.array() - a_t * m.array() / (v.array() + epsil);
+        } break;
+        default:
+        {
+          w = w - learning_rate * dw;
+        } break;
+      }
+
+      // learning rate decay
+      learning_rate *= 1.f / (optimizer.decay * iteration + 1.f);
+      learning_rate  = learning_rate < 0.f ? 0.f : learning_rate;
+
+      REQUIRE (optimizer.learning_rate == Approx(learning_rate));
+    }
+
+    REQUIRE ((weights - w).norm() / (w - initial).norm() < 1e-4f);
+  }
+}
+
+TEST_CASE ( "Reduced precision optimizer state" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const int32_t activation = transfer_t :: linear;
+  const float strenght = 0.f;
+
+  REQUIRE_THROWS_AS (update_args(optimizer_t :: adam, 2e-2f, .9f, 1e-4f, .9f, .999f, 0.f, 4), std :: runtime_error);
+
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  const int32_t num_epochs = 3;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 37;
+
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  BCM model(outputs, batch_size, activation, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, strenght);
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  // the float computations with 16 bit storage must follow the float32 training
+  for (const auto & state : {state_precision_t :: float16, state_precision_t :: bfloat16})
+  {
+    update_args optimizer(optimizer_t :: adam, 0.02f, .9f, 1e-4f, .9f, .999f, 0.f, state);
+    BCM half_model(outputs, batch_size, activation, optimizer, weights_init, 1., 1e-2f, strenght);
+
+    half_model.fit(data.get(), num_samples, num_features, num_epochs);
+
+    REQUIRE ((half_model.weights_view() - model.weights_view()).norm() / model.weights_view().norm() < 5e-2f);
+  }
+
+  // the second moment of the small gradients is lower than the float16 range:
+  // it must not be flushed to zero (i.e. the step must not be inflated by 1/epsil)
+  const Eigen :: MatrixXf gradient = Eigen :: MatrixXf :: Constant(outputs, num_features, 1e-3f);
+  Eigen :: MatrixXf reference = Eigen :: MatrixXf :: Zero(outputs, num_features);
+  Eigen :: MatrixXf reduced = reference;
+
+  update_args adam(optimizer_t :: adam, 0.02f, .9f, 0.f);
+  update_args half_adam(optimizer_t :: adam, 0.02f, .9f, 0.f, .9f, .999f, 0.f, state_precision_t :: float16);
+
+  adam.init_arrays(outputs, num_features);
+  half_adam.init_arrays(outputs, num_features);
+
+  for (int32_t iteration = 1; iteration <= 3; ++iteration)
+  {
+    adam.update(iteration, reference, gradient);
+    half_adam.update(iteration, reduced, gradient);
+  }
+
+  REQUIRE ((reduced - reference).norm() / reference.norm() < 1e-2f);
+}
+
+
+TEST_CASE ( "Compile-time specialized model" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const float strenght = 0.f;
+
+  using model_t = BCMModel < transfer :: Relu, optimizer :: Adam >;
+
+  REQUIRE_THROWS_AS (model_t(outputs, batch_size, update_args(optimizer_t :: sgd)), std :: runtime_error);
+
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  const int32_t num_epochs = 3;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 37;
+
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  BCM model(outputs, batch_size, transfer_t :: relu, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, strenght);
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  model_t spec_model(outputs, batch_size, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, strenght);
+  spec_model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  // the specialized kernels must follow the runtime dispatch
+  REQUIRE ((spec_model.weights_view() - model.weights_view()).norm() / model.weights_view().norm() < PRECISION);
+
+  std :: unique_ptr < float[] > y = model.predict(data.get(), num_samples, num_features);
+  std :: unique_ptr < float[] > spec_y = spec_model.predict(data.get(), num_samples, num_features);
+
+  REQUIRE (std :: equal(y.get(), y.get() + num_samples * outputs, spec_y.get(),
+                        [](const float & a, const float & b)
+                        {
+                          return isclose(a, b);
+                        }));
+
+  // the loaded state must match the policies of the model
+  model.save_weights("model.bin");
+  REQUIRE_NOTHROW (spec_model.load_weights("model.bin"));
+  REQUIRE (spec_model.weights_view() == model.weights_view());
+
+  BCM sgd_model(outputs, batch_size, transfer_t :: relu, update_args(optimizer_t :: sgd), weights_init, 1., 1e-2f, strenght);
+  sgd_model.fit(data.get(), num_samples, num_features, 1);
+  sgd_model.save_weights("sgd_model.bin");
+
+  REQUIRE_THROWS_AS (spec_model.load_weights("sgd_model.bin"), std :: runtime_error);
+  REQUIRE_THROWS_AS (spec_model.load_mmap("sgd_model.bin"), std :: runtime_error);
+  REQUIRE (spec_model.weights_view() == model.weights_view());
+
+  BCM linear_model(outputs, batch_size, transfer_t :: linear, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, strenght);
+  linear_model.fit(data.get(), num_samples, num_features, 1);
+  linear_model.save_weights("linear_model.bin");
+
+  REQUIRE_THROWS_AS (spec_model.load_weights("linear_model.bin"), std :: runtime_error);
+}
+
+
+TEST_CASE ( "Double precision model" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const float strenght = 0.f;
+
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  const int32_t num_epochs = 3;
+  const int32_t num_samples = 4 * batch_size;
+  const int32_t num_features = 37;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  const Eigen :: MatrixXd data_d = data.cast < double >();
+
+  BCM model(outputs, batch_size, transfer_t :: logistic, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, strenght);
+  model.fit(data, num_epochs);
+
+  // the double model starts from the same weights, so it must follow the float training
+  BCM_ < double > model_d(outputs, batch_size, transfer_t :: logistic, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, strenght);
+  model_d.fit(data_d, num_epochs);
+
+  const Eigen :: MatrixXd weights = model.weights_view().cast < double >();
+
+  REQUIRE ((model_d.weights_view() - weights).norm() / weights.norm() < 1e-3);
+  REQUIRE ((model_d.predict(data_d) - model.predict(data).cast < double >()).cwiseAbs().maxCoeff() < 1e-3);
+
+  // the double moments (float64 state) must follow the float ones
+  update_args optimizer(optimizer_t :: adam, 0.02f, .9f, 1e-4f, .9f, .999f, 0.f, state_precision_t :: float64);
+  BCM_ < double > state_model(outputs, batch_size, transfer_t :: logistic, optimizer, weights_init, 1., 1e-2f, strenght);
+  state_model.fit(data_d, num_epochs);
+
+  REQUIRE ((state_model.weights_view() - model_d.weights_view()).norm() / model_d.weights_view().norm() < 1e-3);
+  REQUIRE (optimizer.nbytes_per_weight(sizeof(double)) == 3 * sizeof(double) + 4 * sizeof(double));
+
+  // the specialized kernels must follow the runtime dispatch also in double precision
+  BCMModel < transfer :: Logistic, optimizer :: Adam, double > spec_model(outputs, batch_size, update_args(optimizer_t :: adam), weights_init, 1., 1e-2f, strenght);
+  spec_model.fit(data_d, num_epochs);
+
+  REQUIRE ((spec_model.weights_view() - model_d.weights_view()).norm() / model_d.weights_view().norm() < 1e-10);
+
+  // the double sections are stored without any rounding
+  state_model.save_weights("model_d.bin");
+
+  BCM_ < double > loaded(3, 1);
+  loaded.load_weights("model_d.bin");
+
+  REQUIRE (loaded.weights_view() == state_model.weights_view());
+  REQUIRE (loaded.predict(data_d) == state_model.predict(data_d));
+
+  BCM_ < double > mapped(3, 1);
+  mapped.load_mmap("model_d.bin");
+
+  REQUIRE (mapped.is_mapped());
+  REQUIRE (mapped.weights_view() == state_model.weights_view());
+
+  // the precision of the model must match the stored one
+  BCM float_model(3, 1);
+  REQUIRE_THROWS_AS (float_model.load_weights("model_d.bin"), std :: runtime_error);
+
+  model.save_weights("model.bin");
+  REQUIRE_THROWS_AS (loaded.load_weights("model.bin"), std :: runtime_error);
+  REQUIRE (loaded.weights_view() == state_model.weights_view());
+}
@@ -21,8 +21,14 @@ TEST_CASE ( "Constructor" )
 
   Hopfield model(outputs, batch_size, optimizer, weights_init, 1., 1e-2f, 0.4f, 2.f, 2);
 
-  REQUIRE (model.weights.rows() == 0);
-  REQUIRE (model.weights.cols() == 0);
+  REQUIRE (model.weights_view().rows() == 0);
+  REQUIRE (model.weights_view().cols() == 0);
+
+  // the k-th ranked unit must be one of the outputs
+  REQUIRE_THROWS_AS (Hopfield(outputs, batch_size, optimizer, weights_init, 1, 1e-2f, 0.f, 0.4f, 2.f, 1), std :: runtime_error);
+  REQUIRE_THROWS_WITH (Hopfield(outputs, batch_size, optimizer, weights_init, 1, 1e-2f, 0.f, 0.4f, 2.f, outputs + 1),
+    "k must be an integer lower or equal than the number of outputs (" + std :: to_string(outputs) + ")");
+  REQUIRE_NOTHROW (Hopfield(outputs, batch_size, optimizer, weights_init, 1, 1e-2f, 0.f, 0.4f, 2.f, outputs));
 }
 
 
@@ -57,18 +63,18 @@ TEST_CASE ( "Save/Load weights" )
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
 
-  REQUIRE (model.weights.rows() == outputs);
-  REQUIRE (model.weights.cols() == num_features);
+  REQUIRE (model.weights_view().rows() == outputs);
+  REQUIRE (model.weights_view().cols() == num_features);
 
   REQUIRE_THROWS_AS (model.load_weights("dummy"), std :: runtime_error);
   REQUIRE_THROWS_WITH (model.load_weights("dummy"), "File not found. Given : dummy");
 
-  Eigen :: MatrixXf Winit = model.weights;
+  Eigen :: MatrixXf Winit = model.weights_view();
 
   model.save_weights("dummy.bin");
   model.load_weights("dummy.bin");
 
-  Eigen :: MatrixXf Wafter = model.weights;
+  Eigen :: MatrixXf Wafter = model.weights_view();
 
   REQUIRE (Winit.isApprox(Wafter, PRECISION));
 }
@@ -103,8 +109,8 @@ TEST_CASE ( "Fale prediction" )
     "Please call the fit function before using the predict member.");
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
-  REQUIRE (model.weights.rows() == outputs);
-  REQUIRE (model.weights.cols() == num_features);
+  REQUIRE (model.weights_view().rows() == outputs);
+  REQUIRE (model.weights_view().cols() == num_features);
 
   REQUIRE_THROWS_WITH (model.predict(data.get(), num_samples, num_samples),
     "Invalid dimensions found. The input (n_samples, n_features)"
@@ -139,12 +145,105 @@ TEST_CASE ( "Fit buffer" )
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
 
-  REQUIRE (model.weights.rows() == outputs);
-  REQUIRE (model.weights.cols() == num_features);
+  REQUIRE (model.weights_view().rows() == outputs);
+  REQUIRE (model.weights_view().cols() == num_features);
 
 }
 
 
+TEST_CASE ( "Fit with larger k" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  Hopfield model(outputs, batch_size, optimizer, weights_init, 1., 1e-2f, 0.4f, 2.f, 4);
+
+  const int32_t num_epochs = 1;
+  const int32_t num_samples = batch_size;
+  const int32_t num_features = 5;
+
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+
+  REQUIRE (model.weights_view().rows() == outputs);
+  REQUIRE (model.weights_view().cols() == num_features);
+  REQUIRE (model.weights_view().allFinite());
+}
+
+
+TEST_CASE ( "Fit with tiled ranking" )
+{
+  // enough units and samples to split the output in several tiles (with a remainder)
+  const int32_t outputs = 300;
+  const int32_t batch_size = 600;
+  const int32_t k = 3;
+  const float delta = 0.4f;
+  const float learning_rate = 0.02f;
+
+  update_args optimizer(optimizer_t :: sgd, learning_rate);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  Hopfield init_model(outputs, batch_size, optimizer, weights_init, 1, 1e-2f, 0.f, delta, 2.f, k);
+  Hopfield model(outputs, batch_size, optimizer, weights_init, 1, 1e-2f, 0.f, delta, 2.f, k);
+
+  const int32_t num_samples = batch_size;
+  const int32_t num_features = 5;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  // the same initializer state provides the same initial weights
+  init_model.fit(data, 0);
+  model.fit(data, 1);
+
+  // evaluate the expected update on the full output matrix
+  const Eigen :: MatrixXf w0 = init_model.weights_view();
+  const Eigen :: MatrixXf output = w0 * data.transpose();
+
+  Eigen :: MatrixXf weights_update = Eigen :: MatrixXf :: Zero(outputs, num_features);
+  Eigen :: VectorXf theta = Eigen :: VectorXf :: Zero(outputs);
+
+  std :: vector < int32_t > units(outputs);
+
+  for (int32_t i = 0; i < num_samples; ++i)
+  {
+    std :: iota(units.begin(), units.end(), 0);
+    std :: sort(units.begin(), units.end(), [&](const int32_t & a, const int32_t & b) { return output(a, i) > output(b, i); });
+
+    theta(units[0]) += output(units[0], i);
+    theta(units[k - 1]) -= delta * output(units[k - 1], i);
+
+    weights_update.row(units[0]) += data.row(i);
+    weights_update.row(units[k - 1]) -= delta * data.row(i);
+  }
+
+  weights_update.array() -= w0.array().colwise() * theta.array();
+  weights_update /= weights_update.cwiseAbs().maxCoeff();
+
+  const Eigen :: MatrixXf expected = w0 + learning_rate * weights_update;
+
+  REQUIRE ((model.weights_view() - expected).cwiseAbs().maxCoeff() < PRECISION);
+}
+
 TEST_CASE ( "Fit with null weights" )
 {
   const int32_t outputs = 10;
@@ -173,7 +272,88 @@ TEST_CASE ( "Fit with null weights" )
   model.fit(data.get(), num_samples, num_features, num_epochs);
 
   // The Hopfield model can work also with null initialization thanks to the Krotov approximation
-  REQUIRE ( ! model.weights.isZero(PRECISION) );
+  REQUIRE ( ! model.weights_view().isZero(PRECISION) );
+}
+
+
+TEST_CASE ( "Set weights" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  // p != 2 uses the cached normalized weights
+  Hopfield model(outputs, batch_size, optimizer, weights_init, 1, 1e-2f, 0.f, 0.4f, 3.f, 2);
+
+  const int32_t num_samples = batch_size;
+  const int32_t num_features = 5;
+
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.data(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  model.fit(data, 1);
+
+  const Eigen :: MatrixXf output = model.predict(data);
+
+  const Eigen :: MatrixXf flipped = - model.weights_view();
+  model.set_weights(flipped.data(), outputs, num_features);
+
+  // the normalization is odd, so the output is the opposite one
+  REQUIRE ((model.predict(data) + output).cwiseAbs().maxCoeff() < PRECISION);
+}
+
+
+TEST_CASE ( "Lebesgue normalization" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+  const int32_t num_samples = batch_size;
+  const int32_t num_features = 37;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  Eigen :: MatrixXf weights(outputs, num_features);
+  Eigen :: MatrixXf data(num_samples, num_features);
+
+  std :: generate_n (weights.data(), outputs * num_features, [&]() { return random_normal(engine); });
+  std :: generate_n (data.data(), num_samples * num_features, [&]() { return random_normal(engine); });
+
+  // integer (products), half-integer (products and sqrt) and generic (pow) exponents
+  for (const float p : {3.f, 4.f, 4.5f, 3.3f})
+  {
+    Hopfield model(outputs, batch_size, optimizer, weights_init, 1, 1e-2f, 0.f, 0.4f, p, 2);
+    model.set_weights(weights.data(), outputs, num_features);
+
+    // explicit formula of the normalized weights: sign(w) |w|^(p - 1)
+    const Eigen :: MatrixXf normalized = weights.unaryExpr([&](const float & w)
+                                                           {
+                                                             return std :: copysign(std :: pow(std :: fabs(w), p - 1.f), w);
+                                                           });
+
+    const Eigen :: MatrixXf expected = normalized * data.transpose();
+    const Eigen :: MatrixXf output = model.predict(data);
+
+    // NOTE: the fast pow approximation is used only for the generic exponents
+#ifdef __fast_math__
+    const float tolerance = p == 3.3f ? 1e-3f : 1e-5f;
+#else
+    const float tolerance = 1e-5f;
+#endif
+
+    REQUIRE ((output - expected).norm() / expected.norm() < tolerance);
+  }
 }
 
 
@@ -204,8 +384,8 @@ TEST_CASE ( "Predict" )
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
 
-  float * output_ptr = model.predict(data.get(), num_samples, num_features);
-  Eigen :: Map < Eigen :: Matrix < float, outputs, num_samples, Eigen :: RowMajor > > output(output_ptr, outputs, num_samples);
+  auto output_ptr = model.predict(data.get(), num_samples, num_features);
+  Eigen :: Map < Eigen :: Matrix < float, outputs, num_samples, Eigen :: RowMajor > > output(output_ptr.get(), outputs, num_samples);
 
   REQUIRE (output.rows() == outputs);
   REQUIRE (output.cols() == num_samples);
@@ -239,9 +419,56 @@ TEST_CASE ( "Predict null weights" )
 
   model.fit(data.get(), num_samples, num_features, num_epochs);
 
-  float * output_ptr = model.predict(data.get(), num_samples, num_features);
-  Eigen :: Map < Eigen :: Matrix < float, outputs, num_samples, Eigen :: RowMajor > > output(output_ptr, outputs, num_samples);
+  auto output_ptr = model.predict(data.get(), num_samples, num_features);
+  Eigen :: Map < Eigen :: Matrix < float, outputs, num_samples, Eigen :: RowMajor > > output(output_ptr.get(), outputs, num_samples);
 
   // The Hopfield model can work also with null initialization thanks to the Krotov approximation
   REQUIRE (!output.isZero(PRECISION));
 }
+
+
+TEST_CASE ( "Double precision model" )
+{
+  const int32_t outputs = 10;
+  const int32_t batch_size = 10;
+
+  update_args optimizer(optimizer_t :: sgd);
+  weights_initialization weights_init(weights_init_t :: normal);
+
+  Hopfield model(outputs, batch_size, optimizer, weights_init, 1., 1e-2f, 0.4f, 3.f, 2);
+  Hopfield_ < double > model_d(outputs, batch_size, optimizer, weights_init, 1., 1e-2f, 0.4f, 3.f, 2);
+
+  const int32_t num_epochs = 1;
+  const int32_t num_samples = batch_size;
+  const int32_t num_features = 5;
+
+  std :: unique_ptr < float[] > data(new float[num_samples * num_features]);
+  std :: unique_ptr < double[] > data_d(new double[num_samples * num_features]);
+
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: generate_n (data.get(), num_samples * num_features,
+                     [&]()
+                     {
+                       return random_normal(engine);
+                     });
+
+  std :: copy_n (data.get(), num_samples * num_features, data_d.get());
+
+  // the double model starts from the same weights, so it must follow the float training
+  model.fit(data.get(), num_samples, num_features, num_epochs);
+  model_d.fit(data_d.get(), num_samples, num_features, num_epochs);
+
+  const Eigen :: MatrixXd weights = model.weights_view().cast < double >();
+
+  REQUIRE ((model_d.weights_view() - weights).norm() / weights.norm() < 1e-3);
+
+  auto output = model.predict(data.get(), num_samples, num_features);
+  auto output_d = model_d.predict(data_d.get(), num_samples, num_features);
+
+  REQUIRE (std :: equal(output_d.get(), output_d.get() + num_samples * outputs, output.get(),
+                        [](const double & a, const float & b)
+                        {
+                          return std :: fabs(a - b) < 1e-3;
+                        }));
+}
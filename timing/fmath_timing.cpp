@@ -0,0 +1,156 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+
+#include <fmath.h>
+
+#include <vector>
+#include <random>
+#include <iomanip>
+#include <functional>
+
+/**
+* @brief Timing of the vectorized fast math functions.
+*
+* @details The script compares the span version of the fmath functions
+* against the element-wise std counterparts, reporting the relative error
+* (max and mean) and the throughput of both the implementations.
+* Remember that the approximations are enabled only if the library is
+* built with the FAST_MATH option (__fast_math__ definition).
+*
+*/
+
+static const int32_t num_values = 1 << 22; ///< number of values to evaluate
+static const int32_t num_repeat = 10;      ///< number of repetitions for the timing
+
+
+template < class Func >
+double timeit (Func func)
+{
+  // warm-up
+  func();
+
+  auto start = utils :: what_time_is_it_now();
+  for (int32_t i = 0; i < num_repeat; ++i)
+    func();
+
+  return std :: chrono :: duration < double > (utils :: what_time_is_it_now() - start).count() / num_repeat;
+}
+
+void compare (const std :: string & name, const std :: vector < float > & x,
+  std :: function < float (const float &) > reference,
+  std :: function < void (const float *, float *, const int32_t &) > approx)
+{
+  std :: vector < float > ref (x.size());
+  std :: vector < float > out (x.size());
+
+  const double t_ref = timeit([&] ()
+                              {
+                                for (std :: size_t i = 0; i < x.size(); ++i)
+                                  ref[i] = reference(x[i]);
+                              });
+  const double t_approx = timeit([&] ()
+                                 {
+                                   approx(x.data(), out.data(), static_cast < int32_t >(x.size()));
+                                 });
+
+  double max_err = 0.;
+  double mean_err = 0.;
+
+  for (std :: size_t i = 0; i < x.size(); ++i)
+  {
+    const double err = std :: fabs(static_cast < double >(out[i]) - ref[i]) / std :: max(1., std :: fabs(static_cast < double >(ref[i])));
+    max_err = std :: max(max_err, err);
+    mean_err += err;
+  }
+
+  mean_err /= x.size();
+
+  std :: cout << std :: left << std :: setw(8) << name
+            << std :: right << std :: scientific << std :: setprecision(3)
+            << std :: setw(14) << max_err
+            << std :: setw(14) << mean_err
+            << std :: fixed << std :: setprecision(1)
+            << std :: setw(14) << x.size() / t_ref * 1e-6
+            << std :: setw(14) << x.size() / t_approx * 1e-6
+            << std :: setw(10) << t_ref / t_approx << "x"
+            << std :: endl;
+}
+
+
+int main ()
+{
+  std :: mt19937 engine (42);
+  std :: uniform_real_distribution < float > signed_values (-10.f, 10.f);
+  std :: uniform_real_distribution < float > positive_values (1e-3f, 100.f);
+
+  std :: vector < float > x (num_values);
+  std :: vector < float > xp (num_values);
+
+  std :: generate(x.begin(), x.end(), [&] () { return signed_values(engine); });
+  std :: generate(xp.begin(), xp.end(), [&] () { return positive_values(engine); });
+
+#ifdef __fast_math__
+  std :: cout << "Fast math approximations: enabled" << std :: endl;
+#else
+  std :: cout << "Fast math approximations: disabled (std functions)" << std :: endl;
+#endif
+
+#if defined __AVX512F__
+  std :: cout << "Packet size: 16 (AVX-512)" << std :: endl;
+#elif defined __AVX2__
+  std :: cout << "Packet size: 8 (AVX2)" << std :: endl;
+#else
+  std :: cout << "Packet size: 1 (scalar)" << std :: endl;
+#endif
+
+  std :: cout << std :: left << std :: setw(8) << "func"
+            << std :: right
+            << std :: setw(14) << "max rel err"
+            << std :: setw(14) << "mean rel err"
+            << std :: setw(14) << "std [Mval/s]"
+            << std :: setw(14) << "fast [Mval/s]"
+            << std :: setw(11) << "speedup"
+            << std :: endl;
+
+  const float exponent = 3.5f;
+
+  compare("pow2", x, [](const float & v) { return std :: pow(2.f, v); },
+    [](const float * in, float * out, const int32_t & n) { math :: pow2(in, out, n); });
+  compare("exp", x, [](const float & v) { return std :: exp(v); },
+    [](const float * in, float * out, const int32_t & n) { math :: exp(in, out, n); });
+  compare("log2", xp, [](const float & v) { return std :: log2(v); },
+    [](const float * in, float * out, const int32_t & n) { math :: log2(in, out, n); });
+  compare("pow", xp, [&](const float & v) { return std :: pow(v, exponent); },
+    [&](const float * in, float * out, const int32_t & n) { math :: pow(in, exponent, out, n); });
+  compare("tanh", x, [](const float & v) { return std :: tanh(v); },
+    [](const float * in, float * out, const int32_t & n) { math :: tanh(in, out, n); });
+  compare("rsqrt", xp, [](const float & v) { return 1.f / std :: sqrt(v); },
+    [](const float * in, float * out, const int32_t & n) { math :: rsqrt(in, out, n); });
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+#include <bcm.h>
+#include <inference.h>
+
+#include <vector>
+#include <random>
+#include <iomanip>
+#include <algorithm>
+
+/**
+* @brief Latency and throughput of the single sample prediction.
+*
+* @details The script fits a BCM model on a random dataset and then it
+* serves single sample predictions: first by a sequential loop of predict
+* calls (one GEMV each) and then by the inference engine with an increasing
+* maximum micro-batch size, using the given number of client threads.
+* For each configuration the throughput (requests per second), the median
+* and the 99th percentile of the request latency and the average size of
+* the micro-batches are reported.
+*
+* Usage: timing_inference [n_clients] [max_latency_us]
+*
+*/
+
+static const int32_t num_samples  = 1 << 14; ///< number of requests
+static const int32_t num_features = 784;     ///< number of features of the dataset
+static const int32_t num_outputs  = 256;     ///< number of hidden units
+static const int32_t batch_size   = 1024;    ///< size of the training minibatch
+
+using timer = std :: chrono :: steady_clock;
+
+
+void report (const std :: string & name, std :: vector < double > & latency, const double & elapsed, const double & avg_batch)
+{
+  std :: sort(latency.begin(), latency.end());
+
+  const double p50 = latency[latency.size() / 2];
+  const double p99 = latency[static_cast < std :: size_t >(latency.size() * .99)];
+
+  std :: cout << std :: left << std :: setw(14) << name
+              << std :: right << std :: fixed << std :: setprecision(0)
+              << std :: setw(14) << latency.size() / elapsed
+              << std :: setprecision(1)
+              << std :: setw(14) << p50
+              << std :: setw(14) << p99
+              << std :: setw(12) << avg_batch
+              << std :: endl;
+}
+
+
+int main (int argc, char ** argv)
+{
+  const int32_t n_clients = argc > 1 ? std :: stoi(argv[1]) : 16;
+  const std :: chrono :: microseconds max_latency (argc > 2 ? std :: stoi(argv[2]) : 200);
+
+  std :: mt19937 engine (42);
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: vector < float > data (num_samples * num_features);
+  std :: generate(data.begin(), data.end(), [&] () { return random_normal(engine); });
+
+  BCM model (num_outputs, batch_size, transfer_t :: relu,
+             update_args(optimizer_t :: adam, 2e-2f),
+             weights_initialization(weights_init_t :: normal),
+             2, 1e-2f, 0.f, 0.5f, 0.f);
+
+  model.fit(data.data(), num_samples, num_features, 1);
+
+  std :: vector < float > output (static_cast < std :: size_t >(num_samples) * num_outputs);
+  std :: vector < double > latency (num_samples);
+
+  std :: cout << std :: left << std :: setw(14) << "mode"
+              << std :: right
+              << std :: setw(14) << "req/s"
+              << std :: setw(14) << "p50 [us]"
+              << std :: setw(14) << "p99 [us]"
+              << std :: setw(12) << "avg batch"
+              << std :: endl;
+
+  // sequential predict calls (GEMV)
+  auto start = timer :: now();
+
+  for (int32_t i = 0; i < num_samples; ++i)
+  {
+    const auto t = timer :: now();
+    auto res = model.predict(data.data() + static_cast < int64_t >(i) * num_features, 1, num_features);
+    std :: copy_n(res.get(), num_outputs, output.data() + static_cast < int64_t >(i) * num_outputs);
+    latency[i] = std :: chrono :: duration < double, std :: micro > (timer :: now() - t).count();
+  }
+
+  report("predict", latency, std :: chrono :: duration < double > (timer :: now() - start).count(), 1.);
+
+  // micro-batched engine (GEMM)
+  for (int32_t max_batch : {1, 8, 32, 128})
+  {
+    inference_engine server (model, max_batch, max_latency);
+
+    start = timer :: now();
+
+    std :: vector < std :: thread > clients;
+
+    for (int32_t c = 0; c < n_clients; ++c)
+      clients.emplace_back([&, c]
+                           {
+                             for (int32_t i = c; i < num_samples; i += n_clients)
+                             {
+                               const auto t = timer :: now();
+                               server.predict(data.data() + static_cast < int64_t >(i) * num_features,
+                                              output.data() + static_cast < int64_t >(i) * num_outputs);
+                               latency[i] = std :: chrono :: duration < double, std :: micro > (timer :: now() - t).count();
+                             }
+                           });
+
+    for (auto & client : clients)
+      client.join();
+
+    const double elapsed = std :: chrono :: duration < double > (timer :: now() - start).count();
+
+    report("engine b=" + std :: to_string(max_batch), latency, elapsed,
+           static_cast < double >(server.get_num_requests()) / server.get_num_batches());
+  }
+
+  return 0;
+}
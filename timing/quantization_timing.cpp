@@ -0,0 +1,178 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+#include <bcm.h>
+#include <hopfield.h>
+#include <mnist.h>
+
+#include <vector>
+#include <random>
+#include <iomanip>
+
+/**
+* @brief Accuracy and throughput of the quantized models.
+*
+* @details The script fits the BCM and Hopfield models on the MNIST training
+* images (if the path of the image file is given, otherwise on a random uint8
+* dataset with the same shape) and compares the float prediction on the raw
+* pixels with the int8 and bf16 quantized models. For each model the memory
+* size of the weights, the prediction throughput (samples per second), the
+* maximum absolute error, the relative error (Frobenius norm) and the fraction
+* of samples with the same most active unit are reported.
+*
+* Usage: timing_quantization [mnist_training_images]
+*
+*/
+
+static const int32_t num_samples  = 1 << 13; ///< number of samples of the random dataset
+static const int32_t num_features = 784;     ///< number of features of the random dataset
+static const int32_t num_outputs  = 256;     ///< number of hidden units
+static const int32_t batch_size   = 1024;    ///< size of the minibatch
+static const int32_t num_repeat   = 5;       ///< number of repetitions of the timing
+
+
+template < class Predict >
+double timeit (Predict predict)
+{
+  auto start = utils :: what_time_is_it_now();
+
+  for (int32_t i = 0; i < num_repeat; ++i)
+    predict();
+
+  return std :: chrono :: duration < double > (utils :: what_time_is_it_now() - start).count() / num_repeat;
+}
+
+template < class Model >
+void compare (const std :: string & name, Model & model, const uint8_t * data, const int32_t & n_samples,
+  const int32_t & n_features, const input_normalization & norm)
+{
+  std :: unique_ptr < float [] > reference;
+  const double t_ref = timeit([&] { reference = model.predict(data, n_samples, n_features, n_features, norm); });
+
+  Eigen :: Map < Eigen :: MatrixXf > ref (reference.get(), num_outputs, n_samples);
+
+  std :: cout << std :: left << std :: setw(10) << name
+              << std :: setw(8) << "float"
+              << std :: right << std :: fixed << std :: setprecision(1)
+              << std :: setw(12) << model.weights_view().size() * sizeof(float) / 1024.
+              << std :: setprecision(0)
+              << std :: setw(14) << n_samples / t_ref
+              << std :: setw(14) << "-" << std :: setw(14) << "-" << std :: setw(12) << "-"
+              << std :: endl;
+
+  for (const auto & type : {std :: make_pair(quantization_t :: int8, "int8"), std :: make_pair(quantization_t :: bf16, "bf16")})
+  {
+    quantized_model qmodel = model.quantize(type.first);
+
+    std :: unique_ptr < float [] > output;
+    const double t = timeit([&] { output = qmodel.predict(data, n_samples, n_features, n_features, norm); });
+
+    Eigen :: Map < Eigen :: MatrixXf > out (output.get(), num_outputs, n_samples);
+
+    // agreement of the most active unit of each sample
+    int32_t agree = 0;
+
+    for (int32_t i = 0; i < n_samples; ++i)
+    {
+      Eigen :: Index ref_max, out_max;
+      ref.col(i).maxCoeff(&ref_max);
+      out.col(i).maxCoeff(&out_max);
+      agree += ref_max == out_max;
+    }
+
+    std :: cout << std :: left << std :: setw(10) << name
+                << std :: setw(8) << type.second
+                << std :: right << std :: fixed << std :: setprecision(1)
+                << std :: setw(12) << qmodel.nbytes() / 1024.
+                << std :: setprecision(0)
+                << std :: setw(14) << n_samples / t
+                << std :: scientific << std :: setprecision(2)
+                << std :: setw(14) << (out - ref).cwiseAbs().maxCoeff()
+                << std :: setw(14) << (out - ref).norm() / ref.norm()
+                << std :: fixed << std :: setprecision(2)
+                << std :: setw(11) << 100. * agree / n_samples << "%"
+                << std :: endl;
+  }
+}
+
+
+int main (int argc, char ** argv)
+{
+  std :: vector < uint8_t > random_data;
+  data_loader :: MNIST dataset;
+
+  const uint8_t * data = nullptr;
+  int32_t n_samples = num_samples;
+  int32_t n_features = num_features;
+
+  if (argc > 1)
+  {
+    dataset.load_training_images(std :: string(argv[1]));
+    data = dataset.training_images.get();
+    n_samples = dataset.num_train_sample;
+    n_features = dataset.rows * dataset.cols * dataset.channels;
+  }
+  else
+  {
+    std :: mt19937 engine (42);
+    std :: uniform_int_distribution < int32_t > random_pixel (0, 255);
+
+    random_data.resize(static_cast < std :: size_t >(num_samples) * num_features);
+    std :: generate(random_data.begin(), random_data.end(), [&] () { return static_cast < uint8_t >(random_pixel(engine)); });
+    data = random_data.data();
+  }
+
+  const input_normalization norm (1.f / 255.f);
+
+  BCM bcm (num_outputs, batch_size, transfer_t :: relu,
+           update_args(optimizer_t :: adam, 2e-2f),
+           weights_initialization(weights_init_t :: normal),
+           2, 1e-2f, 0.f, 0.5f, 0.f);
+
+  Hopfield hopfield (num_outputs, batch_size,
+                     update_args(optimizer_t :: sgd, 2e-2f),
+                     weights_initialization(weights_init_t :: normal),
+                     2, 1e-2f, 0.f, 0.4f, 3.f, 2);
+
+  bcm.fit(data, n_samples, n_features, n_features, norm, 1);
+  hopfield.fit(data, n_samples, n_features, n_features, norm, 1);
+
+  std :: cout << std :: left << std :: setw(10) << "model"
+              << std :: setw(8) << "type"
+              << std :: right
+              << std :: setw(12) << "size [KB]"
+              << std :: setw(14) << "samples/s"
+              << std :: setw(14) << "max abs err"
+              << std :: setw(14) << "rel err"
+              << std :: setw(12) << "top-1"
+              << std :: endl;
+
+  compare("BCM", bcm, data, n_samples, n_features, norm);
+  compare("Hopfield", hopfield, data, n_samples, n_features, norm);
+
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*M///////////////////////////////////////////////////////////////////////////////////////
+//
+//  IMPORTANT: READ BEFORE DOWNLOADING, COPYING, INSTALLING OR USING.
+//
+//  The OpenHiP package is licensed under the MIT "Expat" License:
+//
+//  Copyright (c) 2021: Nico Curti.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  the software is provided "as is", without warranty of any kind, express or
+//  implied, including but not limited to the warranties of merchantability,
+//  fitness for a particular purpose and noninfringement. in no event shall the
+//  authors or copyright holders be liable for any claim, damages or other
+//  liability, whether in an action of contract, tort or otherwise, arising from,
+//  out of or in connection with the software or the use or other dealings in the
+//  software.
+//
+//M*/
+#include <bcm.h>
+#include <hopfield.h>
+
+#include <vector>
+#include <random>
+#include <iomanip>
+
+/**
+* @brief Strong scaling of the training step.
+*
+* @details The script trains the BCM and Hopfield models on the same
+* random dataset using an increasing number of threads (powers of 2 up to
+* the given maximum, default 64), reporting the time per epoch, the speedup
+* and the parallel efficiency with respect to the single thread run.
+* Remember that the multi-threading is enabled only if the library is
+* built with the OMP option.
+*
+* Usage: timing_scaling [max_threads]
+*
+*/
+
+static const int32_t num_samples  = 1 << 14; ///< number of samples of the dataset
+static const int32_t num_features = 784;     ///< number of features of the dataset
+static const int32_t num_outputs  = 256;     ///< number of hidden units
+static const int32_t batch_size   = 1024;    ///< size of the minibatch
+static const int32_t num_epochs   = 3;       ///< number of epochs for the timing
+
+
+template < class Model >
+double timeit (Model & model, std :: vector < float > & data, const int32_t & n_threads)
+{
+  model.set_num_threads(n_threads);
+
+  auto start = utils :: what_time_is_it_now();
+  model.fit(data.data(), num_samples, num_features, num_epochs);
+
+  return std :: chrono :: duration < double > (utils :: what_time_is_it_now() - start).count() / num_epochs;
+}
+
+template < class Model >
+void scaling (const std :: string & name, Model & model, std :: vector < float > & data, const int32_t & max_threads)
+{
+  double t_single = 0.;
+
+  for (int32_t n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+  {
+    const double t = timeit(model, data, n_threads);
+
+    if (n_threads == 1)
+      t_single = t;
+
+    std :: cout << std :: left << std :: setw(10) << name
+                << std :: right << std :: setw(10) << n_threads
+                << std :: fixed << std :: setprecision(4)
+                << std :: setw(14) << t
+                << std :: setprecision(2)
+                << std :: setw(10) << t_single / t << "x"
+                << std :: setw(11) << 100. * t_single / (t * n_threads) << "%"
+                << std :: endl;
+  }
+}
+
+
+int main (int argc, char ** argv)
+{
+  const int32_t max_threads = argc > 1 ? std :: stoi(argv[1]) : 64;
+
+  std :: mt19937 engine (42);
+  std :: normal_distribution < float > random_normal (0.f, 1.f);
+
+  std :: vector < float > data (num_samples * num_features);
+  std :: generate(data.begin(), data.end(), [&] () { return random_normal(engine); });
+
+#ifndef _OPENMP
+  std :: cout << "OpenMP support: disabled (the library runs on a single thread)" << std :: endl;
+#endif
+
+  std :: cout << std :: left << std :: setw(10) << "model"
+              << std :: right
+              << std :: setw(10) << "threads"
+              << std :: setw(14) << "epoch [s]"
+              << std :: setw(11) << "speedup"
+              << std :: setw(12) << "efficiency"
+              << std :: endl;
+
+  BCM bcm (num_outputs, batch_size, transfer_t :: relu,
+           update_args(optimizer_t :: adam, 2e-2f),
+           weights_initialization(weights_init_t :: normal),
+           num_epochs + 1, 1e-2f, 0.f, 0.5f, 0.f);
+
+  Hopfield hopfield (num_outputs, batch_size,
+                     update_args(optimizer_t :: sgd, 2e-2f),
+                     weights_initialization(weights_init_t :: normal),
+                     num_epochs + 1, 1e-2f, 0.f, 0.4f, 3.f, 2);
+
+  scaling("BCM", bcm, data, max_threads);
+  scaling("Hopfield", hopfield, data, max_threads);
+
+  return 0;
+}